@@ -4,28 +4,69 @@
 #include "sim/constantes.hpp"
 #include "sim/progargs.hpp"
 #include "sim/simulacion.hpp"
+#include "sim/distribuido.hpp"
+#include "sim/lote.hpp"
+#include "sim/nucleos.hpp"
+#include "sim/capas.hpp"
+#include "sim/servidor.hpp"
 
 
 int main(int argc, char *argv[]) {
     // Prepara los argumentos para pasarlos al resto de funciones (esto incluye nuestro propio "struct")
     std::span const args_view{argv, static_cast<std::size_t>(argc)};
-    std::vector<std::string> const arguments{args_view.begin() + 1, args_view.end()};
+    std::vector<std::string> arguments{args_view.begin() + 1, args_view.end()};
     Argumentos argumentos;
 
+    // Separa las opciones "--nombre=valor" de los argumentos posicionales
+    Constantes::ErrorCode errorCode = extraerOpciones(arguments, argumentos.opciones);
+    if (errorCode != Constantes::ErrorCode::NO_ERROR) {
+        return static_cast<int>(errorCode);
+    }
+
+    PoolParticulas::configurarPaginasGrandes(argumentos.opciones.paginasGrandes);
+
+    // En el modo por lotes los trabajos vienen del manifiesto, asi que no puede haber argumentos posicionales
+    if (!argumentos.opciones.manifiesto.empty()) {
+        if (!arguments.empty()) {
+            std::cerr << "Error: --batch does not take positional arguments.\n";
+            return static_cast<int>(Constantes::ErrorCode::INVALID_ARGUMENTS);
+        }
+        return static_cast<int>(ejecutarLote(argumentos.opciones));
+    }
+
+    // En el modo servidor los trabajos llegan por el socket
+    if (!argumentos.opciones.socketServidor.empty()) {
+        if (!arguments.empty()) {
+            std::cerr << "Error: --serve does not take positional arguments.\n";
+            return static_cast<int>(Constantes::ErrorCode::INVALID_ARGUMENTS);
+        }
+        return static_cast<int>(ejecutarServidor(argumentos.opciones));
+    }
+
     // Intenta obtener los valores del fichero de entrada (si no puede, devuelve error)
-    Constantes::ErrorCode errorCode = comprobarArgsEntrada(argc, arguments, argumentos);
+    errorCode = comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
     if (errorCode != Constantes::ErrorCode::NO_ERROR) {
         return static_cast<int>(errorCode);
     }
+    if (!argumentos.opciones.directorioCapas.empty()) {
+        return static_cast<int>(ejecutarPorCapas(argumentos));
+    }
 
     // Genera la malla y la simula (con esto obtiene resultados como los bloques o la longitud de suavizado)
     Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    const bool distribuido = argumentos.opciones.rangos > 1;
+    malla.setDisperso(argumentos.opciones.mallaDispersa && !distribuido); // Los rangos usan la malla densa
+    malla.setSubdivision(argumentos.opciones.subdivision);
     auto result = malla.simular_malla(argumentos.fluid);
     double const smoothingLength = result.first;
     double const particleMass = result.second;
+    if (argumentos.opciones.nucleo == ModoNucleo::rapido) {
+        Nucleos::mostrarInforme(std::cout, calcularParametros(smoothingLength, particleMass).constAccTransf);
+    }
 
     // Se procesan todas las etapas de la simulacion, tantas veces como se haya especificado
-    std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, smoothingLength, particleMass);
+    std::vector<Block> blocks = distribuido ? ejecutarDistribuido(malla, argumentos, smoothingLength, particleMass)
+                                            : ejecutarIteraciones(malla, argumentos, smoothingLength, particleMass);
 
     // Intenta escribir el resultado en el fichero de salida (si no puede, devuelve error)
     errorCode = comprobarArgsSalida(arguments, argumentos, blocks);
@@ -2,85 +2,320 @@
 // Created by Raul on 11/11/2023.
 //
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <span>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-struct Particle {
-    int64_t id;
-    double px, py, pz;
-    double hvx, hvy, hvz;
-    double vx, vy, vz;
-    double density;
-    double ax, ay, az;
+// Formato .fld: cabecera (particulas por metro como float y numero de particulas como int) y, por particula, 9 floats
+// (posicion, hv y velocidad). El id de cada particula es su posicion en el fichero
+namespace Formato {
+    constexpr std::size_t tamCabecera = sizeof(float) + sizeof(int);
+    constexpr int numCampos = 9;
+    constexpr std::size_t tamParticula = numCampos * sizeof(float);
+    constexpr std::array<const char *, numCampos> nombres = {"px", "py", "pz", "hvx", "hvy", "hvz", "vx", "vy", "vz"};
+}
+
+namespace Comparacion {
+    constexpr int particulasLote = 64; // Las particulas se trasponen por lotes para comparar cada campo con SIMD
+    constexpr int particulasMinimasHilo = 4096;
+    constexpr int cubetaNaN = 34; // Cubetas del histograma: 0 ulp, [1, 2), [2, 4), ..., [2^32, 2^33) y NaN
+    constexpr int numCubetas = cubetaNaN + 1;
+    constexpr std::size_t idsMostrados = 8;
+    constexpr int codigoDistintos = -1;
+    constexpr int codigoArgumentos = -2;
+}
+
+
+// Fichero proyectado en memoria, de solo lectura (se desproyecta al destruirlo)
+class FicheroMapeado {
+public:
+    explicit FicheroMapeado(const std::string &ruta) {
+        const int descriptor = ::open(ruta.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return;
+        }
+        struct stat estado{};
+        if (::fstat(descriptor, &estado) == 0 && estado.st_size > 0) {
+            tam = static_cast<std::size_t>(estado.st_size);
+            void *region = ::mmap(nullptr, tam, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (region != MAP_FAILED) {
+                ::madvise(region, tam, MADV_SEQUENTIAL);
+                datos = static_cast<const char *>(region);
+            }
+        }
+        ::close(descriptor);
+    }
+
+    ~FicheroMapeado() {
+        if (datos != nullptr) {
+            ::munmap(const_cast<char *>(datos), tam); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        }
+    }
+
+    FicheroMapeado(const FicheroMapeado &) = delete;
+    FicheroMapeado &operator=(const FicheroMapeado &) = delete;
+
+    // Numero de particulas de la cabecera, o -1 si no se ha podido abrir o su tamaño no es el que indica la cabecera
+    [[nodiscard]] int numParticulas() const {
+        if (datos == nullptr || tam < Formato::tamCabecera) {
+            return -1;
+        }
+        int numero = 0;
+        std::memcpy(&numero, datos + sizeof(float), sizeof(int));
+        const bool tamCorrecto = numero >= 0 &&
+                                 tam == Formato::tamCabecera + static_cast<std::size_t>(numero) * Formato::tamParticula;
+        return tamCorrecto ? numero : -1;
+    }
+
+    // Comienzo de los campos de la particula "id"
+    [[nodiscard]] const char *particula(int id) const {
+        return datos + Formato::tamCabecera + static_cast<std::size_t>(id) * Formato::tamParticula;
+    }
+
+private:
+    const char *datos{nullptr};
+    std::size_t tam{0};
 };
 
-struct Fluid{
-    int particlespermeter = 0;
-    int numberparticles = 0;
-    std::vector<Particle> particles;
+
+// Estadisticas de las diferencias de un campo en un rango de particulas
+struct EstadisticasCampo {
+    double errorMaximo{0.0};
+    int idErrorMaximo{-1};
+    std::uint64_t ulpMaximo{0};
+    std::size_t fueraTolerancia{0};
+    std::vector<int> ids; // Primeras particulas fuera de tolerancia
+    std::array<std::size_t, Comparacion::numCubetas> histograma{};
+
+    // Suma las de un rango posterior
+    void juntar(const EstadisticasCampo &otras) {
+        if (otras.errorMaximo > errorMaximo) {
+            errorMaximo = otras.errorMaximo;
+            idErrorMaximo = otras.idErrorMaximo;
+        }
+        ulpMaximo = std::max(ulpMaximo, otras.ulpMaximo);
+        fueraTolerancia += otras.fueraTolerancia;
+        for (const int id: otras.ids) {
+            if (ids.size() < Comparacion::idsMostrados) {
+                ids.push_back(id);
+            }
+        }
+        for (std::size_t cubeta = 0; cubeta < histograma.size(); ++cubeta) {
+            histograma[cubeta] += otras.histograma[cubeta];
+        }
+    }
 };
 
-//NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
-void readFldFile(std::ifstream& file, Fluid& fluid){
-  file.read(reinterpret_cast<char*>(&fluid.particlespermeter), sizeof(float));
-  file.read(reinterpret_cast<char*>(&fluid.numberparticles), sizeof(int));
-  fluid.particles.resize(fluid.numberparticles);
-  for (int i = 0; i < fluid.numberparticles; ++i) {
-    fluid.particles[i].id = i;
-    for (double* attr : {&fluid.particles[i].px, &fluid.particles[i].py, &fluid.particles[i].pz,
-                          &fluid.particles[i].hvx, &fluid.particles[i].hvy, &fluid.particles[i].hvz,
-                          &fluid.particles[i].vx, &fluid.particles[i].vy, &fluid.particles[i].vz}) {
-      float temp = 0;
-      file.read(reinterpret_cast<char*>(&temp), sizeof(float));
-      *attr = static_cast<double>(temp);
-    }
-  }
+using Estadisticas = std::array<EstadisticasCampo, Formato::numCampos>;
+
+
+namespace {
+    using CamposLote = std::array<std::array<float, Comparacion::particulasLote>, Formato::numCampos>;
+
+    // Un lote de particulas de ambos ficheros, traspuesto (los valores de cada campo quedan contiguos). Las posiciones
+    // que sobran en el ultimo lote valen 0 en ambos
+    struct Lote {
+        CamposLote referencia{};
+        CamposLote salida{};
+        int primera{0};
+        int cuantas{0};
+    };
+
+    struct Ficheros {
+        const FicheroMapeado &referencia;
+        const FicheroMapeado &salida;
+        double tolerancia;
+    };
+
+    void trasponer(const FicheroMapeado &fichero, const Lote &lote, CamposLote &destino) {
+        for (int i = 0; i < lote.cuantas; ++i) {
+            std::array<float, Formato::numCampos> valores{};
+            std::memcpy(valores.data(), fichero.particula(lote.primera + i), Formato::tamParticula);
+            for (int campo = 0; campo < Formato::numCampos; ++campo) {
+                destino[campo][i] = valores[campo];
+            }
+        }
+        for (auto &valores: destino) {
+            std::fill(valores.begin() + lote.cuantas, valores.end(), 0.0F);
+        }
+    }
+
+    // Los bits de un float como un entero que crece con su valor (los negativos se reflejan), asi la distancia en
+    // ulp entre dos floats es la resta de sus enteros
+    std::int64_t enteroOrdenado(float valor) {
+        const auto bits = std::bit_cast<std::int32_t>(valor);
+        return bits < 0 ? static_cast<std::int64_t>(INT32_MIN) - bits : bits;
+    }
+
+    // Funcion que anota en las estadisticas un valor con bits distintos en ambos ficheros
+    void anotarDiferencia(EstadisticasCampo &estadisticas, int id, std::pair<float, float> valores,
+                          double tolerancia) {
+        const bool hayNaN = std::isnan(valores.first) || std::isnan(valores.second);
+        const double error = hayNaN ? INFINITY : std::abs(static_cast<double>(valores.second) - valores.first);
+        const auto ulp = static_cast<std::uint64_t>(std::abs(enteroOrdenado(valores.second) -
+                                                             enteroOrdenado(valores.first)));
+        ++estadisticas.histograma[hayNaN ? Comparacion::cubetaNaN : std::bit_width(ulp)];
+        estadisticas.ulpMaximo = std::max(estadisticas.ulpMaximo, hayNaN ? 0 : ulp);
+        if (error > estadisticas.errorMaximo) {
+            estadisticas.errorMaximo = error;
+            estadisticas.idErrorMaximo = id;
+        }
+        if (error > tolerancia) {
+            ++estadisticas.fueraTolerancia;
+            if (estadisticas.ids.size() < Comparacion::idsMostrados) {
+                estadisticas.ids.push_back(id);
+            }
+        }
+    }
+
+    // Funcion que compara un campo del lote. Primero cuenta los valores con los mismos bits, con un bucle sin saltos
+    // sobre el lote entero que el compilador vectoriza, y solo si alguno es distinto los recorre uno a uno
+    void compararCampo(const Lote &lote, int campo, double tolerancia, EstadisticasCampo &estadisticas) {
+        const std::array<float, Comparacion::particulasLote> &referencia = lote.referencia[campo];
+        const std::array<float, Comparacion::particulasLote> &salida = lote.salida[campo];
+        int iguales = 0;
+        for (int i = 0; i < Comparacion::particulasLote; ++i) {
+            iguales += std::bit_cast<std::uint32_t>(referencia[i]) == std::bit_cast<std::uint32_t>(salida[i]) ? 1 : 0;
+        }
+        const int sobrantes = Comparacion::particulasLote - lote.cuantas;
+        estadisticas.histograma[0] += static_cast<std::size_t>(iguales - sobrantes);
+        if (iguales == Comparacion::particulasLote) {
+            return;
+        }
+        for (int i = 0; i < lote.cuantas; ++i) {
+            if (std::bit_cast<std::uint32_t>(referencia[i]) != std::bit_cast<std::uint32_t>(salida[i])) {
+                anotarDiferencia(estadisticas, lote.primera + i, {referencia[i], salida[i]}, tolerancia);
+            }
+        }
+    }
+
+    // Funcion que compara las particulas [desde, hasta) lote a lote
+    Estadisticas compararRango(const Ficheros &ficheros, int desde, int hasta) {
+        Estadisticas estadisticas{};
+        Lote lote;
+        for (int primera = desde; primera < hasta; primera += Comparacion::particulasLote) {
+            lote.primera = primera;
+            lote.cuantas = std::min(Comparacion::particulasLote, hasta - primera);
+            trasponer(ficheros.referencia, lote, lote.referencia);
+            trasponer(ficheros.salida, lote, lote.salida);
+            for (int campo = 0; campo < Formato::numCampos; ++campo) {
+                compararCampo(lote, campo, ficheros.tolerancia, estadisticas[campo]);
+            }
+        }
+        return estadisticas;
+    }
+
+    // Funcion que reparte las particulas en rangos contiguos, uno por hilo, y junta sus estadisticas en orden
+    Estadisticas compararEnParalelo(const Ficheros &ficheros, int numParticulas) {
+        const int porNucleos = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        const int numHilos = std::clamp(numParticulas / Comparacion::particulasMinimasHilo, 1, porNucleos);
+        std::vector<Estadisticas> parciales(numHilos);
+        std::vector<std::thread> hilos;
+        for (int hilo = 0; hilo < numHilos; ++hilo) {
+            hilos.emplace_back([&, hilo] {
+                parciales[hilo] = compararRango(ficheros, static_cast<int>(std::int64_t{numParticulas} * hilo / numHilos),
+                                                static_cast<int>(std::int64_t{numParticulas} * (hilo + 1) / numHilos));
+            });
+        }
+        Estadisticas total{};
+        for (int hilo = 0; hilo < numHilos; ++hilo) {
+            hilos[hilo].join();
+            for (int campo = 0; campo < Formato::numCampos; ++campo) {
+                total[campo].juntar(parciales[hilo][campo]);
+            }
+        }
+        return total;
+    }
+
+    // Cubetas del histograma con algun valor, como "ulp minimo-maximo: cuantos"
+    void mostrarHistograma(const EstadisticasCampo &estadisticas) {
+        std::cout << "  ulp:";
+        for (int cubeta = 0; cubeta < Comparacion::numCubetas; ++cubeta) {
+            const std::size_t cuantos = estadisticas.histograma[cubeta];
+            if (cuantos == 0) {
+                continue;
+            }
+            if (cubeta == Comparacion::cubetaNaN) {
+                std::cout << " NaN:" << cuantos;
+            } else if (cubeta <= 1) {
+                std::cout << " " << cubeta << ":" << cuantos;
+            } else {
+                std::cout << " " << (std::uint64_t{1} << (cubeta - 1)) << "-" << (std::uint64_t{1} << cubeta) - 1
+                          << ":" << cuantos;
+            }
+        }
+        std::cout << "\n";
+    }
+
+    void mostrarInforme(const Estadisticas &estadisticas, int numParticulas, double tolerancia) {
+        std::cout << "Particulas: " << numParticulas << ", tolerancia: " << tolerancia << "\n";
+        for (int campo = 0; campo < Formato::numCampos; ++campo) {
+            const EstadisticasCampo &actual = estadisticas[campo];
+            std::cout << Formato::nombres[campo] << ": error maximo " << actual.errorMaximo;
+            if (actual.idErrorMaximo >= 0) {
+                std::cout << " (id " << actual.idErrorMaximo << ")";
+            }
+            std::cout << ", ulp maximo " << actual.ulpMaximo << ", fuera de tolerancia " << actual.fueraTolerancia;
+            for (std::size_t i = 0; i < actual.ids.size(); ++i) {
+                std::cout << (i == 0 ? " (ids" : "") << " " << actual.ids[i];
+            }
+            std::cout << (actual.ids.empty() ? "" : actual.fueraTolerancia > actual.ids.size() ? " ...)" : ")") << "\n";
+            mostrarHistograma(actual);
+        }
+    }
 }
-// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
-
-int compareFiles(const std::string& datafilename, const std::string& outfilename, double tolerance) {
-  //leo archivo de trazas y guardo los datos en un vector de struct de ParticleInfo, y luego hago lo mismo con el archivo de salida de fluid
-  Fluid fluidData;
-  std::ifstream file(datafilename, std::ios::binary);
-  if (!file.is_open()) {
-    return -1;
-  }
-  readFldFile(file, fluidData);
-  Fluid fluidOut;
-  std::ifstream outF(outfilename, std::ios::binary);
-  if (!outF.is_open()) {
-    return -1;
-  }
-  readFldFile(outF, fluidOut);
-  //comparo resultados de leer cada archivo con un cierto margen de error
-  for(int i = 0; i<fluidOut.numberparticles; i++){
-    if ((fluidOut.particles[i].px - tolerance > fluidData.particles[i].px or fluidOut.particles[i].px + tolerance < fluidData.particles[i].px) or (fluidOut.particles[i].py - tolerance > fluidData.particles[i].py or fluidOut.particles[i].py + tolerance < fluidData.particles[i].py) or (fluidOut.particles[i].pz - tolerance > fluidData.particles[i].pz or fluidOut.particles[i].pz + tolerance < fluidData.particles[i].pz)
-        or (fluidOut.particles[i].hvx - tolerance > fluidData.particles[i].hvx or fluidOut.particles[i].hvx + tolerance < fluidData.particles[i].hvx) or (fluidOut.particles[i].hvy - tolerance > fluidData.particles[i].hvy or fluidOut.particles[i].hvy + tolerance < fluidData.particles[i].hvy) or (fluidOut.particles[i].hvz - tolerance > fluidData.particles[i].hvz or fluidOut.particles[i].hvz + tolerance < fluidData.particles[i].hvz)
-        or (fluidOut.particles[i].vx - tolerance > fluidData.particles[i].vx or fluidOut.particles[i].vx + tolerance < fluidData.particles[i].vx) or (fluidOut.particles[i].vy - tolerance > fluidData.particles[i].vy or fluidOut.particles[i].vy + tolerance < fluidData.particles[i].vy) or (fluidOut.particles[i].vz - tolerance > fluidData.particles[i].vz or fluidOut.particles[i].vz + tolerance < fluidData.particles[i].vz)
-        or (fluidOut.particles[i].density - tolerance > fluidData.particles[i].density or fluidOut.particles[i].density + tolerance < fluidData.particles[i].density)
-        or (fluidOut.particles[i].ax - tolerance > fluidData.particles[i].ax or fluidOut.particles[i].ax + tolerance < fluidData.particles[i].ax) or (fluidOut.particles[i].ay - tolerance > fluidData.particles[i].ay or fluidOut.particles[i].ay + tolerance < fluidData.particles[i].ay) or (fluidOut.particles[i].az - tolerance > fluidData.particles[i].az or fluidOut.particles[i].az + tolerance < fluidData.particles[i].az)){
-      return -1;
-    }
-  }
-  return 0;
+
+
+// Compara la salida con la referencia campo a campo. Devuelve 0 si todos los valores estan dentro de la tolerancia
+// y -1 si alguno no lo esta o los ficheros no se pueden leer o tienen distinto numero de particulas. El informe se
+// muestra si se pide o si la comparacion falla
+int compareFiles(const std::string &datafilename, const std::string &outfilename, double tolerance, bool informe) {
+    const FicheroMapeado referencia(datafilename);
+    const FicheroMapeado salida(outfilename);
+    const int numParticulas = referencia.numParticulas();
+    if (numParticulas < 0 || salida.numParticulas() != numParticulas) {
+        std::cerr << "Ficheros ilegibles o con distinto numero de particulas: " << datafilename << ", " << outfilename
+                  << "\n";
+        return Comparacion::codigoDistintos;
+    }
+    const Estadisticas estadisticas = compararEnParalelo(Ficheros{referencia, salida, tolerance}, numParticulas);
+    const bool iguales = std::ranges::all_of(estadisticas, [](const EstadisticasCampo &campo) {
+        return campo.fueraTolerancia == 0;
+    });
+    if (informe || !iguales) {
+        mostrarInforme(estadisticas, numParticulas, tolerance);
+    }
+    return iguales ? 0 : Comparacion::codigoDistintos;
 }
 
 int main(int argc, char** argv){
-  if (argc != 4){
-      std::cerr<<"Número inválido de argumentos para filesComparator.cpp. \n";
-      return -2;
-  }
-
-  std::span const args_view{argv, static_cast<std::size_t>(argc)};
-  std::vector<std::string> const arguments{args_view.begin() + 1, args_view.end()};
-  const std::string& fileData = arguments[0];
-  const std::string& fileOutput = arguments[1];
-  const double tolerance = std::stod(arguments[2]);
+    std::span const args_view{argv, static_cast<std::size_t>(argc)};
+    std::vector<std::string> arguments{args_view.begin() + 1, args_view.end()};
+    const bool informe = !arguments.empty() && arguments.back() == "--report";
+    if (informe) {
+        arguments.pop_back();
+    }
+    if (arguments.size() != 3) {
+        std::cerr << "Número inválido de argumentos para filesComparator.cpp. \n";
+        return Comparacion::codigoArgumentos;
+    }
 
-  const int code = compareFiles(fileData, fileOutput, tolerance);
-  return code;
+    const std::string &fileData = arguments[0];
+    const std::string &fileOutput = arguments[1];
+    const double tolerance = std::stod(arguments[2]);
 
-}
\ No newline at end of file
+    return compareFiles(fileData, fileOutput, tolerance, informe);
+}
@@ -0,0 +1,174 @@
+// Prueba de rendimiento: ejecuta fluid con unas cargas fijas varias veces (con --stage-times) y compara la mediana del
+// tiempo de cada etapa con la de referencia guardada en un JSON. Falla si alguna etapa es mas lenta que la referencia
+// mas el margen de ruido, mostrando la diferencia de cada etapa
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <span>
+
+namespace {
+    // Carga de trabajo fija: fichero de ftest/files_fld y numero de iteraciones
+    struct Carga {
+        const char *fichero;
+        int iteraciones;
+    };
+
+    constexpr std::array<Carga, 2> cargas = {Carga{"small.fld", 100}, Carga{"large.fld", 20}};
+
+    struct Configuracion {
+        std::string fluid;
+        std::string referencia;
+        int ejecuciones = 5;
+        double margenRelativo = 0.15; // Una etapa falla si su mediana supera la referencia en esta fraccion...
+        double margenAbsoluto = 0.005; // ... y tambien en estos segundos (las etapas cortas son mas ruidosas)
+        bool actualizar = false; // Guarda las medianas como nueva referencia en vez de comparar
+    };
+
+    constexpr int codigoRegresion = 1;
+    constexpr int codigoError = 2;
+    constexpr double porcentaje = 100.0;
+
+    using Tiempos = std::map<std::string, double>;
+
+    // Lee un objeto JSON de un nivel con valores numericos ("clave": numero)
+    Tiempos leerJson(const std::string &ruta) {
+        std::ifstream fichero(ruta);
+        std::stringstream contenido;
+        contenido << fichero.rdbuf();
+        const std::string texto = contenido.str();
+        const std::regex par(R"re("([^"]+)"\s*:\s*([-+0-9.eE]+))re");
+        Tiempos valores;
+        for (auto it = std::sregex_iterator(texto.begin(), texto.end(), par); it != std::sregex_iterator(); ++it) {
+            valores[(*it)[1].str()] = std::stod((*it)[2].str());
+        }
+        return valores;
+    }
+
+    void escribirJson(const std::string &ruta, const Tiempos &valores) {
+        std::ofstream fichero(ruta);
+        fichero << "{\n" << std::setprecision(6);
+        for (auto it = valores.begin(); it != valores.end(); ++it) {
+            fichero << "  \"" << it->first << "\": " << it->second << (std::next(it) == valores.end() ? "\n" : ",\n");
+        }
+        fichero << "}\n";
+    }
+
+    double mediana(std::vector<double> valores) {
+        std::ranges::sort(valores);
+        const std::size_t mitad = valores.size() / 2;
+        return valores.size() % 2 == 1 ? valores[mitad] : (valores[mitad - 1] + valores[mitad]) / 2;
+    }
+
+    // Funcion que ejecuta una carga "ejecuciones" veces y devuelve la mediana de cada etapa, con la clave
+    // "fichero iteraciones etapa" (vacio si fluid falla)
+    Tiempos medirCarga(const Configuracion &configuracion, const Carga &carga) {
+        const std::filesystem::path temporal = std::filesystem::temp_directory_path();
+        const std::string tiempos = (temporal / "perfgate-tiempos.json").string();
+        const std::string orden = "'" + configuracion.fluid + "' --stage-times=" + tiempos + " " +
+                                  std::to_string(carga.iteraciones) + " ftest/files_fld/" + carga.fichero + " " +
+                                  (temporal / "perfgate-salida.fld").string() + " > /dev/null";
+        std::map<std::string, std::vector<double>> muestras;
+        for (int ejecucion = 0; ejecucion < configuracion.ejecuciones; ++ejecucion) {
+            if (std::system(orden.c_str()) != 0) { // NOLINT(cert-env33-c)
+                std::cerr << "Error: fallo al ejecutar " << orden << "\n";
+                return {};
+            }
+            for (const auto &[etapa, segundos]: leerJson(tiempos)) {
+                muestras[etapa].push_back(segundos);
+            }
+        }
+        Tiempos medianas;
+        const std::string prefijo = std::string(carga.fichero) + " " + std::to_string(carga.iteraciones) + " ";
+        for (const auto &[etapa, valores]: muestras) {
+            if (etapa != "iterations") {
+                medianas[prefijo + etapa] = mediana(valores);
+            }
+        }
+        return medianas;
+    }
+
+    // Funcion que compara una etapa con su referencia, muestra la diferencia y devuelve si es una regresion
+    bool compararEtapa(const Configuracion &configuracion, const std::string &clave, double referencia,
+                       const Tiempos &medidas) {
+        const auto medida = medidas.find(clave);
+        if (medida == medidas.end()) {
+            std::cout << std::left << std::setw(32) << clave << " no medida  REGRESION\n";
+            return true;
+        }
+        const double diferencia = medida->second - referencia;
+        const bool regresion = diferencia > referencia * configuracion.margenRelativo &&
+                               diferencia > configuracion.margenAbsoluto;
+        std::cout << std::left << std::setw(32) << clave << std::right << std::fixed << std::setprecision(4)
+                  << " referencia " << referencia << " s  mediana " << medida->second << " s  "
+                  << std::showpos << std::setprecision(1) << diferencia / referencia * porcentaje << "%"
+                  << std::noshowpos << (regresion ? "  REGRESION" : "") << "\n";
+        return regresion;
+    }
+
+    // Funcion que lee las opciones "--nombre=valor" tras los dos argumentos posicionales
+    bool leerOpciones(std::span<const std::string> argumentos, Configuracion &configuracion) {
+        for (const std::string &argumento: argumentos) {
+            const std::string valor = argumento.substr(argumento.find('=') + 1);
+            if (argumento.starts_with("--runs=")) {
+                configuracion.ejecuciones = std::max(1, std::stoi(valor));
+            } else if (argumento.starts_with("--threshold=")) {
+                configuracion.margenRelativo = std::stod(valor);
+            } else if (argumento.starts_with("--min-delta=")) {
+                configuracion.margenAbsoluto = std::stod(valor);
+            } else if (argumento == "--update") {
+                configuracion.actualizar = true;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+int main(int argc, char **argv) {
+    std::span const args_view{argv, static_cast<std::size_t>(argc)};
+    const std::vector<std::string> arguments{args_view.begin() + 1, args_view.end()};
+    Configuracion configuracion;
+    if (arguments.size() < 2 || !leerOpciones(std::span(arguments).subspan(2), configuracion)) {
+        std::cerr << "Uso: perfgate <fluid> <referencia.json> [--runs=N] [--threshold=F] [--min-delta=S] [--update]\n";
+        return codigoError;
+    }
+    configuracion.fluid = arguments[0];
+    configuracion.referencia = arguments[1];
+
+    Tiempos medidas;
+    for (const Carga &carga: cargas) {
+        const Tiempos medianas = medirCarga(configuracion, carga);
+        if (medianas.empty()) {
+            return codigoError;
+        }
+        medidas.insert(medianas.begin(), medianas.end());
+    }
+    if (configuracion.actualizar) {
+        escribirJson(configuracion.referencia, medidas);
+        std::cout << "Referencia actualizada: " << configuracion.referencia << "\n";
+        return 0;
+    }
+    const Tiempos referencia = leerJson(configuracion.referencia);
+    if (referencia.empty()) {
+        std::cerr << "Error: no se puede leer la referencia " << configuracion.referencia << "\n";
+        return codigoError;
+    }
+    int regresiones = 0;
+    for (const auto &[clave, segundos]: referencia) {
+        regresiones += compararEtapa(configuracion, clave, segundos, medidas) ? 1 : 0;
+    }
+    std::cout << "Etapas con regresion: " << regresiones << " de " << referencia.size() << "\n";
+    return regresiones == 0 ? 0 : codigoRegresion;
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+
+ruta_ftest=$1
+
+pruebas_pasadas=0
+
+#Esta función compara dos ficheros con ftest y valida su valor de retorno y, si se da, una línea de su informe
+ejecutar_FTEST_cpp() {
+    # Ejecutar el programa ftest con los argumentos proporcionados (siempre con informe), valor de retorno en resultado
+    salida=$($ruta_ftest "$1" "$2" "$3" --report 2>&1)
+    resultado=$?
+
+    if [ "$resultado" -eq "$4" ]; then
+      if [ -z "$5" ] || echo "$salida" | grep -qF -- "$5"; then
+          ((pruebas_pasadas++))
+          echo "Ejecución exitosa. Resultado: $resultado"
+      else
+          echo "Error en el informe, falta: $5"
+      fi
+    else
+        echo "Error en el resultado: $resultado"
+    fi
+}
+
+#SIGNIFICADO SIGUIENTES LÍNEAS DE EJECUCIÓN: <función creada> <archivo referencia> <archivo salida> <tolerancia> <valor de retorno esperado de ftest> <línea esperada en el informe>
+#Los ficheros cmp-100 tienen las 100 primeras partículas de small.fld (no es múltiplo de los lotes de 64 partículas)
+
+#test 1, un fichero comparado consigo mismo es igual incluso con tolerancia 0, por lo que debe retornar 0
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100.fld" "./ftest/files_fld/cmp-100.fld" 0 0 "vz: error maximo 0, ulp maximo 0, fuera de tolerancia 0"
+#test 2, los ficheros tienen distinto número de partículas, por lo que debe retornar -1 (error 255)
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100.fld" "./ftest/files_fld/small.fld" 1e30 255 "distinto numero de particulas"
+#test 3, vy de la última partícula (en el último lote, incompleto) difiere en 1 ulp y la tolerancia es 0, por lo que debe retornar -1 (error 255)
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100.fld" "./ftest/files_fld/cmp-100-1ulp.fld" 0 255 "ulp maximo 1, fuera de tolerancia 1 (ids 99)"
+#test 4, la misma diferencia de 1 ulp está dentro de la tolerancia, por lo que debe retornar 0 (y el histograma la cuenta)
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100.fld" "./ftest/files_fld/cmp-100-1ulp.fld" 1e-3 0 "ulp: 0:99 1:1"
+#test 5, px de la partícula 70 es NaN en la salida, que nunca está dentro de la tolerancia, por lo que debe retornar -1 (error 255)
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100.fld" "./ftest/files_fld/cmp-100-nan.fld" 1e30 255 "ulp: 0:99 NaN:1"
+#test 6, el mismo NaN en ambos ficheros tiene los mismos bits, por lo que debe retornar 0
+ejecutar_FTEST_cpp "./ftest/files_fld/cmp-100-nan.fld" "./ftest/files_fld/cmp-100-nan.fld" 0 0 "px: error maximo 0"
+#test 7, el número de partículas de small.fld (4800) sí es múltiplo de 64 y la salida de referencia coincide, por lo que debe retornar 0
+ejecutar_FTEST_cpp "./ftest/files_fld/small.fld" "./ftest/reference_files/small.fld" 0 0 "Particulas: 4800, tolerancia: 0"
+#test 8, large.fld (15138 partículas) se compara consigo mismo (en rangos de hasta 3 hilos si hay varios núcleos), por lo que debe retornar 0
+ejecutar_FTEST_cpp "./ftest/files_fld/large.fld" "./ftest/files_fld/large.fld" 0 0 "px: error maximo 0, ulp maximo 0, fuera de tolerancia 0"
+
+#Se muestran los resultados de la ejecución de estos tests
+echo "Resultados de los 8 tests del comparador:"
+echo "Tests pasados: $pruebas_pasadas de 8"
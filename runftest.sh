@@ -5,3 +5,5 @@ module avail
 module load gcc/12.1.0
 chmod +x ftest/testFluid.sh
 ftest/testFluid.sh ./build/fluid/fluid ./build/ftest/ftest
+chmod +x ftest/testComparator.sh
+ftest/testComparator.sh ./build/ftest/ftest
@@ -0,0 +1,6 @@
+#!/bin/sh
+
+. /etc/profile
+module avail
+module load gcc/12.1.0
+./build/ftest/perfgate ./build/fluid/fluid ftest/perf_baseline.json
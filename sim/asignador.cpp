@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include "asignador.hpp"
+
+
+namespace {
+    // Clases de tamaño: la 0 es de 2^bitsMinimo bytes y despues hay "pasosPorPotencia" clases entre cada potencia de
+    // dos y la siguiente (la reserva se redondea como mucho un 25%, no al doble), hasta 2^(bitsMinimo + potencias)
+    constexpr std::size_t bitsMinimo = 6;
+    constexpr std::size_t bitsPasos = 2;
+    constexpr std::size_t pasosPorPotencia = std::size_t{1} << bitsPasos;
+    constexpr std::size_t potencias = 40;
+    constexpr std::size_t numClases = 1 + potencias * pasosPorPotencia;
+
+    // Si la clase pedida no tiene trozos libres, se busca en las de hasta el doble de tamaño antes de pedir uno al
+    // sistema. Asi los trozos que deja libres un bloque que cambia de tamaño los aprovechan otros bloques
+    constexpr std::size_t clasesMayores = pasosPorPotencia;
+
+    // Cabecera de cada trozo (su clase), del tamaño de la alineacion de operator new para no perderla
+    constexpr std::size_t tamanoCabecera = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    // Cada trozo libre guarda en su interior el puntero al siguiente trozo libre de su clase
+    struct TrozoLibre {
+        TrozoLibre *siguiente;
+    };
+
+    // Tamaño de pagina grande y de las regiones de las que se cortan los trozos con paginas grandes
+    constexpr std::size_t tamanoPaginaGrande = std::size_t{2} << 20U;
+    constexpr std::size_t tamanoRegion = 4 * tamanoPaginaGrande;
+
+    std::atomic<PoolParticulas::PaginasGrandes> modoPaginas{PoolParticulas::PaginasGrandes::ninguna};
+
+    // Listas de trozos libres, compartidas por todos los hilos (un trozo que libera un hilo lo puede reutilizar
+    // cualquier otro), y regiones reservadas con mmap. Las regiones no se devuelven al sistema: sus trozos vuelven a
+    // las listas y se reutilizan, asi que su tamaño total no supera el maximo de memoria usada por las particulas
+    struct ListasLibres {
+        std::mutex mutex;
+        std::array<TrozoLibre *, numClases> listas{};
+        std::vector<std::pair<const std::byte *, std::size_t>> rangos;
+        std::byte *region = nullptr; // Parte sin usar de la region actual
+        std::size_t restante = 0;
+        std::size_t bytesSistema = 0; // Bytes de todos los trozos pedidos al sistema
+        std::size_t bytesEnUso = 0; // Bytes de los trozos reservados y no liberados
+        std::size_t trozosEnUso = 0;
+        bool activa = true;
+
+        ListasLibres() = default;
+        ListasLibres(const ListasLibres &) = delete;
+        ListasLibres &operator=(const ListasLibres &) = delete;
+        ListasLibres(ListasLibres &&) = delete;
+        ListasLibres &operator=(ListasLibres &&) = delete;
+
+        // Al terminar el programa se devuelven al sistema los trozos libres que no son de una region
+        ~ListasLibres() {
+            for (TrozoLibre *trozo: listas) {
+                while (trozo != nullptr) {
+                    TrozoLibre *siguiente = trozo->siguiente;
+                    liberarSistema(trozo);
+                    trozo = siguiente;
+                }
+            }
+            activa = false;
+        }
+
+        // Devuelve un trozo al sistema, salvo que pertenezca a una region (se libera con el proceso)
+        void liberarSistema(void *puntero) const {
+            const auto *byte = static_cast<const std::byte *>(puntero);
+            const bool enRegion = std::ranges::any_of(rangos, [byte](const auto &rango) {
+                return byte >= rango.first && byte < rango.first + rango.second;
+            });
+            if (!enRegion) {
+                ::operator delete(puntero);
+            }
+        }
+    };
+
+    ListasLibres listasLibres;
+
+#ifndef NDEBUG
+    std::atomic<std::size_t> reservasSistema{0};
+#endif
+
+    // Clase de tamaño de una reserva: la 0 hasta 2^bitsMinimo bytes y despues el menor paso que la contiene
+    std::size_t claseTamano(std::size_t bytes) {
+        if (bytes <= (std::size_t{1} << bitsMinimo)) {
+            return 0;
+        }
+        const std::size_t bits = std::bit_width(bytes - 1) - 1; // 2^bits < bytes <= 2^(bits + 1)
+        const std::size_t paso = std::size_t{1} << (bits - bitsPasos);
+        const std::size_t pasos = (bytes - (std::size_t{1} << bits) + paso - 1) / paso;
+        return 1 + (bits - bitsMinimo) * pasosPorPotencia + pasos - 1;
+    }
+
+    // Funcion que escribe la clase en la cabecera de un trozo y devuelve la memoria que sigue a la cabecera
+    void *conCabecera(void *trozo, std::size_t clase) {
+        std::memcpy(trozo, &clase, sizeof(clase));
+        return static_cast<std::byte *>(trozo) + tamanoCabecera;
+    }
+
+    // Bytes de los trozos de una clase
+    std::size_t tamanoClase(std::size_t clase) {
+        if (clase == 0) {
+            return std::size_t{1} << bitsMinimo;
+        }
+        const std::size_t bits = bitsMinimo + (clase - 1) / pasosPorPotencia;
+        const std::size_t pasos = (clase - 1) % pasosPorPotencia + 1;
+        return (std::size_t{1} << bits) + pasos * (std::size_t{1} << (bits - bitsPasos));
+    }
+
+    // Funcion que reserva una region con mmap, intentando respaldarla con paginas grandes segun el modo
+    std::byte *reservarRegion(std::size_t bytes) {
+        void *region = MAP_FAILED;
+        if (modoPaginas.load(std::memory_order_relaxed) == PoolParticulas::PaginasGrandes::explicitas) {
+            region = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (region == MAP_FAILED) {
+            region = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (region == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            ::madvise(region, bytes, MADV_HUGEPAGE);
+        }
+        listasLibres.rangos.emplace_back(static_cast<std::byte *>(region), bytes);
+        return static_cast<std::byte *>(region);
+    }
+
+    // Funcion que corta un trozo de la region actual (si no cabe, empieza una region nueva). Se llama con el mutex
+    void *trozoDeRegion(std::size_t tamano) {
+        if (tamano > listasLibres.restante) {
+            const std::size_t paginas = (tamano + tamanoPaginaGrande - 1) / tamanoPaginaGrande;
+            const std::size_t bytes = std::max(tamanoRegion, paginas * tamanoPaginaGrande);
+            listasLibres.region = reservarRegion(bytes);
+            listasLibres.restante = bytes;
+        }
+        void *trozo = listasLibres.region;
+        listasLibres.region += tamano;
+        listasLibres.restante -= tamano;
+        return trozo;
+    }
+
+    // Funcion que pide un trozo nuevo al sistema (o a la region actual, con paginas grandes). Se llama con el mutex
+    void *trozoDelSistema(std::size_t tamano) {
+#ifndef NDEBUG
+        reservasSistema.fetch_add(1, std::memory_order_relaxed);
+#endif
+        void *trozo = modoPaginas.load(std::memory_order_relaxed) != PoolParticulas::PaginasGrandes::ninguna
+                              ? trozoDeRegion(tamano) : ::operator new(tamano);
+        listasLibres.bytesSistema += tamano;
+        listasLibres.bytesEnUso += tamano;
+        ++listasLibres.trozosEnUso;
+        return trozo;
+    }
+}
+
+
+namespace PoolParticulas {
+    // Funcion que reserva un trozo, reutilizando uno libre de la misma clase o de las siguientes si lo hay. El trozo
+    // empieza con una cabecera con su clase, asi al liberarlo vuelve a su lista aunque sea mayor que lo pedido
+    void *reservar(std::size_t bytes) {
+        const std::size_t clase = claseTamano(bytes + tamanoCabecera);
+        if (clase >= numClases) {
+            throw std::bad_alloc();
+        }
+        const std::scoped_lock bloqueo(listasLibres.mutex);
+        const std::size_t ultima = std::min(numClases, clase + clasesMayores + 1);
+        for (std::size_t libre = clase; libre < ultima; ++libre) {
+            TrozoLibre *&lista = listasLibres.listas.at(libre);
+            if (lista != nullptr) {
+                TrozoLibre *trozo = lista;
+                lista = trozo->siguiente;
+                listasLibres.bytesEnUso += tamanoClase(libre);
+                ++listasLibres.trozosEnUso;
+                return conCabecera(trozo, libre);
+            }
+        }
+        return conCabecera(trozoDelSistema(tamanoClase(clase)), clase);
+    }
+
+    // Funcion que devuelve un trozo a la lista de su clase (o al sistema si el programa ya esta terminando)
+    void liberar(void *puntero, std::size_t /*bytes*/) noexcept {
+        if (puntero == nullptr) {
+            return;
+        }
+        auto *trozo = static_cast<std::byte *>(puntero) - tamanoCabecera;
+        std::size_t clase = 0;
+        std::memcpy(&clase, trozo, sizeof(clase));
+        const std::scoped_lock bloqueo(listasLibres.mutex);
+        if (!listasLibres.activa) {
+            listasLibres.liberarSistema(trozo);
+            return;
+        }
+        listasLibres.bytesEnUso -= tamanoClase(clase);
+        --listasLibres.trozosEnUso;
+        TrozoLibre *&lista = listasLibres.listas.at(clase);
+        lista = new(trozo) TrozoLibre{lista};
+    }
+
+    Huella huella() {
+        const std::scoped_lock bloqueo(listasLibres.mutex);
+        return {listasLibres.bytesSistema, listasLibres.bytesEnUso, listasLibres.trozosEnUso};
+    }
+
+    void configurarPaginasGrandes(PaginasGrandes modo) {
+        modoPaginas.store(modo, std::memory_order_relaxed);
+    }
+
+    std::size_t numReservasSistema() {
+#ifndef NDEBUG
+        return reservasSistema.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_ASIGNADOR_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_ASIGNADOR_HPP
+
+#include <cstddef>
+
+// Pool de memoria para el almacenamiento de particulas. Los trozos liberados se guardan en listas por tamaño (cuatro
+// clases entre cada potencia de dos y la siguiente) compartidas por todos los hilos y se reutilizan en la siguiente
+// reserva, asi en regimen estacionario no se llama a malloc
+namespace PoolParticulas {
+    void *reservar(std::size_t bytes);
+
+    void liberar(void *puntero, std::size_t bytes) noexcept;
+
+    // Memoria del pool: bytes de todos los trozos pedidos al sistema (no se le devuelven) y bytes y numero de los que
+    // estan en uso (con su cabecera y su redondeo a la clase). La diferencia son los trozos libres
+    struct Huella {
+        std::size_t bytesSistema;
+        std::size_t bytesEnUso;
+        std::size_t trozosEnUso;
+    };
+
+    Huella huella();
+
+    // Numero de reservas que no se han podido servir desde el pool (solo se cuentan sin NDEBUG)
+    std::size_t numReservasSistema();
+
+    // Con paginas grandes, los trozos nuevos se cortan de regiones de memoria (multiplos de 2 MiB, reservadas con
+    // mmap) respaldadas por paginas grandes transparentes (madvise) o explicitas (MAP_HUGETLB, si el sistema no tiene
+    // reservadas se usan las transparentes). Las particulas de muchos bloques comparten asi pocas paginas
+    enum class PaginasGrandes { ninguna, transparentes, explicitas };
+
+    void configurarPaginasGrandes(PaginasGrandes modo);
+}
+
+// Asignador sin estado que obtiene la memoria del pool, para usarlo con los contenedores de la STL
+template <typename T>
+class AsignadorParticulas {
+public:
+    using value_type = T;
+
+    AsignadorParticulas() = default;
+
+    // Conversion implicita entre asignadores de distintos tipos, como exige la STL
+    template <typename U>
+    AsignadorParticulas(const AsignadorParticulas<U> & /*otro*/) noexcept {}  // NOLINT(hicpp-explicit-conversions)
+
+    T *allocate(std::size_t numero) {
+        return static_cast<T *>(PoolParticulas::reservar(numero * sizeof(T)));
+    }
+
+    void deallocate(T *puntero, std::size_t numero) noexcept {
+        PoolParticulas::liberar(puntero, numero * sizeof(T));
+    }
+
+    friend bool operator==(const AsignadorParticulas & /*a*/, const AsignadorParticulas & /*b*/) { return true; }
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_ASIGNADOR_HPP
@@ -2,6 +2,7 @@
 #define PROYECTO_RENDIMIENTO_ARQUITECTURA_BLOCK_HPP
 
 #include <vector>
+#include "sim/asignador.hpp"
 
 
 struct Punto {
@@ -29,13 +30,33 @@ struct Particle {
     }
 };
 
+// Vector de particulas de un bloque, con la memoria obtenida del pool de particulas
+using VectorParticulas = std::vector<Particle, AsignadorParticulas<Particle>>;
+
+// Par de particulas que interactuan, anotado por la etapa de densidades (con --pair-list): posicion de la vecina
+// (bloque, relativo al de la particula, e indice en el) y la distancia y su inversa, que la aceleracion usa sin
+// volver a calcularlas. El bloque es relativo para que siga valiendo si el vector de bloques se desplaza entre las
+// dos etapas (en la ventana de --out-of-core)
+struct ParVecino {
+    int desplazamiento;
+    int indice;
+    double distancia;
+    double inversaDistancia;
+};
+
 class Block {
 public:
     Block();
 
     int id;
     int cx, cy, cz; // Indice del bloque en cada coordenada
-    std::vector<Particle> particles;
+    VectorParticulas particles;
+    std::vector<double> inversasDensidad; // Solo con el nucleo rapido: 1/densidad de cada particula, en su orden
+    std::vector<ParVecino> pares; // Solo con --pair-list: pares de cada particula, seguidos y en su orden
+    std::vector<int> finPares; // Posicion en "pares" tras el ultimo par de cada particula
+    // Solo con --sleep: no se recalculan sus densidades ni sus aceleraciones. Es una copia del estado de Reposo, que
+    // la fija en cada iteracion tras reposicionar (ver reposo.hpp)
+    bool dormido{false};
 
     Block(int id, int cx, int cy, int cz);
 
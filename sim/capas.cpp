@@ -0,0 +1,502 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "capas.hpp"
+#include "grid.hpp"
+#include "nucleos.hpp"
+#include "paralelo.hpp"
+#include "simulacion.hpp"
+
+
+//NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+namespace {
+    constexpr std::size_t bytesCabecera = sizeof(float) + sizeof(int); // Particulas por metro y numero de particulas
+    constexpr int permisosFichero = 0644;
+
+    // Particula tal y como se guarda en los ficheros de capas: lo que se conserva de una iteracion a la siguiente y
+    // el bloque (en la malla densa) al que va
+    struct ParticulaDisco {
+        int id;
+        int idBloque;
+        double px, py, pz;
+        double hvx, hvy, hvz;
+        double vx, vy, vz;
+    };
+
+    // Campos de una particula en el fichero .fld, en su orden
+    constexpr std::array<double ParticulaDisco::*, 9> camposFld = {
+            &ParticulaDisco::px, &ParticulaDisco::py, &ParticulaDisco::pz, &ParticulaDisco::hvx, &ParticulaDisco::hvy,
+            &ParticulaDisco::hvz, &ParticulaDisco::vx, &ParticulaDisco::vy, &ParticulaDisco::vz};
+
+    using CamposFld = std::array<float, camposFld.size()>;
+
+    ParticulaDisco aDisco(const Particle &particula, int idBloque) {
+        return ParticulaDisco{particula.id, idBloque, particula.px, particula.py, particula.pz, particula.hvx,
+                              particula.hvy, particula.hvz, particula.vx, particula.vy, particula.vz};
+    }
+
+    // Particula lista para una iteracion (con la densidad a cero y la aceleracion de la gravedad)
+    Particle desdeDisco(const ParticulaDisco &guardada) {
+        return Particle{guardada.id, guardada.idBloque, guardada.px, guardada.py, guardada.pz, guardada.hvx,
+                        guardada.hvy, guardada.hvz, guardada.vx, guardada.vy, guardada.vz, Constantes::gravedad.x,
+                        Constantes::gravedad.y, Constantes::gravedad.z, 0.0};
+    }
+
+    [[noreturn]] void errorSistema(const std::string &operacion) {
+        throw std::runtime_error("Error: " + operacion + " failed: " + std::strerror(errno));
+    }
+
+    // Proyeccion compartida de un fichero en memoria (lo que se escribe llega al fichero)
+    class Proyeccion {
+    public:
+        Proyeccion(int descriptor, std::size_t bytes, bool escritura) : bytes(bytes) {
+            if (bytes == 0) {
+                return;
+            }
+            void *region = ::mmap(nullptr, bytes, escritura ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                                  descriptor, 0);
+            if (region == MAP_FAILED) {
+                errorSistema("mmap");
+            }
+            datos = static_cast<std::byte *>(region);
+        }
+
+        ~Proyeccion() {
+            if (datos != nullptr) {
+                ::munmap(datos, bytes);
+            }
+        }
+
+        Proyeccion(const Proyeccion &) = delete;
+
+        Proyeccion &operator=(const Proyeccion &) = delete;
+
+        Proyeccion(Proyeccion &&) = delete;
+
+        Proyeccion &operator=(Proyeccion &&) = delete;
+
+        [[nodiscard]] std::byte *getDatos() const { return datos; }
+
+        // Da un consejo al sistema sobre [desde, desde + longitud), ampliado a paginas completas
+        void aconsejar(std::size_t desde, std::size_t longitud, int consejo) const {
+            const auto pagina = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            const std::size_t inicio = desde / pagina * pagina;
+            if (longitud > 0) {
+                ::madvise(datos + inicio, desde + longitud - inicio, consejo);
+            }
+        }
+
+    private:
+        std::byte *datos{nullptr};
+        std::size_t bytes;
+    };
+
+    // Crea un fichero temporal sin nombre (se borra al cerrarlo) de "bytes" bytes en el directorio
+    int crearTemporal(const std::string &directorio, std::size_t bytes) {
+        const int descriptor = ::open(directorio.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, permisosFichero);
+        if (descriptor < 0) {
+            errorSistema("creating a temporary file in " + directorio);
+        }
+        if (::ftruncate(descriptor, static_cast<off_t>(bytes)) != 0) {
+            ::close(descriptor);
+            errorSistema("ftruncate");
+        }
+        return descriptor;
+    }
+
+    // Fichero temporal con sitio para todas las particulas, guardadas seguidas capa a capa
+    class FicheroCapas {
+    public:
+        FicheroCapas(const std::string &directorio, std::size_t capacidad, int numCapas)
+                : descriptor(crearTemporal(directorio, std::max<std::size_t>(capacidad, 1) * sizeof(ParticulaDisco))),
+                  proyeccion(descriptor, std::max<std::size_t>(capacidad, 1) * sizeof(ParticulaDisco), true),
+                  inicios(numCapas, 0), cantidades(numCapas, 0) {}
+
+        ~FicheroCapas() { ::close(descriptor); }
+
+        FicheroCapas(const FicheroCapas &) = delete;
+
+        FicheroCapas &operator=(const FicheroCapas &) = delete;
+
+        FicheroCapas(FicheroCapas &&) = delete;
+
+        FicheroCapas &operator=(FicheroCapas &&) = delete;
+
+        [[nodiscard]] std::span<const ParticulaDisco> capa(int numero) const {
+            return {particulas() + inicios[numero], cantidades[numero]};
+        }
+
+        // Escritura de una capa al final de las anteriores (las capas se escriben en orden)
+        void abrirCapa(int numero) {
+            inicios[numero] = inicios[std::max(numero - 1, 0)] + (numero > 0 ? cantidades[numero - 1] : 0);
+            cantidades[numero] = 0;
+        }
+
+        void anadir(int numero, const ParticulaDisco &particula) {
+            particulas()[inicios[numero] + cantidades[numero]++] = particula;
+        }
+
+        // Reserva el sitio de cada capa para escribirlas en cualquier orden con "anadir"
+        void repartir(const std::vector<std::size_t> &tamanos) {
+            for (std::size_t numero = 0; numero < tamanos.size(); ++numero) {
+                inicios[numero] = numero == 0 ? 0 : inicios[numero - 1] + tamanos[numero - 1];
+                cantidades[numero] = 0;
+            }
+        }
+
+        // Pide al sistema que lea la capa por adelantado, sin esperar
+        void anticipar(int numero) const { aconsejarCapa(numero, MADV_WILLNEED); }
+
+        // Deja de tener la capa en memoria. Si se acaba de escribir, antes empieza a escribirla en el fichero (sin
+        // esperar; lo que no se haya escrito sigue en la cache del sistema)
+        void liberar(int numero, bool escrita) const {
+            if (escrita && cantidades[numero] > 0) {
+                ::sync_file_range(descriptor, static_cast<off_t>(inicios[numero] * sizeof(ParticulaDisco)),
+                                  static_cast<off_t>(cantidades[numero] * sizeof(ParticulaDisco)),
+                                  SYNC_FILE_RANGE_WRITE);
+            }
+            aconsejarCapa(numero, MADV_DONTNEED);
+        }
+
+    private:
+        int descriptor;
+        Proyeccion proyeccion;
+        std::vector<std::size_t> inicios;
+        std::vector<std::size_t> cantidades;
+
+        [[nodiscard]] ParticulaDisco *particulas() const {
+            return reinterpret_cast<ParticulaDisco *>(proyeccion.getDatos());
+        }
+
+        void aconsejarCapa(int numero, int consejo) const {
+            proyeccion.aconsejar(inicios[numero] * sizeof(ParticulaDisco), cantidades[numero] * sizeof(ParticulaDisco),
+                                 consejo);
+        }
+    };
+
+    // Particulas que pasan a una capa desde las capas de menor x y desde las de mayor x, en el orden en que se guardan
+    struct Migrantes {
+        std::vector<ParticulaDisco> desdeAbajo;
+        std::vector<ParticulaDisco> desdeArriba;
+    };
+
+    class SimulacionPorCapas {
+    public:
+        SimulacionPorCapas(Grid &malla, const ParametrosSimulacion &parametros, const std::string &directorio,
+                           std::size_t numParticulas);
+
+        // Reparte por capas las particulas del fichero .fld proyectado (en el orden del fichero)
+        void cargarEntrada(const std::byte *entrada, std::size_t numParticulas);
+
+        void iterar();
+
+        // Escribe cada particula en su posicion (por id) del fichero .fld proyectado
+        void escribirSalida(std::byte *salida) const;
+
+    private:
+        Grid &malla;
+        const ParametrosSimulacion &parametros;
+        int alcance; // Capas a las que llegan las interacciones de una capa
+        int numCapas;
+        int bloquesPorCapa;
+        std::vector<Block> ventana;
+        std::unique_ptr<FicheroCapas> lectura;
+        std::unique_ptr<FicheroCapas> escritura;
+        std::vector<Migrantes> entrantes; // Los que se colocan en esta iteracion
+        std::vector<Migrantes> salientes; // Los que se colocaran en la siguiente
+
+        void cargarCapa(int capa);
+
+        void guardarCapa(int capa);
+
+        template <typename Funcion>
+        void paraCadaBloqueCapa(int capa, Funcion &&funcion) {
+            if (capa < 0 || capa >= numCapas) {
+                return;
+            }
+            const int primero = (capa - malla.getCapaBase()) * bloquesPorCapa;
+            for (int indice = primero; indice < primero + bloquesPorCapa; ++indice) {
+                funcion(indice);
+            }
+        }
+    };
+
+
+    SimulacionPorCapas::SimulacionPorCapas(Grid &malla, const ParametrosSimulacion &parametros,
+                                           const std::string &directorio, std::size_t numParticulas)
+            : malla(malla), parametros(parametros), alcance(malla.getSubdivision()),
+              numCapas(static_cast<int>(malla.getNumberblocksx())),
+              bloquesPorCapa(static_cast<int>(malla.getNumberblocksy() * malla.getNumberblocksz())),
+              lectura(std::make_unique<FicheroCapas>(directorio, numParticulas, numCapas)),
+              escritura(std::make_unique<FicheroCapas>(directorio, numParticulas, numCapas)),
+              entrantes(numCapas), salientes(numCapas) {}
+
+
+    // Lee la particula "indice" del fichero .fld (en memoria) y la asigna al bloque en el que esta
+    ParticulaDisco leerParticula(const std::byte *entrada, std::size_t indice, const Grid &malla) {
+        CamposFld campos{};
+        std::memcpy(campos.data(), entrada + bytesCabecera + indice * sizeof(CamposFld), sizeof(CamposFld));
+        ParticulaDisco particula{static_cast<int>(indice), 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        for (std::size_t campo = 0; campo < camposFld.size(); ++campo) {
+            particula.*camposFld[campo] = static_cast<double>(campos[campo]);
+        }
+        particula.idBloque = malla.indiceBloqueParticula(desdeDisco(particula));
+        return particula;
+    }
+
+
+    // Dos pasadas por la entrada: la primera cuenta las particulas de cada capa y la segunda las coloca
+    void SimulacionPorCapas::cargarEntrada(const std::byte *entrada, std::size_t numParticulas) {
+        std::vector<std::size_t> tamanos(numCapas, 0);
+        for (std::size_t indice = 0; indice < numParticulas; ++indice) {
+            ++tamanos[leerParticula(entrada, indice, malla).idBloque / bloquesPorCapa];
+        }
+        lectura->repartir(tamanos);
+        for (std::size_t indice = 0; indice < numParticulas; ++indice) {
+            const ParticulaDisco particula = leerParticula(entrada, indice, malla);
+            lectura->anadir(particula.idBloque / bloquesPorCapa, particula);
+        }
+        for (int capa = 0; capa < numCapas; ++capa) {
+            lectura->liberar(capa, true);
+        }
+    }
+
+
+    // En el paso k se carga la capa k, se calculan las densidades de la capa k - alcance (sus vecinas ya estan), las
+    // aceleraciones de la capa k - 2·alcance (sus vecinas ya tienen la densidad) y se mueve y se guarda la capa
+    // k - 3·alcance (ninguna capa que falte por calcular lee sus particulas)
+    void SimulacionPorCapas::iterar() {
+        malla.prepararVentana(ventana, 0);
+        const auto capasVentana = static_cast<int>(ventana.size()) / bloquesPorCapa;
+        const Punto numBloques{malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz()};
+        for (int paso = 0; paso < numCapas + 3 * alcance; ++paso) {
+            if (paso < numCapas) {
+                if (paso >= capasVentana) {
+                    malla.avanzarVentana(ventana);
+                }
+                cargarCapa(paso);
+            }
+            paraCadaBloqueCapa(paso - alcance, [&](int indice) {
+                densidadesBloque(ventana, indice, parametros, malla);
+                transformarDensidadesBloque(ventana[indice], parametros);
+            });
+            paraCadaBloqueCapa(paso - 2 * alcance, [&](int indice) {
+                aceleracionesBloque(ventana, indice, parametros, malla);
+            });
+            paraCadaBloqueCapa(paso - 3 * alcance, [&](int indice) {
+                colisionesBloque(ventana[indice], numBloques, Constantes::pasoTiempo, alcance);
+                movimientoBloque(ventana[indice], Constantes::pasoTiempo);
+                limitesBloque(ventana[indice], numBloques, alcance);
+            });
+            if (paso - 3 * alcance >= 0 && paso - 3 * alcance < numCapas) {
+                guardarCapa(paso - 3 * alcance);
+            }
+        }
+        std::swap(lectura, escritura);
+        std::swap(entrantes, salientes);
+    }
+
+
+    // Coloca en sus bloques las particulas de la capa en el orden en que las reposiciona la version en memoria: las
+    // que vienen de capas anteriores, las que ya estaban en la capa y las que vienen de capas posteriores
+    void SimulacionPorCapas::cargarCapa(int capa) {
+        const int primero = malla.getCapaBase() * bloquesPorCapa;
+        const auto colocar = [&](const ParticulaDisco &particula) {
+            ventana[particula.idBloque - primero].addParticle(desdeDisco(particula));
+        };
+        std::ranges::for_each(entrantes[capa].desdeAbajo, colocar);
+        std::ranges::for_each(lectura->capa(capa), colocar);
+        std::ranges::for_each(entrantes[capa].desdeArriba, colocar);
+        entrantes[capa].desdeAbajo.clear();
+        entrantes[capa].desdeArriba.clear();
+        lectura->liberar(capa, false);
+        if (capa + 1 < numCapas) {
+            lectura->anticipar(capa + 1);
+        }
+    }
+
+
+    // Guarda las particulas de la capa (ya movidas) con el bloque al que van: las que siguen en la capa en el fichero
+    // de escritura y las que pasan a otra capa en memoria
+    void SimulacionPorCapas::guardarCapa(int capa) {
+        escritura->abrirCapa(capa);
+        paraCadaBloqueCapa(capa, [&](int indice) {
+            for (const Particle &particula: ventana[indice].particles) {
+                const int destino = malla.indiceBloqueParticula(particula);
+                const int capaDestino = destino / bloquesPorCapa;
+                if (capaDestino == capa) {
+                    escritura->anadir(capa, aDisco(particula, destino));
+                } else {
+                    Migrantes &migrantes = salientes[capaDestino];
+                    (capaDestino > capa ? migrantes.desdeAbajo : migrantes.desdeArriba).push_back(
+                            aDisco(particula, destino));
+                }
+            }
+            ventana[indice].particles.clear();
+        });
+        escritura->liberar(capa, true);
+    }
+
+
+    void SimulacionPorCapas::escribirSalida(std::byte *salida) const {
+        const auto escribir = [salida](const ParticulaDisco &particula) {
+            CamposFld campos{};
+            for (std::size_t campo = 0; campo < camposFld.size(); ++campo) {
+                campos[campo] = static_cast<float>(particula.*camposFld[campo]);
+            }
+            std::memcpy(salida + bytesCabecera + static_cast<std::size_t>(particula.id) * sizeof(CamposFld),
+                        campos.data(), sizeof(CamposFld));
+        };
+        for (int capa = 0; capa < numCapas; ++capa) {
+            std::ranges::for_each(entrantes[capa].desdeAbajo, escribir);
+            std::ranges::for_each(lectura->capa(capa), escribir);
+            std::ranges::for_each(entrantes[capa].desdeArriba, escribir);
+        }
+    }
+
+
+    // Funcion que lee la cabecera del fichero .fld y comprueba que tiene tantas particulas como dice
+    Constantes::ErrorCode leerCabecera(const Proyeccion &entrada, std::size_t bytes, Fluid &fluid) {
+        if (bytes >= bytesCabecera) {
+            std::memcpy(&fluid.particlespermeter, entrada.getDatos(), sizeof(float));
+            std::memcpy(&fluid.numberparticles, entrada.getDatos() + sizeof(float), sizeof(int));
+        }
+        if (fluid.numberparticles <= 0) {
+            std::cerr << "Error: Invalid number of particles: 0.\n";
+            return Constantes::ErrorCode::INVALID_PARTICLE_COUNT;
+        }
+        if (bytes != bytesCabecera + static_cast<std::size_t>(fluid.numberparticles) * sizeof(CamposFld)) {
+            std::cerr << "Error: Number of particles mismatch\n";
+            return Constantes::ErrorCode::INVALID_PARTICLE_COUNT;
+        }
+        return Constantes::ErrorCode::NO_ERROR;
+    }
+
+
+    // Funcion que escribe el estado final en el fichero de salida, proyectado en memoria
+    Constantes::ErrorCode guardarSalida(const Argumentos &argumentos, const Fluid &fluid,
+                                        const SimulacionPorCapas &simulacion) {
+        const int descriptor = ::open(argumentos.archivoSalida.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                      permisosFichero);
+        if (descriptor < 0) {
+            std::cerr << "Error: Cannot open " << argumentos.archivoSalida << " for writing\n";
+            return Constantes::ErrorCode::CANNOT_OPEN_FILE_WRITING;
+        }
+        const std::size_t bytes = bytesCabecera + static_cast<std::size_t>(fluid.numberparticles) * sizeof(CamposFld);
+        if (::ftruncate(descriptor, static_cast<off_t>(bytes)) != 0) {
+            ::close(descriptor);
+            errorSistema("ftruncate " + argumentos.archivoSalida);
+        }
+        {
+            const Proyeccion salida(descriptor, bytes, true);
+            const auto particulasPorMetro = static_cast<float>(fluid.particlespermeter);
+            std::memcpy(salida.getDatos(), &particulasPorMetro, sizeof(float));
+            std::memcpy(salida.getDatos() + sizeof(float), &fluid.numberparticles, sizeof(int));
+            simulacion.escribirSalida(salida.getDatos());
+        }
+        ::close(descriptor);
+        std::cout << "Simulación completada. Estado final del fluido guardado en: " << argumentos.archivoSalida << "\n";
+        return Constantes::ErrorCode::NO_ERROR;
+    }
+
+
+    Constantes::ErrorCode simularFichero(int descriptor, const Argumentos &argumentos) {
+        struct stat estado{};
+        const auto bytes = ::fstat(descriptor, &estado) == 0 ? static_cast<std::size_t>(estado.st_size) : 0;
+        const Proyeccion entrada(descriptor, bytes, false);
+        Fluid fluid; // Solo la cabecera: las particulas se quedan en el fichero
+        const Constantes::ErrorCode errorCode = leerCabecera(entrada, bytes, fluid);
+        if (errorCode != Constantes::ErrorCode::NO_ERROR) {
+            return errorCode;
+        }
+        Grid malla(Constantes::limInferior, Constantes::limSuperior);
+        malla.setSubdivision(argumentos.opciones.subdivision);
+        malla.setVentana(3 * malla.getSubdivision() + 1);
+        auto result = malla.simular_malla(fluid);
+        const ParametrosSimulacion parametros = calcularParametros(result.first, result.second, argumentos.opciones);
+        if (parametros.nucleo == ModoNucleo::rapido) {
+            Nucleos::mostrarInforme(std::cout, parametros.constAccTransf);
+        }
+        const auto numParticulas = static_cast<std::size_t>(fluid.numberparticles);
+        SimulacionPorCapas simulacion(malla, parametros, argumentos.opciones.directorioCapas, numParticulas);
+        simulacion.cargarEntrada(entrada.getDatos(), numParticulas);
+        for (int iter = 0; iter < argumentos.iteraciones; ++iter) {
+            simulacion.iterar();
+        }
+        return guardarSalida(argumentos, fluid, simulacion);
+    }
+}
+//NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+
+
+namespace {
+    // Una opcion que la simulacion por capas no tiene: su nombre y la funcion que dice si se ha dado
+    struct OpcionNoAdmitida {
+        std::string_view nombre;
+        bool (*usada)(const Opciones &opciones);
+    };
+
+    const auto opcionesNoAdmitidas = std::to_array<OpcionNoAdmitida>({
+        {"--ranks", [](const Opciones &opciones) { return opciones.rangos > 1; }},
+        {"--threads", [](const Opciones &opciones) { return opciones.hilos > 0; }},
+        {"--task-graph", [](const Opciones &opciones) { return opciones.grafoTareas; }},
+        {"--sparse", [](const Opciones &opciones) { return opciones.mallaDispersa; }},
+        {"--sort-every", [](const Opciones &opciones) { return opciones.intervaloOrden > 0; }},
+        {"--sleep", [](const Opciones &opciones) { return opciones.umbralReposo > 0.0; }},
+        {"--engine", [](const Opciones &opciones) { return !opciones.motor.empty(); }},
+        {"--cross-check", [](const Opciones &opciones) { return opciones.contraste; }},
+        {"--telemetry", [](const Opciones &opciones) { return opciones.intervaloTelemetria > 0; }},
+        {"--stage-times", [](const Opciones &opciones) { return !opciones.ficheroTiempos.empty(); }},
+        {"--trace", [](const Opciones &opciones) { return !opciones.ficheroTraza.empty(); }},
+        {"--memory-stats", [](const Opciones &opciones) { return !opciones.ficheroMemoria.empty(); }},
+        {"--roofline", [](const Opciones &opciones) { return !opciones.ficheroRoofline.empty(); }},
+    });
+
+    // Funcion que comprueba que no se ha dado ninguna opcion que la simulacion por capas ignoraria
+    bool opcionesAdmitidas(const Opciones &opciones) {
+        if (opciones.tiempoObjetivo > 0.0) {
+            std::cerr << "Error: --out-of-core only supports a fixed time step (--time is not supported)\n";
+            return false;
+        }
+        for (const OpcionNoAdmitida &opcion: opcionesNoAdmitidas) {
+            if (opcion.usada(opciones)) {
+                std::cerr << "Error: --out-of-core does not support " << opcion.nombre << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+Constantes::ErrorCode ejecutarPorCapas(const Argumentos &argumentos) {
+    if (!opcionesAdmitidas(argumentos.opciones)) {
+        return Constantes::ErrorCode::INVALID_ARGUMENTS;
+    }
+    const int descriptor = ::open(argumentos.archivoEntrada.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        std::cerr << "Error: Cannot open " << argumentos.archivoEntrada << " for reading\n";
+        return Constantes::ErrorCode::CANNOT_OPEN_FILE_READING;
+    }
+    Constantes::ErrorCode errorCode = Constantes::ErrorCode::NO_ERROR;
+    try {
+        errorCode = simularFichero(descriptor, argumentos);
+    } catch (const std::runtime_error &e) { // Fallos al crear, proyectar o ampliar los ficheros
+        std::cerr << e.what() << "\n";
+        errorCode = Constantes::ErrorCode::CANNOT_OPEN_FILE_WRITING;
+    }
+    ::close(descriptor);
+    return errorCode;
+}
@@ -0,0 +1,22 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_CAPAS_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_CAPAS_HPP
+
+#include "sim/constantes.hpp"
+#include "sim/progargs.hpp"
+
+// Simulacion fuera de memoria (--out-of-core=directorio): las particulas se guardan en dos ficheros temporales del
+// directorio, proyectados en memoria y ordenados por capas de bloques a lo largo del eje x (uno se lee y el otro se
+// escribe en cada iteracion). Cada iteracion recorre las capas en orden con una ventana de 3·subdivision + 1 capas en
+// memoria: al cargar una capa se calculan las densidades de la anterior, las aceleraciones de la de antes y se
+// mueve y se guarda la mas antigua, que ya nadie va a leer. El sistema lee por adelantado las capas siguientes y
+// escribe las guardadas mientras se calcula. Las particulas que pasan a otra capa esperan en memoria a que esa capa
+// se cargue en la siguiente iteracion, asi cada bloque recibe sus particulas en el mismo orden que al reposicionar
+// en memoria, y el resultado es el mismo que el de las versiones "gather" (o el de la version en serie con
+// --deterministic)
+
+// Lee la entrada (sin cargarla entera), simula las iteraciones y escribe la salida. Solo admite paso fijo, y con una
+// opcion que no tiene (ver capas.cpp) da error en vez de ignorarla
+Constantes::ErrorCode ejecutarPorCapas(const Argumentos &argumentos);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_CAPAS_HPP
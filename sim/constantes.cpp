@@ -10,6 +10,12 @@ namespace Constantes {
     const double tamParticula = 0.0002;
     const double pasoTiempo = 0.001;
 
+    const double factorCFL = 0.4;
+    const double pasoTiempoMaximo = 0.01;
+
+    const int pasosReposo = 10;
+    const double toleranciaContraste = 1e-9;
+
     const Gravedad gravedad = {0.0, -9.8, 0.0};
 
     const Punto limInferior = {-0.065, -0.08, -0.065};
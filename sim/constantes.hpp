@@ -14,6 +14,14 @@ namespace Constantes {
     extern const double tamParticula;
     extern const double pasoTiempo;
 
+    // Para el paso de tiempo adaptativo (por defecto)
+    extern const double factorCFL;
+    extern const double pasoTiempoMaximo;
+
+    // Pasos quietos que hacen falta para dormir un bloque con --sleep (por defecto)
+    extern const int pasosReposo;
+    extern const double toleranciaContraste;
+
     // Definición de la estructura del vector de gravedad
     struct Gravedad {
         double x;
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <span>
+#include "contraste.hpp"
+#include "paralelo.hpp"
+
+namespace {
+    using Campo = double Particle::*;
+
+    constexpr std::array<Campo, 1> camposDensidad = {&Particle::density};
+    constexpr std::array<Campo, 3> camposAceleracion = {&Particle::ax, &Particle::ay, &Particle::az};
+    constexpr std::array<Campo, 9> camposMovimiento = {&Particle::px, &Particle::py, &Particle::pz,
+                                                       &Particle::hvx, &Particle::hvy, &Particle::hvz,
+                                                       &Particle::vx, &Particle::vy, &Particle::vz};
+    constexpr double sinReferencia = std::numeric_limits<double>::infinity();
+
+    // Mayor diferencia relativa de unos campos y la particula en la que esta
+    struct Peor {
+        double diferencia;
+        int particula;
+    };
+
+    // Particula de la referencia con el mismo id (nullptr si no esta)
+    const Particle *buscar(const std::vector<const Particle *> &porId, int id) {
+        const auto indice = static_cast<std::size_t>(id);
+        return id >= 0 && indice < porId.size() ? porId[indice] : nullptr;
+    }
+
+    // Mayor valor absoluto de los campos en la referencia (la escala de las diferencias; 1 si todos son 0)
+    double escala(const std::vector<const Particle *> &porId, std::span<const Campo> campos) {
+        double maximo = 0.0;
+        for (const Particle *particle: porId) {
+            for (const Campo campo: campos) {
+                maximo = particle == nullptr ? maximo : std::max(maximo, std::abs(particle->*campo));
+            }
+        }
+        return maximo > 0.0 ? maximo : 1.0;
+    }
+
+    // Mayor diferencia de los campos entre cada particula y la de la referencia (infinita si no esta)
+    Peor diferenciaCampos(const std::vector<Block> &blocks, const std::vector<const Particle *> &porId,
+                          std::span<const Campo> campos) {
+        const double maximo = escala(porId, campos);
+        Peor peor{0.0, -1};
+        for (const Block &block: blocks) {
+            for (const Particle &particle: block.particles) {
+                const Particle *otra = buscar(porId, particle.id);
+                double diferencia = otra == nullptr ? sinReferencia : 0.0;
+                for (const Campo campo: campos) {
+                    diferencia = otra == nullptr ? diferencia
+                                                 : std::max(diferencia, std::abs(particle.*campo - otra->*campo));
+                }
+                diferencia /= maximo;
+                peor = diferencia > peor.diferencia ? Peor{diferencia, particle.id} : peor;
+            }
+        }
+        return peor;
+    }
+
+    std::size_t numParticulas(const std::vector<Block> &blocks) {
+        std::size_t particulas = 0;
+        for (const Block &block: blocks) {
+            particulas += block.particles.size();
+        }
+        return particulas;
+    }
+
+    // Id de una particula que no esta en el mismo bloque que en la referencia (-1 si estan todas)
+    int particulaFueraDeBloque(const std::vector<Block> &blocks, const std::vector<const Particle *> &porId,
+                               const std::vector<const Block *> &bloquePorId) {
+        for (const Block &block: blocks) {
+            for (const Particle &particle: block.particles) {
+                const Block *otro = buscar(porId, particle.id) == nullptr
+                                            ? nullptr : bloquePorId[static_cast<std::size_t>(particle.id)];
+                if (otro == nullptr || otro->cx != block.cx || otro->cy != block.cy || otro->cz != block.cz) {
+                    return particle.id;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // Nombre del motor con los ajustes que cambian su resultado, para el informe
+    std::string describirMotor(const Opciones &opciones) {
+        return nombreMotor(opciones) + " (kernel " + (opciones.nucleo == ModoNucleo::rapido ? "fast" : "exact") +
+               ", pair list " + (opciones.listaPares ? "on" : "off") + ", deterministic " +
+               (opciones.determinista ? "on" : "off") + ")";
+    }
+}
+
+
+Contraste::Contraste() = default;
+
+Contraste::~Contraste() = default;
+
+
+void Contraste::reiniciar(const Opciones &opciones) {
+    divergencia = {};
+    iteraciones = 0;
+    diferenciaMaxima = 0.0;
+    if (!opciones.contraste || opciones.grafoTareas) { // La linea de comandos no admite los dos
+        referencia.reset();
+        return;
+    }
+    motor = describirMotor(opciones);
+    tolerancia = opciones.toleranciaContraste;
+    if (!referencia) { // Sin preparar: sin tiempos, sin reposo y sin motores paralelos
+        referencia = std::make_unique<RecursosSimulacion>();
+        referencia->motor = crearMotor("scalar", Opciones{});
+    }
+}
+
+
+bool Contraste::activo() const {
+    return referencia != nullptr && !divergencia.encontrada;
+}
+
+
+void Contraste::ejecutar(const ContextoIteracion &contexto, Etapa etapa, int iter, double paso) {
+    if (!activo()) {
+        contexto.recursos.motor->ejecutar(contexto, etapa, paso);
+        return;
+    }
+    ParametrosSimulacion parametros = contexto.parametros;
+    parametros.nucleo = ModoNucleo::exacto;
+    parametros.listaPares = false;
+    parametros.determinista = false;
+    referencia->bloques = contexto.recursos.bloques;
+    for (Block &block: referencia->bloques) { // La referencia no tiene reposo: lo calcula todo
+        block.dormido = false;
+    }
+    // La referencia va antes: si la malla guarda estado al reposicionar, se queda con el del motor
+    referencia->motor->ejecutar({contexto.malla, contexto.opciones, parametros, *referencia}, etapa, paso);
+    contexto.recursos.motor->ejecutar(contexto, etapa, paso);
+    indexar(referencia->bloques);
+    const Divergencia encontrada = comparar(contexto.recursos.bloques, etapa);
+    iteraciones = iter + 1;
+    diferenciaMaxima = std::max(diferenciaMaxima, encontrada.diferencia);
+    if (encontrada.diferencia > tolerancia) {
+        divergencia = encontrada;
+        divergencia.encontrada = true;
+        divergencia.iteracion = iter + 1;
+        referencia->bloques.clear();
+    }
+}
+
+
+// Funcion que guarda en "porId" y "bloquePorId" las particulas de la referencia y sus bloques
+void Contraste::indexar(const std::vector<Block> &blocks) {
+    porId.assign(porId.size(), nullptr);
+    particulasReferencia = 0;
+    for (const Block &block: blocks) {
+        for (const Particle &particle: block.particles) {
+            const auto id = static_cast<std::size_t>(particle.id);
+            if (id >= porId.size()) {
+                porId.resize(id + 1, nullptr);
+                bloquePorId.resize(id + 1, nullptr);
+            }
+            porId[id] = &particle;
+            bloquePorId[id] = &block;
+            ++particulasReferencia;
+        }
+    }
+}
+
+
+// Funcion que compara los bloques con la referencia en los campos que cambia la etapa. En las interacciones se
+// comparan antes las densidades, asi una diferencia en ellas no se atribuye a las aceleraciones que dependen de ellas
+Contraste::Divergencia Contraste::comparar(const std::vector<Block> &blocks, Etapa etapa) const {
+    if (etapa == Etapa::interacciones) {
+        const Peor densidades = diferenciaCampos(blocks, porId, camposDensidad);
+        const Peor aceleraciones = diferenciaCampos(blocks, porId, camposAceleracion);
+        const bool enDensidades = densidades.diferencia > tolerancia ||
+                                  densidades.diferencia >= aceleraciones.diferencia;
+        const Peor &peor = enDensidades ? densidades : aceleraciones;
+        return {false, 0, enDensidades ? Etapa::densidades : Etapa::aceleraciones, peor.particula, peor.diferencia};
+    }
+    Peor peor = diferenciaCampos(blocks, porId, camposMovimiento);
+    if (numParticulas(blocks) != particulasReferencia) { // Falta alguna particula
+        peor = {sinReferencia, -1};
+    } else if (etapa == Etapa::reposicion) { // Ademas, cada particula tiene que estar en el mismo bloque
+        const int fuera = particulaFueraDeBloque(blocks, porId, bloquePorId);
+        peor = fuera < 0 ? peor : Peor{sinReferencia, fuera};
+    }
+    return {false, 0, etapa, peor.particula, peor.diferencia};
+}
+
+
+void Contraste::escribirInforme(std::ostream &salida) const {
+    if (referencia == nullptr) {
+        return;
+    }
+    if (divergencia.encontrada) {
+        salida << "Cross-check: engine " << motor << " diverges from scalar (kernel exact) at iteration " << divergencia.iteracion
+               << " in stage " << nombreEtapa(divergencia.etapa) << " (particle " << divergencia.particula
+               << ", relative difference " << divergencia.diferencia << " > tolerance " << tolerancia << ")\n";
+        return;
+    }
+    salida << "Cross-check: engine " << motor << " matches scalar (kernel exact) in " << iteraciones
+           << " iterations (max relative difference " << diferenciaMaxima << ", tolerance " << tolerancia << ")\n";
+}
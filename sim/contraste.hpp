@@ -0,0 +1,72 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_CONTRASTE_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_CONTRASTE_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "sim/motores.hpp"
+
+// Comprobacion cruzada (--cross-check): cada etapa del motor de la simulacion se ejecuta tambien con el motor de
+// referencia ("scalar" con el nucleo exacto y sin lista de pares ni reposo) sobre una copia de los bloques de antes
+// de la etapa, y se comparan por id las particulas de los dos. Como las dos parten siempre del mismo estado, una
+// diferencia se atribuye a la etapa en la que aparece y no se confunde con la que arrastran las anteriores. La
+// diferencia de cada campo es relativa al mayor valor absoluto de ese campo en la referencia. Al superar la
+// tolerancia se anota la iteracion, la etapa y la particula y se deja de comprobar
+class Contraste {
+public:
+    Contraste();
+    Contraste(const Contraste &) = delete;
+    Contraste &operator=(const Contraste &) = delete;
+    Contraste(Contraste &&) = delete;
+    Contraste &operator=(Contraste &&) = delete;
+    ~Contraste();
+
+    // Sin --cross-check (o con --task-graph, que no usa el motor en las etapas con vecinos y que la linea de comandos
+    // no admite con --cross-check) no se comprueba nada
+    void reiniciar(const Opciones &opciones);
+
+    [[nodiscard]] bool activo() const;
+
+    // Ejecuta la etapa ("reposicion", "interacciones" o "movimiento") con el motor de contexto.recursos y, si se
+    // comprueba, antes con el de referencia, y compara los resultados
+    void ejecutar(const ContextoIteracion &contexto, Etapa etapa, int iter, double paso);
+
+    [[nodiscard]] inline bool hayDivergencia() const { return divergencia.encontrada; }
+
+    // Etapa en la que se ha encontrado la primera diferencia (densidades, aceleraciones, reposicion o movimiento)
+    [[nodiscard]] inline Etapa getEtapaDivergencia() const { return divergencia.etapa; }
+
+    [[nodiscard]] inline int getIteracionDivergencia() const { return divergencia.iteracion; }
+
+    // Mayor diferencia relativa encontrada hasta ahora
+    [[nodiscard]] inline double getDiferenciaMaxima() const { return diferenciaMaxima; }
+
+    void escribirInforme(std::ostream &salida) const;
+
+private:
+    struct Divergencia {
+        bool encontrada{false};
+        int iteracion{0};
+        Etapa etapa{Etapa::total};
+        int particula{-1};
+        double diferencia{0.0};
+    };
+
+    std::unique_ptr<RecursosSimulacion> referencia; // Bloques y motor de referencia (nullptr = no se comprueba)
+    std::string motor; // Con el nucleo, la lista de pares y el modo determinista
+    double tolerancia{0.0};
+    int iteraciones{0}; // Iteraciones comprobadas
+    double diferenciaMaxima{0.0};
+    Divergencia divergencia;
+    std::vector<const Particle *> porId; // Particulas de la referencia por id
+    std::vector<const Block *> bloquePorId; // Y su bloque
+    std::size_t particulasReferencia{0};
+
+    void indexar(const std::vector<Block> &blocks);
+
+    [[nodiscard]] Divergencia comparar(const std::vector<Block> &blocks, Etapa etapa) const;
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_CONTRASTE_HPP
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "distribuido.hpp"
+#include "paralelo.hpp"
+#include "nucleos.hpp"
+#include "telemetria.hpp"
+
+
+namespace {
+    // Datos de una particula fantasma que necesitan las etapas con vecinos (la densidad se envia despues)
+    struct ParticulaHalo {
+        int id;
+        int idBloque;
+        double px, py, pz;
+        double vx, vy, vz;
+    };
+
+    template <typename T>
+    void anadir(std::vector<std::byte> &buffer, const T &valor) {
+        const std::size_t final = buffer.size();
+        buffer.resize(final + sizeof(T));
+        std::memcpy(buffer.data() + final, &valor, sizeof(T));
+    }
+
+    // Llama a funcion(elemento) con cada elemento de tipo T del mensaje
+    template <typename T, typename Funcion>
+    void paraCadaElemento(const std::vector<std::byte> &buffer, Funcion &&funcion) {
+        for (std::size_t desplazamiento = 0; desplazamiento + sizeof(T) <= buffer.size(); desplazamiento += sizeof(T)) {
+            T elemento{};
+            std::memcpy(&elemento, buffer.data() + desplazamiento, sizeof(T));
+            funcion(elemento);
+        }
+    }
+
+    // Parte de la malla de un rango: las capas [inicio, fin) del eje x, mas "ancho" capas fantasma a cada lado (las
+    // que alcanza la vecindad de un bloque, una por cada subdivision de la longitud de suavizado). Sus bloques son
+    // una ventana de la malla con solo esas capas, mientras existe el subdominio
+    class Subdominio {
+    public:
+        Subdominio(Grid &malla, const ParametrosSimulacion &parametros, Transporte &transporte);
+        Subdominio(const Subdominio &) = delete;
+        Subdominio &operator=(const Subdominio &) = delete;
+        Subdominio(Subdominio &&) = delete;
+        Subdominio &operator=(Subdominio &&) = delete;
+        ~Subdominio();
+
+        std::vector<Block> repartir(Fluid &fluid);
+
+        void reposicionar(std::vector<Block> &blocks);
+
+        // Ejecuta las etapas de la iteracion a partir del reposicionamiento y devuelve el paso usado
+        double iterar(std::vector<Block> &blocks, const Opciones &opciones, double tiempo);
+
+        std::vector<Block> reunir(const std::vector<Block> &blocks);
+
+    private:
+        Grid &malla;
+        const ParametrosSimulacion &parametros;
+        Transporte &transporte;
+        int rango;
+        int numRangos;
+        int numCapas;
+        int bloquesPorCapa;
+        int inicio;
+        int fin;
+        int ancho;
+        int base; // Primera capa de la ventana (la primera fantasma izquierda, si la hay)
+        std::vector<Block> buffer; // Segundo juego de bloques, se llena al reposicionar y se intercambia
+        std::vector<std::size_t> conteos; // Particulas que van a cada bloque al reposicionar
+        std::vector<std::vector<std::byte>> salidas; // Particulas que migran a cada rango
+        std::vector<std::byte> salida; // Resto de mensajes (halo, reducciones y resultado final)
+        std::vector<std::byte> entrada;
+
+        [[nodiscard]] int rangoDeCapa(int capa) const { return ((capa + 1) * numRangos - 1) / numCapas; }
+
+        // Posicion en la ventana del bloque con ese indice de la malla densa
+        [[nodiscard]] int posicion(int idBloque) const { return idBloque - base * bloquesPorCapa; }
+
+        [[nodiscard]] bool esPropio(int idBloque) const {
+            return idBloque >= inicio * bloquesPorCapa && idBloque < fin * bloquesPorCapa;
+        }
+
+        template <typename Funcion>
+        void paraCadaBloqueCapa(int capa, std::vector<Block> &blocks, Funcion &&funcion) const {
+            for (int indice = (capa - base) * bloquesPorCapa; indice < (capa - base + 1) * bloquesPorCapa; ++indice) {
+                funcion(blocks[indice]);
+            }
+        }
+
+        template <typename Funcion>
+        void paraCadaBloquePropio(Funcion &&funcion) const {
+            for (int indice = (inicio - base) * bloquesPorCapa; indice < (fin - base) * bloquesPorCapa; ++indice) {
+                funcion(indice);
+            }
+        }
+
+        void contar(std::span<const Particle> particulas);
+
+        void colocar(std::span<const Particle> particulas, std::vector<Block> &blocks, bool enviarAjenas);
+
+        void migrar(std::vector<Block> &blocks);
+
+        void enviarHalo(std::vector<Block> &blocks, bool soloDensidades);
+
+        void enviarCapas(std::vector<Block> &blocks, int desde, int destino, bool soloDensidades);
+
+        void recibirCapas(std::vector<Block> &blocks, int desde, bool soloDensidades);
+
+        void borrarFantasmas(std::vector<Block> &blocks) const;
+
+        double minimoGlobal(double valor);
+    };
+
+
+    Subdominio::Subdominio(Grid &malla, const ParametrosSimulacion &parametros, Transporte &transporte)
+            : malla(malla), parametros(parametros), transporte(transporte), rango(transporte.rango()),
+              numRangos(transporte.numRangos()), numCapas(static_cast<int>(malla.getNumberblocksx())),
+              bloquesPorCapa(static_cast<int>(malla.getNumberblocksy() * malla.getNumberblocksz())),
+              inicio(numCapas * rango / numRangos), fin(numCapas * (rango + 1) / numRangos),
+              ancho(malla.getSubdivision()), base(std::max(inicio - ancho, 0)),
+              salidas(static_cast<std::size_t>(numRangos)) {
+        if (malla.getDisperso() || numCapas / numRangos < ancho) {
+            throw std::invalid_argument("Distributed runs need a dense grid with at least one halo width of layers "
+                                        "per rank.");
+        }
+        malla.setVentana(std::min(fin + ancho, numCapas) - base);
+        malla.prepararVentana(buffer, base);
+        conteos.resize(buffer.size());
+    }
+
+
+    Subdominio::~Subdominio() {
+        malla.cerrarVentana();
+    }
+
+
+    // Funcion que crea los bloques de la ventana con las particulas de las capas propias. Al empezar todos los rangos
+    // leen el fluido entero, pero cada uno solo reserva y coloca las suyas
+    std::vector<Block> Subdominio::repartir(Fluid &fluid) {
+        const auto numero = static_cast<std::size_t>(fluid.numberparticles);
+        const std::span<const Particle> particulas = std::span<const Particle>(fluid.particles).first(numero);
+        std::vector<Block> blocks = buffer;
+        contar(particulas);
+        colocar(particulas, blocks, false);
+        std::vector<Particle>().swap(fluid.particles);
+        return blocks;
+    }
+
+
+    // Funcion que reposiciona las particulas de las capas propias. Las que salen de ellas se preparan a la vez para
+    // enviarlas a su dueño, asi pueden llegar a capas que no estan en la ventana
+    void Subdominio::reposicionar(std::vector<Block> &blocks) {
+        std::ranges::fill(conteos, 0);
+        for (const Block &block: blocks) {
+            contar(block.particles);
+        }
+        for (Block &block: blocks) {
+            colocar(block.particles, buffer, true);
+            VectorParticulas().swap(block.particles);
+        }
+        std::swap(blocks, buffer);
+    }
+
+
+    // Funcion que suma a "conteos" las particulas que van a cada bloque propio
+    void Subdominio::contar(std::span<const Particle> particulas) {
+        for (const Particle &particula: particulas) {
+            const int idBloque = malla.indiceBloqueParticula(particula);
+            if (esPropio(idBloque)) {
+                ++conteos[posicion(idBloque)];
+            }
+        }
+    }
+
+
+    // Funcion que coloca cada particula de las capas propias en su bloque (reservado entero con su conteo) y anade
+    // el resto a los mensajes para su dueño si "enviarAjenas", o las descarta si no
+    void Subdominio::colocar(std::span<const Particle> particulas, std::vector<Block> &blocks, bool enviarAjenas) {
+        for (const Particle &particula: particulas) {
+            const int idBloque = malla.indiceBloqueParticula(particula);
+            if (esPropio(idBloque)) {
+                Block &block = blocks[posicion(idBloque)];
+                block.particles.reserve(conteos[posicion(idBloque)]);
+                block.addParticle(particula);
+                block.particles.back().idBloque = idBloque;
+            } else if (enviarAjenas) {
+                Particle migrante = particula;
+                migrante.idBloque = idBloque;
+                anadir(salidas[rangoDeCapa(idBloque / bloquesPorCapa)], migrante);
+            }
+        }
+    }
+
+
+    double Subdominio::iterar(std::vector<Block> &blocks, const Opciones &opciones, double tiempo) {
+        migrar(blocks);
+        enviarHalo(blocks, false);
+        paraCadaBloquePropio([&](int indice) {
+            densidadesBloque(blocks, indice, parametros, malla);
+            transformarDensidadesBloque(blocks[indice], parametros);
+        });
+        enviarHalo(blocks, true);
+        if (parametros.nucleo == ModoNucleo::rapido) { // Los fantasmas reciben la densidad ya transformada
+            for (Block &block: blocks) {
+                if (block.cx < inicio || block.cx >= fin) {
+                    Nucleos::calcularInversas(block);
+                }
+            }
+        }
+        paraCadaBloquePropio([&](int indice) {
+            aceleracionesBloque(blocks, indice, parametros, malla);
+        });
+        borrarFantasmas(blocks);
+
+        // Con paso adaptativo, todos los rangos usan el menor de los pasos locales
+        double paso = Constantes::pasoTiempo;
+        if (opciones.tiempoObjetivo > 0.0) {
+            paso = std::min(minimoGlobal(calcularPasoAdaptativo(blocks, parametros.smoothingLength, opciones)),
+                            opciones.tiempoObjetivo - tiempo);
+        }
+        const Punto numBloques{malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz()};
+        paraCadaBloquePropio([&](int indice) {
+            colisionesBloque(blocks[indice], numBloques, paso, ancho);
+            movimientoBloque(blocks[indice], paso);
+            limitesBloque(blocks[indice], numBloques, ancho);
+        });
+        return paso;
+    }
+
+
+    // Funcion que envia a su dueño las particulas que al reposicionar han quedado fuera de las capas propias. El
+    // intercambio es de todos con todos en numRangos - 1 rondas: en la ronda k se envia a rango + k
+    void Subdominio::migrar(std::vector<Block> &blocks) {
+        for (int ronda = 1; ronda < numRangos; ++ronda) {
+            const int destino = (rango + ronda) % numRangos;
+            transporte.intercambiar(destino, salidas[destino], (rango - ronda + numRangos) % numRangos, entrada);
+            salidas[destino].clear();
+            paraCadaElemento<Particle>(entrada, [&](const Particle &particula) {
+                blocks[posicion(particula.idBloque)].addParticle(particula);
+            });
+        }
+    }
+
+
+    // Funcion que intercambia las capas frontera con los rangos vecinos: primero hacia la derecha (las ultimas capas
+    // propias pasan a ser las capas fantasma izquierdas del siguiente rango) y despues hacia la izquierda
+    void Subdominio::enviarHalo(std::vector<Block> &blocks, bool soloDensidades) {
+        const int izquierda = rango > 0 ? rango - 1 : -1;
+        const int derecha = rango + 1 < numRangos ? rango + 1 : -1;
+        enviarCapas(blocks, fin - ancho, derecha, soloDensidades);
+        transporte.intercambiar(derecha, salida, izquierda, entrada);
+        recibirCapas(blocks, inicio - ancho, soloDensidades);
+        enviarCapas(blocks, inicio, izquierda, soloDensidades);
+        transporte.intercambiar(izquierda, salida, derecha, entrada);
+        recibirCapas(blocks, fin, soloDensidades);
+    }
+
+
+    // Funcion que prepara el mensaje con las particulas de las capas propias [desde, desde + ancho)
+    void Subdominio::enviarCapas(std::vector<Block> &blocks, int desde, int destino, bool soloDensidades) {
+        salida.clear();
+        if (destino < 0) {
+            return;
+        }
+        for (int capa = desde; capa < desde + ancho; ++capa) {
+            paraCadaBloqueCapa(capa, blocks, [&](const Block &block) {
+                for (const Particle &particula: block.particles) {
+                    if (soloDensidades) {
+                        anadir(salida, particula.density);
+                    } else {
+                        anadir(salida, ParticulaHalo{particula.id, particula.idBloque, particula.px, particula.py,
+                                                     particula.pz, particula.vx, particula.vy, particula.vz});
+                    }
+                }
+            });
+        }
+    }
+
+
+    // Funcion que crea las particulas fantasma de las capas [desde, desde + ancho), o actualiza sus densidades
+    // (llegan en el mismo orden en el que se recorren)
+    void Subdominio::recibirCapas(std::vector<Block> &blocks, int desde, bool soloDensidades) {
+        if (!soloDensidades) {
+            paraCadaElemento<ParticulaHalo>(entrada, [&](const ParticulaHalo &halo) {
+                Particle fantasma{};
+                fantasma.id = halo.id;
+                fantasma.idBloque = halo.idBloque;
+                fantasma.px = halo.px;
+                fantasma.py = halo.py;
+                fantasma.pz = halo.pz;
+                fantasma.vx = halo.vx;
+                fantasma.vy = halo.vy;
+                fantasma.vz = halo.vz;
+                blocks[posicion(halo.idBloque)].addParticle(fantasma);
+            });
+            return;
+        }
+        std::size_t siguiente = 0;
+        for (int capa = std::max(desde, 0); capa < std::min(desde + ancho, numCapas); ++capa) {
+            paraCadaBloqueCapa(capa, blocks, [&](Block &block) {
+                for (Particle &fantasma: block.particles) {
+                    std::memcpy(&fantasma.density, entrada.data() + sizeof(double) * siguiente++, sizeof(double));
+                }
+            });
+        }
+    }
+
+
+    void Subdominio::borrarFantasmas(std::vector<Block> &blocks) const {
+        for (const int desde: {inicio - ancho, fin}) {
+            for (int capa = std::max(desde, 0); capa < std::min(desde + ancho, numCapas); ++capa) {
+                paraCadaBloqueCapa(capa, blocks, [](Block &block) { block.particles.clear(); });
+            }
+        }
+    }
+
+
+    double Subdominio::minimoGlobal(double valor) {
+        double minimo = valor;
+        salida.clear();
+        anadir(salida, valor);
+        for (int ronda = 1; ronda < numRangos; ++ronda) {
+            transporte.intercambiar((rango + ronda) % numRangos, salida, (rango - ronda + numRangos) % numRangos,
+                                    entrada);
+            paraCadaElemento<double>(entrada, [&](double otro) { minimo = std::min(minimo, otro); });
+        }
+        return minimo;
+    }
+
+
+    // Funcion que junta en el rango 0 las particulas de todos los rangos (en un unico bloque)
+    std::vector<Block> Subdominio::reunir(const std::vector<Block> &blocks) {
+        salida.clear();
+        for (const Block &block: blocks) {
+            for (const Particle &particula: block.particles) {
+                anadir(salida, particula);
+            }
+        }
+        if (rango != 0) {
+            transporte.intercambiar(0, salida, -1, entrada);
+            return {};
+        }
+        std::vector<Block> resultado(1);
+        paraCadaElemento<Particle>(salida, [&](const Particle &particula) { resultado[0].addParticle(particula); });
+        for (int origen = 1; origen < numRangos; ++origen) {
+            transporte.intercambiar(-1, {}, origen, entrada);
+            paraCadaElemento<Particle>(entrada, [&](const Particle &particula) {
+                resultado[0].addParticle(particula);
+            });
+        }
+        return resultado;
+    }
+
+
+    // Procesos hijos de los rangos. Si se sale sin esperarlos (el rango 0 o la creacion de otro hijo fallan), al
+    // destruirse los termina y los espera, asi no quedan procesos sueltos ni zombis
+    class Hijos {
+    public:
+        Hijos() = default;
+        Hijos(const Hijos &) = delete;
+        Hijos &operator=(const Hijos &) = delete;
+        Hijos(Hijos &&) = delete;
+        Hijos &operator=(Hijos &&) = delete;
+        ~Hijos();
+
+        inline void registrar(pid_t hijo) { pids.push_back(hijo); }
+
+        void esperar();
+
+    private:
+        std::vector<pid_t> pids; // Los que quedan por esperar
+    };
+
+
+    Hijos::~Hijos() {
+        for (const pid_t hijo: pids) {
+            ::kill(hijo, SIGKILL);
+            ::waitpid(hijo, nullptr, 0);
+        }
+    }
+
+
+    // Funcion que espera a los procesos hijos y comprueba que todos han terminado bien
+    void Hijos::esperar() {
+        bool correcto = true;
+        for (const pid_t hijo: pids) {
+            int estado = 0;
+            correcto = ::waitpid(hijo, &estado, 0) == hijo && WIFEXITED(estado) && WEXITSTATUS(estado) == 0 &&
+                       correcto;
+        }
+        pids.clear();
+        if (!correcto) {
+            throw std::runtime_error("Error: a distributed rank failed.");
+        }
+    }
+
+
+    // Funcion que crea un proceso hijo por cada rango salvo el 0. Cada hijo solo conserva su transporte, simula su
+    // rodaja y termina sin volver al programa principal
+    void lanzarHijos(std::vector<std::unique_ptr<TransporteSocket>> &transportes,
+                     const std::function<void(Transporte &)> &simular, Hijos &hijos) {
+        std::cout.flush(); // Para que los hijos no hereden (y repitan) la salida pendiente
+        for (std::size_t rango = 1; rango < transportes.size(); ++rango) {
+            const pid_t pid = ::fork();
+            if (pid < 0) {
+                throw std::runtime_error("Error: fork failed.");
+            }
+            if (pid == 0) {
+                const std::unique_ptr<TransporteSocket> propio = std::move(transportes[rango]);
+                transportes.clear();
+                int codigo = 0;
+                try {
+                    simular(*propio);
+                } catch (const std::exception &e) {
+                    std::cerr << e.what() << "\n";
+                    codigo = 1;
+                }
+                std::_Exit(codigo);
+            }
+            hijos.registrar(pid);
+        }
+    }
+}
+
+
+std::vector<Block> simularRango(Grid &malla, Argumentos &argumentos, const ParametrosSimulacion &parametros,
+                                Transporte &transporte) {
+    Subdominio subdominio(malla, parametros, transporte);
+    std::vector<Block> blocks = subdominio.repartir(argumentos.fluid);
+    const Opciones &opciones = argumentos.opciones;
+    Telemetria telemetria(argumentos, transporte.rango()); // Cada rango muestrea sus propias particulas
+    double tiempo = 0.0;
+    int iter = 0;
+    for (; quedanIteraciones(argumentos, iter, tiempo); ++iter) {
+        initAccelerations(blocks);
+        subdominio.reposicionar(blocks);
+        if (opciones.intervaloOrden > 0 && iter % opciones.intervaloOrden == 0) {
+            malla.ordenarParticulasBloques(blocks);
+        }
+        tiempo += subdominio.iterar(blocks, opciones, tiempo);
+        telemetria.muestrear(blocks, malla, iter + 1, tiempo);
+    }
+    if (opciones.tiempoObjetivo > 0.0 && transporte.rango() == 0) {
+        std::cout << "Simulated time: " << tiempo << " in " << iter << " steps\n";
+    }
+    return subdominio.reunir(blocks);
+}
+
+
+std::vector<Block> ejecutarDistribuido(Grid &malla, Argumentos &argumentos, double smoothingLength,
+                                       double particleMass) {
+    const ParametrosSimulacion parametros = calcularParametros(smoothingLength, particleMass, argumentos.opciones);
+    std::vector<std::unique_ptr<TransporteSocket>> transportes = crearTransportesLocales(argumentos.opciones.rangos);
+    Hijos hijos;
+    lanzarHijos(transportes, [&](Transporte &transporte) {
+        simularRango(malla, argumentos, parametros, transporte);
+    }, hijos);
+    const std::unique_ptr<TransporteSocket> propio = std::move(transportes[0]);
+    transportes.clear();
+    std::vector<Block> blocks = simularRango(malla, argumentos, parametros, *propio);
+    hijos.esperar();
+    return blocks;
+}
@@ -0,0 +1,27 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_DISTRIBUIDO_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_DISTRIBUIDO_HPP
+
+#include <vector>
+#include "sim/grid.hpp"
+#include "sim/progargs.hpp"
+#include "sim/simulacion.hpp"
+#include "sim/transporte.hpp"
+
+// Simulacion distribuida por descomposicion del dominio: la malla (densa) se reparte en rodajas de bloques a lo largo
+// del eje x, una por rango. Cada rango solo calcula las particulas de sus bloques; en cada iteracion recibe de sus
+// vecinos una capa de bloques "fantasma" (posiciones y velocidades, y despues densidades) y les pasa las particulas
+// que salen de su rodaja
+
+// Ejecuta las iteraciones como el rango "transporte.rango()", que solo guarda los bloques de su rodaja y de sus capas
+// fantasma (la malla usa esa ventana hasta que termina). El rango 0 devuelve todas las particulas al terminar (en un
+// unico bloque); el resto devuelve un vector vacio
+std::vector<Block> simularRango(Grid &malla, Argumentos &argumentos, const ParametrosSimulacion &parametros,
+                                Transporte &transporte);
+
+// Crea "opciones.rangos - 1" procesos hijos (fork) conectados con sockets UNIX y simula con todos ellos; si algo falla
+// por el camino, los hijos que ya existen se terminan y se esperan antes de propagar el error
+std::vector<Block> ejecutarDistribuido(Grid &malla, Argumentos &argumentos, double smoothingLength,
+                                       double particleMass);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_DISTRIBUIDO_HPP
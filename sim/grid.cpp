@@ -1,9 +1,70 @@
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <tuple>
 #include "constantes.hpp"
 #include "grid.hpp"
 
 
+namespace {
+    // Numero de subceldas por eje en las que se divide cada bloque al ordenar sus particulas
+    constexpr int subceldasOrden = 4;
+
+    // Intercala los bits de los indices de subcelda (curva de Morton), asi subceldas vecinas quedan cerca
+    std::uint32_t claveMorton(std::uint32_t subx, std::uint32_t suby, std::uint32_t subz) {
+        std::uint32_t clave = 0;
+        for (std::uint32_t bit = 0; (1U << bit) < subceldasOrden; ++bit) {
+            clave |= ((subx >> bit) & 1U) << (3 * bit + 2);
+            clave |= ((suby >> bit) & 1U) << (3 * bit + 1);
+            clave |= ((subz >> bit) & 1U) << (3 * bit);
+        }
+        return clave;
+    }
+
+    // Indice de la subcelda de una coordenada dentro de su bloque (acotado, por si la particula se ha salido)
+    std::uint32_t indiceSubcelda(double coordenada, double origen, double invmesh) {
+        const int indice = static_cast<int>((coordenada - origen) * invmesh * subceldasOrden);
+        return static_cast<std::uint32_t>(std::clamp(indice, 0, subceldasOrden - 1));
+    }
+}
+
+
+// Funcion que vacia la tabla dejando sitio para "capacidadMinima" claves (con un factor de carga de 1/2 como maximo)
+void TablaBloques::vaciar(std::size_t capacidadMinima) {
+    const std::size_t capacidad = std::bit_ceil(std::max<std::size_t>(2 * capacidadMinima, 2));
+    bits = std::bit_width(capacidad) - 1;
+    claves.assign(capacidad, -1);
+    valores.assign(capacidad, -1);
+}
+
+
+// Funcion que devuelve la posicion de la clave en la tabla (o la del hueco libre en el que iria)
+std::size_t TablaBloques::posicion(int clave) const {
+    // Hash multiplicativo (Fibonacci): se quedan los bits altos del producto
+    constexpr std::uint64_t multiplicador = 0x9E3779B97F4A7C15ULL;
+    const std::size_t mascara = claves.size() - 1;
+    std::size_t hueco = (static_cast<std::uint64_t>(clave) * multiplicador) >> (64U - bits);
+    while (claves[hueco] != -1 && claves[hueco] != clave) {
+        hueco = (hueco + 1) & mascara;
+    }
+    return hueco;
+}
+
+
+int TablaBloques::buscar(int clave) const {
+    return claves.empty() ? -1 : valores[posicion(clave)];
+}
+
+
+int &TablaBloques::insertar(int clave) {
+    const std::size_t hueco = posicion(clave);
+    claves[hueco] = clave;
+    return valores[hueco];
+}
+
+
 // Inicializar los valores para el constructor
 Grid::Grid(const Punto &bmin, const Punto &bmax) : bmin(bmin),
                                                    bmax(bmax) {}
@@ -16,10 +77,19 @@ void Grid::dividirEnBloques(double smoothingLength) {
         throw std::invalid_argument("Smoothing length must be a positive value.");
     }
 
-    // Variables con el numero de bloques (por coordenadas y en total)
-    numberblocksx = floor(((bmax.x - bmin.x)) / smoothingLength);
-    numberblocksy = floor(((bmax.y - bmin.y)) / smoothingLength);
-    numberblocksz = floor(((bmax.z - bmin.z)) / smoothingLength);
+    // Si la malla ya esta dividida con la misma longitud, se conservan sus bloques y su buffer (modo por lotes)
+    if (smoothingLength == longitudDividida && disperso == divididaDispersa && subdivision == divididaSubdivision) {
+        return;
+    }
+    longitudDividida = smoothingLength;
+    divididaDispersa = disperso;
+    divididaSubdivision = subdivision;
+
+    // Variables con el numero de bloques (por coordenadas y en total). Con "subdivision" cada bloque del tamaño de la
+    // longitud de suavizado se parte en "subdivision" celdas por eje
+    numberblocksx = floor(((bmax.x - bmin.x)) / smoothingLength) * subdivision;
+    numberblocksy = floor(((bmax.y - bmin.y)) / smoothingLength) * subdivision;
+    numberblocksz = floor(((bmax.z - bmin.z)) / smoothingLength) * subdivision;
     numBlocks = numberblocksx * numberblocksy * numberblocksz;
 
     // Variables con la longitud en cada coordenada de los bloques
@@ -31,8 +101,44 @@ void Grid::dividirEnBloques(double smoothingLength) {
     invmeshx = 1 / meshx;
     invmeshy = 1 / meshy;
     invmeshz = 1 / meshz;
+    calcularVecindad(smoothingLength);
+
+    capaBase = 0;
+    capaFinal = capasVentana == 0 ? static_cast<int>(numberblocksx)
+                                  : std::min(capasVentana, static_cast<int>(numberblocksx));
+
+    // En la malla dispersa solo existen los bloques con particulas, que se crean al reposicionar
+    blocks.clear();
+    if (!disperso && capasVentana == 0) {
+        dividirVectorBloques(blocks);
+    }
+    bufferBloques.clear();
+}
 
-    dividirVectorBloques(blocks);
+
+// Funcion que calcula los desplazamientos de los bloques vecinos: los que estan a menos de "subdivision" bloques en
+// cada eje y cuya distancia minima al bloque (la de los huecos entre ambos) es menor que la longitud de suavizado
+void Grid::calcularVecindad(double smoothingLength) {
+    vecindad.clear();
+    vecindadZYX.clear();
+    const auto hueco = [](int desplazamiento, double mesh) { return std::max(0, std::abs(desplazamiento) - 1) * mesh; };
+    for (int dx = -subdivision; dx <= subdivision; ++dx) {
+        for (int dy = -subdivision; dy <= subdivision; ++dy) {
+            for (int dz = -subdivision; dz <= subdivision; ++dz) {
+                const double huecox = hueco(dx, meshx);
+                const double huecoy = hueco(dy, meshy);
+                const double huecoz = hueco(dz, meshz);
+                if (huecox * huecox + huecoy * huecoy + huecoz * huecoz < smoothingLength * smoothingLength) {
+                    vecindad.push_back(Desplazamiento{dx, dy, dz});
+                }
+            }
+        }
+    }
+    // El mismo conjunto, ordenado por z, y, x
+    vecindadZYX = vecindad;
+    std::ranges::stable_sort(vecindadZYX, [](const Desplazamiento &a, const Desplazamiento &b) {
+        return std::tie(a.dz, a.dy, a.dx) < std::tie(b.dz, b.dy, b.dx);
+    });
 }
 
 
@@ -57,54 +163,223 @@ std::pair<double, double> Grid::simular_malla(const Fluid &fluid) {
 }
 
 
-// Funcion que reposiciona las particulas en la primera iteracion, a partir del fluido
-void Grid::reposicionarParticulasFluid(Fluid &fluid, std::vector<Block> &bloques) const {
-    for (int i = 0; i < fluid.numberparticles; ++i) {
-        Particle &particula = fluid.particles[i];
+// Funcion que calcula el indice (en la malla densa) del bloque al que pertenece una particula
+int Grid::indiceBloqueParticula(const Particle &particula) const {
+    const int indicex = std::max(0, std::min(static_cast<int>((particula.px - bmin.x) * invmeshx),
+                                             static_cast<int>(numberblocksx) - 1));
+    const int indicey = std::max(0, std::min(static_cast<int>((particula.py - bmin.y) * invmeshy),
+                                             static_cast<int>(numberblocksy) - 1));
+    const int indicez = std::max(0, std::min(static_cast<int>((particula.pz - bmin.z) * invmeshz),
+                                             static_cast<int>(numberblocksz) - 1));
+    return static_cast<int>(indicez + indicey * numberblocksz + indicex * numberblocksz * numberblocksy);
+}
 
-        const int indicex = std::max(0, std::min(static_cast<int>((particula.px - bmin.x) * invmeshx),
-                                                 static_cast<int>(numberblocksx) - 1));
-        const int indicey = std::max(0, std::min(static_cast<int>((particula.py - bmin.y) * invmeshy),
-                                                 static_cast<int>(numberblocksy) - 1));
-        const int indicez = std::max(0, std::min(static_cast<int>((particula.pz - bmin.z) * invmeshz),
-                                                 static_cast<int>(numberblocksz) - 1));
 
-        const int blockId = static_cast<int>(indicez + indicey * numberblocksz +
-                                             indicex * numberblocksz * numberblocksy);
-        Block &block = bloques[blockId];
-        particula.idBloque = block.id;
+// Funcion que reposiciona las particulas en la primera iteracion, a partir del fluido. Desde aqui los bloques son
+// el unico almacen de particulas, asi que se libera la copia del fluido (la salida las ordena por id)
+void Grid::reposicionarParticulasFluid(Fluid &fluid, std::vector<Block> &bloques) {
+    const auto numero = static_cast<std::size_t>(fluid.numberparticles);
+    reposicionarParticulas(std::span<const Particle>(fluid.particles).first(numero), bloques);
+    std::vector<Particle>().swap(fluid.particles);
+}
+
+
+// Funcion que coloca unas particulas (en su orden) en los bloques a los que pertenecen
+void Grid::reposicionarParticulas(std::span<const Particle> particulas, std::vector<Block> &bloques) {
+    // Primero se cuentan las particulas de cada bloque, para reservarlos enteros
+    empezarConteo(particulas.size());
+    for (const Particle &particula: particulas) {
+        contarParticula(indiceBloqueParticula(particula));
+    }
+    terminarConteo(bloques);
+    for (const Particle &particula: particulas) {
+        const int posicion = posicionBloque(indiceBloqueParticula(particula));
+        Block &block = bloques[posicion];
+        block.particles.reserve(conteoDestinos[posicion]);
         block.addParticle(particula);
+        block.particles.back().idBloque = block.id;
     }
 }
 
 
 // Funcion que reposiciona las particulas almacenadas en los bloques
-void Grid::reposicionarParticulasBloque(std::vector<Block> &bloques) const {
-    // Crea una copia vacia de los bloques con el mismo tamaño que "bloques"
-    std::vector<Block> nuevosBloques(bloques.size());
-    dividirVectorBloques(nuevosBloques);
+void Grid::reposicionarParticulasBloque(std::vector<Block> &bloques) {
+    // Los bloques del buffer estan vacios: sus particulas se devolvieron al pool al reposicionar la vez anterior
+    if (!disperso && bufferBloques.size() != static_cast<std::size_t>(numBlocks)) {
+        dividirVectorBloques(bufferBloques);
+    }
+    contarDestinos(bloques);
 
-    for (const Block &block: bloques) {
-        for (Particle particula: block.particles) {
-            const int indicex = std::max(0, std::min(static_cast<int>((particula.px - bmin.x) * invmeshx),
-                                                     static_cast<int>(numberblocksx) - 1));
-            const int indicey = std::max(0, std::min(static_cast<int>((particula.py - bmin.y) * invmeshy),
-                                                     static_cast<int>(numberblocksy) - 1));
-            const int indicez = std::max(0, std::min(static_cast<int>((particula.pz - bmin.z) * invmeshz),
-                                                     static_cast<int>(numberblocksz) - 1));
-
-            // Con los indices de las coordenadas calcula el indice del bloque y la incluye en este
-            const int blockId = static_cast<int>(indicez + indicey * numberblocksz +
-                                                 indicex * numberblocksz * numberblocksy);
-            Block &newBlock = nuevosBloques[blockId];
-            particula.idBloque = newBlock.id;
+    for (Block &block: bloques) {
+        for (const Particle &particula: block.particles) {
+            // El bloque nuevo se reserva entero con su primera particula, asi no crece de una en una
+            const int posicion = posicionBloque(particula.idBloque);
+            Block &newBlock = bufferBloques[posicion];
+            if (newBlock.particles.empty()) {
+                newBlock.particles.reserve(conteoDestinos[posicion]);
+            }
             newBlock.addParticle(particula);
+            newBlock.particles.back().idBloque = newBlock.id;
+        }
+        // El bloque ya repartido devuelve su memoria al pool, donde la pueden usar los bloques nuevos que faltan. Asi
+        // cada llamada pide los mismos trozos que devuelve y, una vez calentado el pool, no reserva memoria
+        VectorParticulas().swap(block.particles);
+    }
+    // Intercambia los bloques con el buffer (los antiguos, ya vacios, se reutilizaran en la siguiente llamada)
+    std::swap(bloques, bufferBloques);
+}
+
+
+// Funcion que guarda en "idBloque" el indice (en la malla densa) del bloque destino de cada particula (al anadirla a
+// su bloque nuevo pasa a tener el id de este) y cuenta las particulas de cada bloque destino
+void Grid::contarDestinos(std::vector<Block> &bloques) {
+    std::size_t numParticulas = 0;
+    for (const Block &block: bloques) {
+        numParticulas += block.particles.size();
+    }
+    empezarConteo(numParticulas);
+    for (Block &block: bloques) {
+        for (Particle &particula: block.particles) {
+            particula.idBloque = indiceBloqueParticula(particula);
+            contarParticula(particula.idBloque);
         }
     }
-    // Reemplaza los bloques originales con los nuevos bloques
-    bloques = std::move(nuevosBloques);
+    terminarConteo(bufferBloques);
+}
+
+
+// Funcion que prepara el conteo de las particulas de cada bloque. En la malla dispersa se vacia la tabla de bloques
+// activos: como mucho hay tantos como particulas (o como bloques tiene la malla)
+void Grid::empezarConteo(std::size_t numParticulas) {
+    if (disperso) {
+        tablaDispersa.vaciar(std::min(numParticulas, static_cast<std::size_t>(numBlocks)));
+        idsActivos.clear();
+    } else {
+        conteoDestinos.assign(static_cast<std::size_t>(numBlocks), 0);
+    }
 }
 
+
+// Funcion que cuenta una particula del bloque "blockId" (indice en la malla densa). En la malla dispersa el bloque
+// se activa con su primera particula y, hasta terminar el conteo, la tabla guarda su numero de particulas
+void Grid::contarParticula(int blockId) {
+    if (!disperso) {
+        ++conteoDestinos[blockId];
+        return;
+    }
+    int &conteo = tablaDispersa.insertar(blockId);
+    if (conteo < 0) {
+        conteo = 0;
+        idsActivos.push_back(blockId);
+    }
+    ++conteo;
+}
+
+
+// Funcion que termina el conteo. En la malla dispersa deja en "bloques" los bloques activos, ordenados como en la
+// malla densa (asi los resultados no cambian): solo se ordenan sus indices, los bloques del vector se reutilizan y la
+// tabla pasa a guardar la posicion de cada bloque en el vector (su numero de particulas va a "conteoDestinos")
+void Grid::terminarConteo(std::vector<Block> &bloques) {
+    if (!disperso) {
+        return;
+    }
+    std::ranges::sort(idsActivos);
+    bloques.resize(idsActivos.size());
+    conteoDestinos.resize(idsActivos.size());
+    const int nz = static_cast<int>(numberblocksz);
+    const int ny = static_cast<int>(numberblocksy);
+    for (std::size_t posicion = 0; posicion < idsActivos.size(); ++posicion) {
+        const int blockId = idsActivos[posicion];
+        int &valor = tablaDispersa.insertar(blockId);
+        conteoDestinos[posicion] = valor;
+        valor = static_cast<int>(posicion);
+        Block &block = bloques[posicion];
+        block.id = blockId;
+        block.cx = blockId / (nz * ny);
+        block.cy = (blockId / nz) % ny;
+        block.cz = blockId % nz;
+    }
+}
+
+
+void Grid::prepararReposicion() {
+    if (bufferBloques.size() != static_cast<std::size_t>(numBlocks)) {
+        dividirVectorBloques(bufferBloques);
+    }
+}
+
+
+// Funcion que guarda en "idBloque" el bloque destino de cada particula del bloque "indice"
+int Grid::anotarDestinos(std::vector<Block> &bloques, int indice) const {
+    Block &block = bloques[indice];
+    int lejanas = 0;
+    for (Particle &particula: block.particles) {
+        particula.idBloque = indiceBloqueParticula(particula);
+        lejanas += esVecino(block, particula.idBloque) ? 0 : 1;
+    }
+    return lejanas;
+}
+
+
+// Funcion que llena el bloque "destino" del buffer con las particulas de sus vecinos que van a el (antes las cuenta,
+// para reservarlo entero). Los vecinos se recorren en orden de indice, asi el orden queda igual que con
+// "reposicionarParticulasBloque"
+void Grid::recogerParticulas(const std::vector<Block> &bloques, int destino) {
+    Block &nuevo = bufferBloques[destino];
+    nuevo.particles.clear();
+    std::ptrdiff_t numero = 0;
+    paraCadaAdyacente(nuevo, [&](int origen) {
+        numero += std::ranges::count(bloques[origen].particles, destino, &Particle::idBloque);
+    });
+    nuevo.particles.reserve(static_cast<std::size_t>(numero));
+    paraCadaAdyacente(nuevo, [&](int origen) {
+        for (const Particle &particula: bloques[origen].particles) {
+            if (particula.idBloque == destino) {
+                nuevo.addParticle(particula);
+            }
+        }
+    });
+}
+
+
+// Las particulas que han saltado mas de un bloque no las ha recogido su destino. Los destinos afectados se vuelven a
+// llenar recorriendo todos los bloques en orden, asi el resultado es el mismo que con "reposicionarParticulasBloque"
+void Grid::terminarReposicion(std::vector<Block> &bloques, bool hayLejanas) {
+    if (hayLejanas) {
+        destinosLejanas.assign(bufferBloques.size(), 0);
+        for (const Block &block: bloques) {
+            for (const Particle &particula: block.particles) {
+                if (!esVecino(block, particula.idBloque)) {
+                    destinosLejanas[particula.idBloque] = 1;
+                    bufferBloques[particula.idBloque].particles.clear();
+                }
+            }
+        }
+        for (const Block &block: bloques) {
+            for (const Particle &particula: block.particles) {
+                if (destinosLejanas[particula.idBloque] != 0) {
+                    bufferBloques[particula.idBloque].addParticle(particula);
+                }
+            }
+        }
+    }
+    std::swap(bloques, bufferBloques);
+    // Los bloques antiguos devuelven su memoria al pool: entre iteraciones solo hay una copia de las particulas
+    for (Block &block: bufferBloques) {
+        VectorParticulas().swap(block.particles);
+    }
+}
+
+
+// Funcion que indica si el bloque "blockId" (indice en la malla densa) es vecino de "block" (o el mismo)
+bool Grid::esVecino(const Block &block, int blockId) const {
+    const int nz = static_cast<int>(numberblocksz);
+    const int ny = static_cast<int>(numberblocksy);
+    return std::abs(blockId / (nz * ny) - block.cx) <= 1 && std::abs((blockId / nz) % ny - block.cy) <= 1 &&
+           std::abs(blockId % nz - block.cz) <= 1;
+}
+
+
 // Funcion que genera cada bloque individual en el vector bloques
 void Grid::dividirVectorBloques(std::vector<Block> &nuevosBloques) const {
     int bloqueId = -1;
@@ -123,5 +398,56 @@ void Grid::dividirVectorBloques(std::vector<Block> &nuevosBloques) const {
 }
 
 
+void Grid::prepararVentana(std::vector<Block> &ventana, int base) {
+    capaBase = base;
+    capaFinal = std::min(base + capasVentana, static_cast<int>(numberblocksx));
+    ventana.clear();
+    const int nz = static_cast<int>(numberblocksz);
+    const int ny = static_cast<int>(numberblocksy);
+    for (int indice = base * ny * nz; indice < (base + capasVentana) * ny * nz; ++indice) {
+        ventana.emplace_back(indice, indice / (nz * ny), (indice / nz) % ny, indice % nz);
+    }
+}
+
+
+void Grid::cerrarVentana() {
+    capasVentana = 0;
+    capaBase = 0;
+    capaFinal = static_cast<int>(numberblocksx);
+}
+
+
+void Grid::avanzarVentana(std::vector<Block> &ventana) {
+    const auto bloquesPorCapa = static_cast<std::ptrdiff_t>(numberblocksy * numberblocksz);
+    std::rotate(ventana.begin(), ventana.begin() + bloquesPorCapa, ventana.end());
+    ++capaBase;
+    capaFinal = std::min(capaBase + capasVentana, static_cast<int>(numberblocksx));
+    const int nuevaCapa = capaBase + capasVentana - 1;
+    for (auto block = ventana.end() - bloquesPorCapa; block != ventana.end(); ++block) {
+        block->id += capasVentana * static_cast<int>(bloquesPorCapa);
+        block->cx = nuevaCapa;
+        block->particles.clear();
+    }
+}
+
 
+// Funcion que ordena las particulas de cada bloque por subcelda, para que las particulas cercanas esten contiguas
+void Grid::ordenarParticulasBloques(std::vector<Block> &bloques) const {
+    for (Block &block: bloques) {
+        if (block.particles.size() < 2) {
+            continue;
+        }
+        const double origenx = bmin.x + block.cx * meshx;
+        const double origeny = bmin.y + block.cy * meshy;
+        const double origenz = bmin.z + block.cz * meshz;
 
+        // La clave combina la subcelda con el id, asi el orden es unico y no depende del orden previo
+        auto clave = [&](const Particle &particula) {
+            const std::uint32_t morton = claveMorton(indiceSubcelda(particula.px, origenx, invmeshx),
+                                                     indiceSubcelda(particula.py, origeny, invmeshy),
+                                                     indiceSubcelda(particula.pz, origenz, invmeshz));
+            return (static_cast<std::uint64_t>(morton) << 32U) | static_cast<std::uint32_t>(particula.id);
+        };
+        std::ranges::sort(block.particles, std::less{}, clave);
+    }
+}
@@ -1,13 +1,33 @@
 #ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_GRID_HPP
 #define PROYECTO_RENDIMIENTO_ARQUITECTURA_GRID_HPP
 
+#include <algorithm>
+#include <span>
 #include <vector>
 #include "block.hpp"  // Incluimos block.hpp para tener acceso a la estructura "Punto"
 
 struct Fluid {
     float particlespermeter = 0;  // Particulas por metro
     int numberparticles = 0;  // Numero total de particulas
-    std::vector<Particle> particles;
+    std::vector<Particle> particles;  // Particulas leidas (se liberan al colocarlas en los bloques)
+};
+
+// Tabla hash de direccionamiento abierto que relaciona el indice de un bloque (en la malla densa) con su posicion
+// en el vector de bloques activos. Al vaciarla conserva su memoria, asi no reserva en cada iteracion
+class TablaBloques {
+public:
+    void vaciar(std::size_t capacidadMinima);
+
+    [[nodiscard]] int buscar(int clave) const; // Devuelve -1 si la clave no esta
+
+    int &insertar(int clave); // Devuelve el valor asociado a la clave (-1 si es nueva)
+
+private:
+    std::vector<int> claves;
+    std::vector<int> valores;
+    std::size_t bits{0};
+
+    [[nodiscard]] std::size_t posicion(int clave) const;
 };
 
 class Grid {
@@ -31,12 +51,94 @@ public:
 
     std::pair<double, double> simular_malla(const Fluid &fluid);
 
-    void reposicionarParticulasFluid(Fluid &fluid, std::vector<Block> &bloques) const;
+    void reposicionarParticulasFluid(Fluid &fluid, std::vector<Block> &bloques);
+
+    void reposicionarParticulas(std::span<const Particle> particulas, std::vector<Block> &bloques);
 
-    void reposicionarParticulasBloque(std::vector<Block> &bloques) const;
+    void reposicionarParticulasBloque(std::vector<Block> &bloques);
+
+    void ordenarParticulasBloques(std::vector<Block> &bloques) const;
+
+    // Reposicionamiento por bloques destino (solo malla densa), para repartirlo entre hilos: se prepara el buffer,
+    // cada bloque origen anota el destino de sus particulas, cada bloque destino recoge las suyas de los bloques
+    // vecinos (asi cada hilo reserva y escribe sus propios bloques) y al terminar se colocan las que han saltado
+    // mas de un bloque y se intercambian los bloques con el buffer
+    void prepararReposicion();
+
+    [[nodiscard]] int anotarDestinos(std::vector<Block> &bloques, int indice) const; // Devuelve cuantas saltan
+
+    void recogerParticulas(const std::vector<Block> &bloques, int destino);
+
+    void terminarReposicion(std::vector<Block> &bloques, bool hayLejanas);
 
     [[nodiscard]] inline const std::vector<Block> &getBlocks() const { return blocks; }
 
+    // Malla dispersa: solo se guardan (y se recorren) los bloques con particulas. Se activa antes de dividir
+    inline void setDisperso(bool valor) { disperso = valor; }
+
+    [[nodiscard]] inline bool getDisperso() const { return disperso; }
+
+    // Celdas por longitud de suavizado en cada eje (1 = bloques del tamaño de la longitud). Con celdas mas pequeñas
+    // la vecindad tiene mas bloques, pero se descartan los que estan a mas de esa longitud, asi se comprueban menos
+    // pares. Se cambia antes de dividir
+    inline void setSubdivision(int valor) { subdivision = std::max(1, valor); }
+
+    [[nodiscard]] inline int getSubdivision() const { return subdivision; }
+
+    // Numero de bloques vecinos (incluido el mismo) con los que puede interactuar un bloque, sin salir de la malla
+    [[nodiscard]] inline std::size_t getTamVecindad() const { return vecindad.size(); }
+
+    // Llama a funcion(indice) con la posicion de cada bloque vecino de "block" (incluido el mismo) que exista, en
+    // orden x, y, z (los bloques de la vecindad se calculan al dividir la malla)
+    template <typename Funcion>
+    void paraCadaVecino(const Block &block, Funcion &&funcion) const {
+        recorrerVecindad(vecindad, block, funcion);
+    }
+
+    // Lo mismo en orden z, y, x (el de la etapa de densidades en serie, asi las sumas se hacen en el mismo orden)
+    template <typename Funcion>
+    void paraCadaVecinoZYX(const Block &block, Funcion &&funcion) const {
+        recorrerVecindad(vecindadZYX, block, funcion);
+    }
+
+    // Llama a funcion(indice) con cada bloque adyacente a "block" (a un bloque de distancia, incluido el mismo)
+    template <typename Funcion>
+    void paraCadaAdyacente(const Block &block, Funcion &&funcion) const {
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dz = -1; dz <= 1; ++dz) {
+                    visitarDesplazamiento(block, Desplazamiento{dx, dy, dz}, funcion);
+                }
+            }
+        }
+    }
+
+    // Posicion en el vector de bloques del bloque (cx, cy, cz), o -1 si en la malla dispersa no tiene particulas
+    [[nodiscard]] inline int indiceBloque(int cx, int cy, int cz) const {
+        const int indice = static_cast<int>(cz + cy * numberblocksz + (cx - capaBase) * numberblocksz * numberblocksy);
+        return disperso ? tablaDispersa.buscar(indice) : indice;
+    }
+
+    // Indice (en la malla densa) del bloque al que pertenece una particula
+    [[nodiscard]] int indiceBloqueParticula(const Particle &particula) const;
+
+    // Ventana de capas (--out-of-core y rodaja de un rango): el vector de bloques solo tiene "capas" capas
+    // consecutivas de bloques en x, desde la capa base, y las vecindades no salen de ellas. Con --out-of-core se
+    // activa antes de dividir, asi la malla no guarda los suyos
+    inline void setVentana(int capas) { capasVentana = capas; }
+
+    [[nodiscard]] inline int getCapaBase() const { return capaBase; }
+
+    // Crea los bloques de la ventana con las capas desde "base" (con su id de la malla densa)
+    void prepararVentana(std::vector<Block> &ventana, int base);
+
+    // Vuelve a la malla entera
+    void cerrarVentana();
+
+    // Desplaza la ventana una capa: los bloques de la primera capa (ya vacios) pasan a ser los de la capa siguiente
+    // a la ultima
+    void avanzarVentana(std::vector<Block> &ventana);
+
 private:
     double numberblocksx{0.0};
     double numberblocksy{0.0};
@@ -51,8 +153,67 @@ private:
     Punto bmin; // Limite inferior del recinto
     Punto bmax; // Limite superior del recinto
     std::vector<Block> blocks;
+    std::vector<Block> bufferBloques; // Segundo juego de bloques, se llena al reposicionar y se intercambia
+    bool disperso{false};
+    TablaBloques tablaDispersa; // Indice de los bloques activos (solo en la malla dispersa)
+    std::vector<int> idsActivos; // Indices de los bloques activos (solo en la malla dispersa)
+    std::vector<char> destinosLejanas; // Bloques destino a los que han saltado particulas lejanas
+    std::vector<int> conteoDestinos; // Particulas que van a cada bloque (por su posicion) al reposicionar
+    double longitudDividida{0.0}; // Longitud de suavizado con la que se dividio la malla por ultima vez
+    bool divididaDispersa{false};
+    int subdivision{1};
+    int divididaSubdivision{1};
+    int capasVentana{0}; // 0 = el vector de bloques tiene toda la malla
+    int capaBase{0}; // Primera capa en x del vector de bloques
+    int capaFinal{0}; // Siguiente a la ultima capa en x del vector de bloques
+
+    struct Desplazamiento {
+        int dx, dy, dz;
+    };
+
+    std::vector<Desplazamiento> vecindad; // Bloques vecinos que pueden tener particulas a menos de la longitud
+    std::vector<Desplazamiento> vecindadZYX;
+
+    void calcularVecindad(double smoothingLength);
+
+    template <typename Funcion>
+    void visitarDesplazamiento(const Block &block, const Desplazamiento &desplazamiento, Funcion &funcion) const {
+        const int neighbor_cx = block.cx + desplazamiento.dx;
+        const int neighbor_cy = block.cy + desplazamiento.dy;
+        const int neighbor_cz = block.cz + desplazamiento.dz;
+        if (neighbor_cx >= capaBase && neighbor_cx < capaFinal && neighbor_cy >= 0 && neighbor_cy < numberblocksy &&
+            neighbor_cz >= 0 && neighbor_cz < numberblocksz) {
+            const int indice = indiceBloque(neighbor_cx, neighbor_cy, neighbor_cz);
+            if (indice >= 0) {
+                funcion(indice);
+            }
+        }
+    }
+
+    template <typename Funcion>
+    void recorrerVecindad(const std::vector<Desplazamiento> &desplazamientos, const Block &block,
+                          Funcion &funcion) const {
+        for (const Desplazamiento &desplazamiento: desplazamientos) {
+            visitarDesplazamiento(block, desplazamiento, funcion);
+        }
+    }
 
     void dividirVectorBloques(std::vector<Block> &nuevosBloques) const;
+
+    void contarDestinos(std::vector<Block> &bloques);
+
+    void empezarConteo(std::size_t numParticulas);
+
+    void contarParticula(int blockId);
+
+    void terminarConteo(std::vector<Block> &bloques);
+
+    // Posicion en el vector de bloques del bloque "blockId" (indice en la malla densa), tras terminar el conteo
+    [[nodiscard]] inline int posicionBloque(int blockId) const {
+        return disperso ? tablaDispersa.buscar(blockId) : blockId;
+    }
+
+    [[nodiscard]] bool esVecino(const Block &block, int blockId) const;
 };
 
 
@@ -0,0 +1,141 @@
+#include "hilos.hpp"
+#include "numa.hpp"
+#include "traza.hpp"
+
+#include <algorithm>
+
+
+namespace {
+    constexpr std::uint64_t mascaraFin = 0xFFFFFFFFULL;
+
+    std::uint64_t empaquetar(std::uint64_t inicio, std::uint64_t fin) {
+        return (inicio << 32U) | fin;
+    }
+}
+
+
+// Crea los hilos de trabajo (el hilo que llama a "ejecutar" es el hilo 0, por eso se crean numHilos - 1)
+PoolHilos::PoolHilos(int numHilos, const std::vector<int> &cpus)
+        : colas(std::make_unique<Cola[]>(static_cast<std::size_t>(std::max(numHilos, 1)))) { // NOLINT
+    auto cpuHilo = [&](int hilo) { return cpus.empty() ? -1 : cpus[static_cast<std::size_t>(hilo) % cpus.size()]; };
+    if (!cpus.empty()) {
+        Numa::fijarHiloActual(cpuHilo(0));
+    }
+    for (int i = 1; i < numHilos; ++i) {
+        hilos.emplace_back([this, i, cpu = cpuHilo(i)] { bucleHilo(i, cpu); });
+    }
+}
+
+
+PoolHilos::~PoolHilos() {
+    {
+        const std::scoped_lock bloqueo(mutex);
+        terminar = true;
+    }
+    inicio.notify_all();
+    for (std::thread &hilo: hilos) {
+        hilo.join();
+    }
+}
+
+
+// Funcion que reparte los trozos en rangos contiguos (uno por hilo), despierta a los hilos y espera al final
+void PoolHilos::ejecutarTrozos(std::size_t numTrozos, FuncionTrozo funcionTrozo, void *contextoTrozo) {
+    const auto total = static_cast<std::size_t>(numHilos());
+    for (std::size_t i = 0; i < total; ++i) {
+        colas[i].rango.store(empaquetar(numTrozos * i / total, numTrozos * (i + 1) / total),
+                             std::memory_order_relaxed);
+    }
+    {
+        const std::scoped_lock bloqueo(mutex);
+        funcion = funcionTrozo;
+        contexto = contextoTrozo;
+        hilosTrabajando = static_cast<int>(hilos.size());
+        ++generacion;
+    }
+    inicio.notify_all();
+    procesar(0);
+
+    std::unique_lock bloqueo(mutex);
+    fin.wait(bloqueo, [this] { return hilosTrabajando == 0; });
+}
+
+
+// Bucle de los hilos de trabajo: esperan a una nueva ejecucion, procesan y avisan al terminar
+void PoolHilos::bucleHilo(int hilo, int cpu) {
+    if (cpu >= 0) {
+        Numa::fijarHiloActual(cpu);
+    }
+    std::uint64_t vista = 0;
+    while (true) {
+        {
+            std::unique_lock bloqueo(mutex);
+            inicio.wait(bloqueo, [&] { return terminar || generacion != vista; });
+            if (terminar) {
+                return;
+            }
+            vista = generacion;
+        }
+        procesar(hilo);
+        {
+            const std::scoped_lock bloqueo(mutex);
+            --hilosTrabajando;
+        }
+        fin.notify_one();
+    }
+}
+
+
+// Funcion que consume la cola propia y despues roba de las demas hasta que no quede nada (con --trace, cada trozo es
+// un intervalo: "chunk" los propios y "stolen-chunk" los robados)
+void PoolHilos::procesar(int hilo) {
+    std::size_t trozo = 0;
+    while (tomarPropio(hilo, trozo)) {
+        const Traza::Ambito ambito("chunk", "chunk", static_cast<long>(trozo));
+        funcion(contexto, trozo);
+    }
+    const int total = numHilos();
+    for (int desplazamiento = 1; desplazamiento < total; ++desplazamiento) {
+        const int victima = (hilo + desplazamiento) % total;
+        while (robar(victima, trozo)) {
+            const Traza::Ambito ambito("stolen-chunk", "chunk", static_cast<long>(trozo));
+            funcion(contexto, trozo);
+        }
+    }
+}
+
+
+// El dueño de la cola toma trozos desde el principio del rango
+bool PoolHilos::tomarPropio(int hilo, std::size_t &trozo) {
+    std::atomic<std::uint64_t> &rango = colas[hilo].rango;
+    std::uint64_t actual = rango.load(std::memory_order_acquire);
+    while (true) {
+        const std::uint64_t primero = actual >> 32U;
+        const std::uint64_t ultimo = actual & mascaraFin;
+        if (primero >= ultimo) {
+            return false;
+        }
+        if (rango.compare_exchange_weak(actual, empaquetar(primero + 1, ultimo), std::memory_order_acq_rel)) {
+            trozo = primero;
+            return true;
+        }
+    }
+}
+
+
+// Los demas hilos roban trozos desde el final del rango (asi casi nunca compiten con el dueño)
+bool PoolHilos::robar(int victima, std::size_t &trozo) {
+    std::atomic<std::uint64_t> &rango = colas[victima].rango;
+    std::uint64_t actual = rango.load(std::memory_order_acquire);
+    while (true) {
+        const std::uint64_t primero = actual >> 32U;
+        const std::uint64_t ultimo = actual & mascaraFin;
+        if (primero >= ultimo) {
+            return false;
+        }
+        if (rango.compare_exchange_weak(actual, empaquetar(primero, ultimo - 1), std::memory_order_acq_rel)) {
+            trozo = ultimo - 1;
+            return true;
+        }
+    }
+}
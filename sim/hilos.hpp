@@ -0,0 +1,70 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_HILOS_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_HILOS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Pool de hilos persistentes con robo de trabajo. En cada ejecucion, cada hilo recibe un rango contiguo de trozos
+// (su cola) que consume desde el principio; cuando la vacia, roba trozos del final de las colas de los demas
+class PoolHilos {
+public:
+    // Si se dan "cpus", el hilo i (incluido el que llama, que es el 0) se fija a cpus[i]
+    explicit PoolHilos(int numHilos, const std::vector<int> &cpus = {});
+
+    PoolHilos(const PoolHilos &) = delete;
+    PoolHilos &operator=(const PoolHilos &) = delete;
+    PoolHilos(PoolHilos &&) = delete;
+    PoolHilos &operator=(PoolHilos &&) = delete;
+
+    ~PoolHilos();
+
+    [[nodiscard]] inline int numHilos() const { return static_cast<int>(hilos.size()) + 1; }
+
+    // Ejecuta tarea(trozo) para cada trozo de [0, numTrozos) y espera a que terminen todos (el hilo que llama
+    // tambien trabaja, como el hilo 0)
+    template <typename Tarea>
+    void ejecutar(std::size_t numTrozos, Tarea &tarea) {
+        ejecutarTrozos(numTrozos, [](void *contexto, std::size_t trozo) {
+            (*static_cast<Tarea *>(contexto))(trozo);
+        }, &tarea);
+    }
+
+private:
+    // Rango [inicio, fin) de trozos pendientes de un hilo, empaquetado en 64 bits para modificarlo con un CAS
+    struct alignas(64) Cola {
+        std::atomic<std::uint64_t> rango{0};
+    };
+
+    using FuncionTrozo = void (*)(void *contexto, std::size_t trozo);
+
+    std::unique_ptr<Cola[]> colas; // NOLINT(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays)
+    std::vector<std::thread> hilos;
+
+    std::mutex mutex;
+    std::condition_variable inicio;
+    std::condition_variable fin;
+    std::uint64_t generacion{0};
+    int hilosTrabajando{0};
+    bool terminar{false};
+    FuncionTrozo funcion{nullptr};
+    void *contexto{nullptr};
+
+    void ejecutarTrozos(std::size_t numTrozos, FuncionTrozo funcionTrozo, void *contextoTrozo);
+
+    void bucleHilo(int hilo, int cpu);
+
+    void procesar(int hilo);
+
+    bool tomarPropio(int hilo, std::size_t &trozo);
+
+    bool robar(int victima, std::size_t &trozo);
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_HILOS_HPP
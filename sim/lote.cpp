@@ -0,0 +1,95 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "lote.hpp"
+#include "distribuido.hpp"
+#include "simulacion.hpp"
+#include "nucleos.hpp"
+#include "capas.hpp"
+
+
+Lote::Lote(const Opciones &opciones) : opciones(opciones) {}
+
+
+Constantes::ErrorCode Lote::ejecutarTrabajo(const std::vector<std::string> &arguments) {
+    return ejecutarTrabajo(arguments, opciones);
+}
+
+
+Constantes::ErrorCode Lote::ejecutarTrabajo(const std::vector<std::string> &arguments,
+                                            const Opciones &opcionesTrabajo) {
+    Argumentos argumentos;
+    argumentos.opciones = opcionesTrabajo;
+    Constantes::ErrorCode errorCode = comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments,
+                                                           argumentos);
+    if (errorCode != Constantes::ErrorCode::NO_ERROR) {
+        return errorCode;
+    }
+    if (!opcionesTrabajo.directorioCapas.empty()) {
+        return ejecutarPorCapas(argumentos);
+    }
+
+    Grid &mallaTrabajo = mallaPara(argumentos.fluid, opcionesTrabajo);
+    auto result = mallaTrabajo.simular_malla(argumentos.fluid);
+    if (opcionesTrabajo.nucleo == ModoNucleo::rapido) {
+        Nucleos::mostrarInforme(std::cout, calcularParametros(result.first, result.second).constAccTransf);
+    }
+    if (opcionesTrabajo.rangos > 1) {
+        std::vector<Block> blocks = ejecutarDistribuido(mallaTrabajo, argumentos, result.first, result.second);
+        return comprobarArgsSalida(arguments, argumentos, blocks);
+    }
+    std::vector<Block> &blocks = ejecutarIteraciones(mallaTrabajo, argumentos,
+                                                     calcularParametros(result.first, result.second, opcionesTrabajo),
+                                                     recursos);
+    errorCode = comprobarArgsSalida(arguments, argumentos, blocks);
+    return errorCode;
+}
+
+
+Constantes::ErrorCode Lote::ejecutarManifiesto(std::istream &manifiesto) {
+    Constantes::ErrorCode primerError = Constantes::ErrorCode::NO_ERROR;
+    std::string linea;
+    while (std::getline(manifiesto, linea)) {
+        std::istringstream campos(linea);
+        std::vector<std::string> arguments;
+        for (std::string campo; campos >> campo;) {
+            arguments.push_back(campo);
+        }
+        if (arguments.empty() || arguments[0].starts_with('#')) {
+            continue;
+        }
+        const Constantes::ErrorCode errorCode = ejecutarTrabajo(arguments);
+        if (errorCode != Constantes::ErrorCode::NO_ERROR && primerError == Constantes::ErrorCode::NO_ERROR) {
+            primerError = errorCode;
+        }
+    }
+    return primerError;
+}
+
+
+// Funcion que devuelve la malla del trabajo: la del anterior si tiene la misma longitud de suavizado y el mismo tipo
+// (asi "simular_malla" no la vuelve a dividir) o una nueva
+Grid &Lote::mallaPara(const Fluid &fluid, const Opciones &opcionesTrabajo) {
+    const double smoothingLength = Constantes::multRadio / fluid.particlespermeter;
+    const bool dispersa = opcionesTrabajo.mallaDispersa && opcionesTrabajo.rangos <= 1;
+    if (!malla || smoothingLength != longitudMalla || malla->getDisperso() != dispersa ||
+        malla->getSubdivision() != opcionesTrabajo.subdivision) {
+        malla = std::make_unique<Grid>(Constantes::limInferior, Constantes::limSuperior);
+        malla->setDisperso(dispersa);
+        malla->setSubdivision(opcionesTrabajo.subdivision);
+        longitudMalla = smoothingLength;
+        ++mallasCreadas;
+    }
+    return *malla;
+}
+
+
+Constantes::ErrorCode ejecutarLote(const Opciones &opciones) {
+    std::ifstream manifiesto(opciones.manifiesto);
+    if (!manifiesto) {
+        std::cerr << "Error: Cannot open " << opciones.manifiesto << " for reading\n";
+        return Constantes::ErrorCode::CANNOT_OPEN_FILE_READING;
+    }
+    Lote lote(opciones);
+    return lote.ejecutarManifiesto(manifiesto);
+}
@@ -0,0 +1,47 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_LOTE_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_LOTE_HPP
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sim/constantes.hpp"
+#include "sim/paralelo.hpp"
+#include "sim/progargs.hpp"
+
+// Modo por lotes: ejecuta muchos trabajos (iteraciones, fichero de entrada, fichero de salida) en el mismo proceso.
+// La malla, sus bloques, los bloques de trabajo y los motores paralelos se reutilizan entre trabajos mientras la
+// longitud de suavizado (que depende de las particulas por metro) no cambie
+class Lote {
+public:
+    explicit Lote(const Opciones &opciones);
+
+    // Ejecuta un trabajo con los argumentos posicionales de "fluid"
+    Constantes::ErrorCode ejecutarTrabajo(const std::vector<std::string> &arguments);
+
+    // Lo mismo con otras opciones (los motores paralelos se crean con las del primer trabajo que los usa, y la
+    // malla se vuelve a crear si cambia su subdivision o si es dispersa)
+    Constantes::ErrorCode ejecutarTrabajo(const std::vector<std::string> &arguments, const Opciones &opcionesTrabajo);
+
+    // Ejecuta los trabajos del manifiesto (una linea "iteraciones entrada salida" por trabajo; se ignoran las lineas
+    // vacias y las que empiezan por "#"). Un trabajo con error no detiene a los demas; se devuelve el primer error
+    Constantes::ErrorCode ejecutarManifiesto(std::istream &manifiesto);
+
+    // Numero de veces que se ha tenido que crear la malla
+    [[nodiscard]] inline int getMallasCreadas() const { return mallasCreadas; }
+
+private:
+    Opciones opciones;
+    std::unique_ptr<Grid> malla;
+    RecursosSimulacion recursos;
+    double longitudMalla{0.0};
+    int mallasCreadas{0};
+
+    Grid &mallaPara(const Fluid &fluid, const Opciones &opcionesTrabajo);
+};
+
+// Ejecuta el manifiesto de "opciones.manifiesto" con un lote
+Constantes::ErrorCode ejecutarLote(const Opciones &opciones);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_LOTE_HPP
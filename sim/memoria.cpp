@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#include <sys/resource.h>
+#include "memoria.hpp"
+
+// NOLINTBEGIN(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory,hicpp-no-malloc)
+namespace {
+    constexpr std::size_t capacidadInicial = 1024;
+    constexpr std::uintptr_t multiplicadorHash = 0x9E3779B97F4A7C15ULL;
+    constexpr int bitsAlineacion = 4; // Los punteros de malloc estan alineados a 16 bytes
+
+    // Reservas contadas que aun no se han liberado: una tabla abierta con sondeo lineal (y borrado desplazando las
+    // siguientes, sin marcas) sobre calloc y free, no sobre "operator new". Asi solo se anotan las liberaciones de
+    // reservas contadas y no las de las anteriores a empezar a contar
+    class ReservasContadas {
+    public:
+        // Devuelve false si no hay memoria para la tabla (entonces la reserva no se cuenta)
+        bool insertar(void *puntero) {
+            const std::scoped_lock bloqueo(mutex);
+            if (2 * (ocupadas + 1) > capacidad && !crecer()) {
+                return false;
+            }
+            colocar(puntero);
+            ++ocupadas;
+            return true;
+        }
+
+        // Quita el puntero y devuelve si estaba
+        bool quitar(void *puntero) {
+            const std::scoped_lock bloqueo(mutex);
+            if (capacidad == 0) {
+                return false;
+            }
+            std::size_t posicion = inicio(puntero);
+            while (tabla[posicion] != puntero) {
+                if (tabla[posicion] == nullptr) {
+                    return false;
+                }
+                posicion = (posicion + 1) & (capacidad - 1);
+            }
+            desplazar(posicion);
+            --ocupadas;
+            return true;
+        }
+
+        void vaciar() {
+            const std::scoped_lock bloqueo(mutex);
+            for (std::size_t posicion = 0; posicion < capacidad; ++posicion) {
+                tabla[posicion] = nullptr;
+            }
+            ocupadas = 0;
+        }
+
+    private:
+        void **tabla{nullptr}; // No se libera: dura lo que el proceso
+        std::size_t capacidad{0}; // Potencia de 2
+        std::size_t ocupadas{0};
+        std::mutex mutex;
+
+        [[nodiscard]] std::size_t inicio(void *puntero) const {
+            const auto direccion = reinterpret_cast<std::uintptr_t>(puntero); // NOLINT(*-reinterpret-cast)
+            return static_cast<std::size_t>((direccion >> bitsAlineacion) * multiplicadorHash) & (capacidad - 1);
+        }
+
+        void colocar(void *puntero) {
+            std::size_t posicion = inicio(puntero);
+            while (tabla[posicion] != nullptr) {
+                posicion = (posicion + 1) & (capacidad - 1);
+            }
+            tabla[posicion] = puntero;
+        }
+
+        // Funcion que duplica la tabla y vuelve a colocar sus punteros
+        bool crecer() {
+            const std::size_t nuevaCapacidad = std::max(capacidadInicial, 2 * capacidad);
+            auto *nueva = static_cast<void **>(std::calloc(nuevaCapacidad, sizeof(void *)));
+            if (nueva == nullptr) {
+                return false;
+            }
+            void **anterior = tabla;
+            const std::size_t capacidadAnterior = capacidad;
+            tabla = nueva;
+            capacidad = nuevaCapacidad;
+            for (std::size_t i = 0; i < capacidadAnterior; ++i) {
+                if (anterior[i] != nullptr) {
+                    colocar(anterior[i]);
+                }
+            }
+            std::free(static_cast<void *>(anterior));
+            return true;
+        }
+
+        // Funcion que vacia la posicion y adelanta los punteros siguientes que ya no se encontrarian con el hueco
+        void desplazar(std::size_t hueco) {
+            for (std::size_t siguiente = (hueco + 1) & (capacidad - 1); tabla[siguiente] != nullptr;
+                 siguiente = (siguiente + 1) & (capacidad - 1)) {
+                // Distancias (circulares) desde la posicion ideal del puntero hasta el hueco y hasta donde esta
+                const std::size_t ideal = inicio(tabla[siguiente]);
+                if (((hueco - ideal) & (capacidad - 1)) < ((siguiente - ideal) & (capacidad - 1))) {
+                    tabla[hueco] = tabla[siguiente];
+                    hueco = siguiente;
+                }
+            }
+            tabla[hueco] = nullptr;
+        }
+    };
+
+    std::atomic<bool> contando{false};
+    std::atomic<long> reservas{0};
+    std::atomic<long> liberaciones{0};
+    std::atomic<long> bytesReservados{0};
+    std::atomic<long> bytesLiberados{0};
+    std::atomic<long> vivos{0};
+    std::atomic<long> pico{0};
+    ReservasContadas contadas;
+
+    void anotarReserva(void *puntero) {
+        if (!contadas.insertar(puntero)) {
+            return;
+        }
+        const auto bytes = static_cast<long>(malloc_usable_size(puntero));
+        reservas.fetch_add(1, std::memory_order_relaxed);
+        bytesReservados.fetch_add(bytes, std::memory_order_relaxed);
+        const long ahora = vivos.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        long anterior = pico.load(std::memory_order_relaxed);
+        while (ahora > anterior && !pico.compare_exchange_weak(anterior, ahora, std::memory_order_relaxed)) {
+        }
+    }
+
+    void anotarLiberacion(void *puntero) {
+        if (!contadas.quitar(puntero)) { // Reservada antes de empezar a contar
+            return;
+        }
+        const auto bytes = static_cast<long>(malloc_usable_size(puntero));
+        liberaciones.fetch_add(1, std::memory_order_relaxed);
+        bytesLiberados.fetch_add(bytes, std::memory_order_relaxed);
+        vivos.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // Reserva como el "operator new" estandar: si no hay memoria, llama al new_handler y lo vuelve a intentar
+    void *reservar(std::size_t bytes, std::size_t alineacion) {
+        bytes = bytes == 0 ? 1 : bytes;
+        void *puntero = nullptr;
+        while ((alineacion <= alignof(std::max_align_t) ? (puntero = std::malloc(bytes)) == nullptr
+                                                        : ::posix_memalign(&puntero, alineacion, bytes) != 0)) {
+            const std::new_handler manejador = std::get_new_handler();
+            if (manejador == nullptr) {
+                throw std::bad_alloc();
+            }
+            manejador();
+        }
+        if (contando.load(std::memory_order_relaxed)) {
+            anotarReserva(puntero);
+        }
+        return puntero;
+    }
+
+    void *reservarSinExcepcion(std::size_t bytes, std::size_t alineacion) noexcept {
+        try {
+            return reservar(bytes, alineacion);
+        } catch (const std::bad_alloc &) {
+            return nullptr;
+        }
+    }
+
+    void liberar(void *puntero) noexcept {
+        if (puntero != nullptr && contando.load(std::memory_order_relaxed)) {
+            anotarLiberacion(puntero);
+        }
+        std::free(puntero);
+    }
+}
+
+
+void *operator new(std::size_t bytes) { return reservar(bytes, 0); }
+
+void *operator new[](std::size_t bytes) { return reservar(bytes, 0); }
+
+void *operator new(std::size_t bytes, const std::nothrow_t & /*etiqueta*/) noexcept {
+    return reservarSinExcepcion(bytes, 0);
+}
+
+void *operator new[](std::size_t bytes, const std::nothrow_t & /*etiqueta*/) noexcept {
+    return reservarSinExcepcion(bytes, 0);
+}
+
+void *operator new(std::size_t bytes, std::align_val_t alineacion) {
+    return reservar(bytes, static_cast<std::size_t>(alineacion));
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t alineacion) {
+    return reservar(bytes, static_cast<std::size_t>(alineacion));
+}
+
+void *operator new(std::size_t bytes, std::align_val_t alineacion, const std::nothrow_t & /*etiqueta*/) noexcept {
+    return reservarSinExcepcion(bytes, static_cast<std::size_t>(alineacion));
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t alineacion, const std::nothrow_t & /*etiqueta*/) noexcept {
+    return reservarSinExcepcion(bytes, static_cast<std::size_t>(alineacion));
+}
+
+void operator delete(void *puntero) noexcept { liberar(puntero); }
+
+void operator delete[](void *puntero) noexcept { liberar(puntero); }
+
+void operator delete(void *puntero, std::size_t /*bytes*/) noexcept { liberar(puntero); }
+
+void operator delete[](void *puntero, std::size_t /*bytes*/) noexcept { liberar(puntero); }
+
+void operator delete(void *puntero, const std::nothrow_t & /*etiqueta*/) noexcept { liberar(puntero); }
+
+void operator delete[](void *puntero, const std::nothrow_t & /*etiqueta*/) noexcept { liberar(puntero); }
+
+void operator delete(void *puntero, std::align_val_t /*alineacion*/) noexcept { liberar(puntero); }
+
+void operator delete[](void *puntero, std::align_val_t /*alineacion*/) noexcept { liberar(puntero); }
+
+void operator delete(void *puntero, std::size_t /*bytes*/, std::align_val_t /*alineacion*/) noexcept {
+    liberar(puntero);
+}
+
+void operator delete[](void *puntero, std::size_t /*bytes*/, std::align_val_t /*alineacion*/) noexcept {
+    liberar(puntero);
+}
+
+void operator delete(void *puntero, std::align_val_t /*alineacion*/, const std::nothrow_t & /*etiqueta*/) noexcept {
+    liberar(puntero);
+}
+
+void operator delete[](void *puntero, std::align_val_t /*alineacion*/, const std::nothrow_t & /*etiqueta*/) noexcept {
+    liberar(puntero);
+}
+// NOLINTEND(cppcoreguidelines-no-malloc,cppcoreguidelines-owning-memory,hicpp-no-malloc)
+
+
+namespace ContadorMemoria {
+    void activar(bool contar) {
+        if (contar && !contando.load(std::memory_order_relaxed)) { // Lo reservado hasta ahora ya no se sigue
+            contadas.vaciar();
+            vivos.store(0, std::memory_order_relaxed);
+            pico.store(0, std::memory_order_relaxed);
+        }
+        contando.store(contar, std::memory_order_relaxed);
+    }
+
+    Recuento leer() {
+        return {reservas.load(std::memory_order_relaxed), liberaciones.load(std::memory_order_relaxed),
+                bytesReservados.load(std::memory_order_relaxed), bytesLiberados.load(std::memory_order_relaxed)};
+    }
+
+    long bytesVivos() {
+        return vivos.load(std::memory_order_relaxed);
+    }
+
+    long tomarPico() {
+        return pico.exchange(vivos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    long rssMaximoKb() {
+        rusage uso{};
+        ::getrusage(RUSAGE_SELF, &uso);
+        return uso.ru_maxrss;
+    }
+}
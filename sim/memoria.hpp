@@ -0,0 +1,33 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_MEMORIA_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_MEMORIA_HPP
+
+// Contadores de memoria (--memory-stats). La biblioteca sustituye los "operator new" y "operator delete" globales
+// por unos que usan malloc y free y, solo mientras se cuenta, anotan cada reserva y liberacion con el tamaño real
+// del bloque (malloc_usable_size). Solo se anota la liberacion de una reserva contada, asi que liberar lo reservado
+// antes de empezar a contar no descuadra los bytes vivos. Sin contar solo añaden una comparacion. Las particulas que
+// el pool reutiliza no llegan a estos operadores: solo se cuentan los trozos nuevos que pide al sistema
+namespace ContadorMemoria {
+    struct Recuento {
+        long reservas;
+        long liberaciones;
+        long bytesReservados;
+        long bytesLiberados;
+    };
+
+    // Empieza o deja de contar (los contadores conservan sus valores; al empezar, los bytes vivos vuelven a 0)
+    void activar(bool contar);
+
+    [[nodiscard]] Recuento leer();
+
+    // Bytes reservados y aun no liberados desde que se empezo a contar
+    [[nodiscard]] long bytesVivos();
+
+    // Maximo de bytes vivos desde la llamada anterior (el maximo vuelve a empezar en los bytes vivos actuales)
+    [[nodiscard]] long tomarPico();
+
+    // Maximo de memoria residente del proceso hasta ahora, en KiB
+    [[nodiscard]] long rssMaximoKb();
+}
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_MEMORIA_HPP
@@ -0,0 +1,150 @@
+#include <map>
+#include "motores.hpp"
+#include "paralelo.hpp"
+
+namespace {
+    // Colisiones, movimiento y limites en serie, cada etapa medida por separado
+    void movimientoSerie(const ContextoIteracion &contexto, double paso) {
+        std::vector<Block> &blocks = contexto.recursos.bloques;
+        const Grid &malla = contexto.malla;
+        const Punto numBloques{malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz()};
+        const int subdivision = malla.getSubdivision();
+        TiemposEtapas &tiempos = contexto.recursos.tiempos;
+        tiempos.medir(Etapa::colisiones, [&] { particleColissions(blocks, numBloques, paso, subdivision); });
+        tiempos.medir(Etapa::movimiento, [&] { particlesMovement(blocks, paso); });
+        tiempos.medir(Etapa::limites, [&] { limitInteractions(blocks, numBloques, subdivision); });
+    }
+
+    void interaccionesGather(const ContextoIteracion &contexto) {
+        contexto.recursos.tiempos.medir(Etapa::interacciones, [&] {
+            interaccionesBloques(contexto.recursos.bloques, contexto.malla, contexto.parametros);
+        });
+    }
+
+    // La version en serie original: cada par se calcula una vez y se suma a sus dos particulas
+    class MotorEscalar : public Motor {
+    public:
+        void reposicionar(const ContextoIteracion &contexto) override {
+            contexto.malla.reposicionarParticulasBloque(contexto.recursos.bloques);
+        }
+
+        void interacciones(const ContextoIteracion &contexto) override {
+            std::vector<Block> &blocks = contexto.recursos.bloques;
+            const ParametrosSimulacion &parametros = contexto.parametros;
+            TiemposEtapas &tiempos = contexto.recursos.tiempos;
+            // El nucleo rapido, la lista de pares y el reposo solo tienen versiones "gather" (paralelo.hpp)
+            if (parametros.nucleo == ModoNucleo::rapido || parametros.listaPares || contexto.recursos.reposo.activo()) {
+                interaccionesGather(contexto);
+                return;
+            }
+            tiempos.medir(Etapa::densidades, [&] {
+                incrementDensities(blocks, parametros.constAccTransf.hSquared, contexto.malla);
+            });
+            tiempos.medir(Etapa::transformacion, [&] {
+                transformDensities(blocks, parametros.smoothingLength, parametros.factorDensTransf);
+            });
+            tiempos.medir(Etapa::aceleraciones, [&] {
+                transferAcceleration(blocks, parametros.constAccTransf, contexto.malla);
+            });
+        }
+
+        void movimiento(const ContextoIteracion &contexto, double paso) override {
+            movimientoSerie(contexto, paso);
+        }
+    };
+
+    // Las versiones "gather" en serie: cada particula acumula las contribuciones de sus vecinas
+    class MotorGather final : public MotorEscalar {
+    public:
+        void interacciones(const ContextoIteracion &contexto) override {
+            interaccionesGather(contexto);
+        }
+    };
+
+    // Las versiones "gather" como bucles paralelos por bloque (las etapas de cada grupo se miden juntas)
+    class MotorHilos final : public Motor {
+    public:
+        explicit MotorHilos(const Opciones &opciones) : paralelas(hilosEfectivos(opciones), opciones.fijarHilos) {}
+
+        void reposicionar(const ContextoIteracion &contexto) override {
+            paralelas.reposicionar(contexto.recursos.bloques, contexto.malla);
+        }
+
+        void interacciones(const ContextoIteracion &contexto) override {
+            contexto.recursos.tiempos.medir(Etapa::interacciones, [&] {
+                paralelas.interacciones(contexto.recursos.bloques, contexto.malla, contexto.parametros);
+            });
+        }
+
+        void movimiento(const ContextoIteracion &contexto, double paso) override {
+            const Grid &malla = contexto.malla;
+            const Punto numBloques{malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz()};
+            contexto.recursos.tiempos.medir(Etapa::movimiento, [&] {
+                paralelas.movimiento(contexto.recursos.bloques, numBloques, paso, malla.getSubdivision());
+            });
+        }
+
+    private:
+        EtapasParalelas paralelas;
+    };
+
+    // Registro de motores, con los de la biblioteca desde el primer uso
+    std::map<std::string, FabricaMotor> &registro() {
+        static std::map<std::string, FabricaMotor> motores = {
+                {"scalar", [](const Opciones & /*opciones*/) -> std::unique_ptr<Motor> {
+                    return std::make_unique<MotorEscalar>();
+                }},
+                {"gather", [](const Opciones & /*opciones*/) -> std::unique_ptr<Motor> {
+                    return std::make_unique<MotorGather>();
+                }},
+                {"threads", [](const Opciones &opciones) -> std::unique_ptr<Motor> {
+                    return std::make_unique<MotorHilos>(opciones);
+                }},
+        };
+        return motores;
+    }
+}
+
+
+void Motor::ejecutar(const ContextoIteracion &contexto, Etapa etapa, double paso) {
+    if (etapa == Etapa::reposicion) {
+        reposicionar(contexto);
+    } else if (etapa == Etapa::interacciones) {
+        interacciones(contexto);
+    } else {
+        movimiento(contexto, paso);
+    }
+}
+
+
+void registrarMotor(const std::string &nombre, FabricaMotor fabrica) {
+    registro()[nombre] = fabrica;
+}
+
+
+bool existeMotor(const std::string &nombre) {
+    return registro().contains(nombre);
+}
+
+
+std::vector<std::string> nombresMotores() {
+    std::vector<std::string> nombres;
+    for (const auto &[nombre, fabrica]: registro()) {
+        nombres.push_back(nombre);
+    }
+    return nombres;
+}
+
+
+std::unique_ptr<Motor> crearMotor(const std::string &nombre, const Opciones &opciones) {
+    const auto motor = registro().find(nombre);
+    return motor == registro().end() ? nullptr : motor->second(opciones);
+}
+
+
+std::string nombreMotor(const Opciones &opciones) {
+    if (!opciones.motor.empty()) {
+        return opciones.motor;
+    }
+    return !opciones.grafoTareas && opciones.hilos > 0 ? "threads" : "scalar";
+}
@@ -0,0 +1,55 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_MOTORES_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_MOTORES_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "sim/progargs.hpp"
+#include "sim/simulacion.hpp"
+#include "sim/tiempos.hpp"
+
+// Motor de calculo: ejecuta las etapas de una iteracion sobre los bloques del contexto (contexto.recursos.bloques)
+// y mide en contexto.recursos.tiempos las que ejecuta por separado. La inicializacion, la reordenacion y el grafo de
+// tareas no dependen del motor
+class Motor {
+public:
+    Motor() = default;
+    Motor(const Motor &) = delete;
+    Motor &operator=(const Motor &) = delete;
+    Motor(Motor &&) = delete;
+    Motor &operator=(Motor &&) = delete;
+    virtual ~Motor() = default;
+
+    virtual void reposicionar(const ContextoIteracion &contexto) = 0;
+
+    // Densidades, transformacion y transferencia de aceleraciones (tras reposicionar)
+    virtual void interacciones(const ContextoIteracion &contexto) = 0;
+
+    // Colisiones, movimiento y limites con el paso dado
+    virtual void movimiento(const ContextoIteracion &contexto, double paso) = 0;
+
+    // Ejecuta la etapa "reposicion", "interacciones" o "movimiento" (el paso solo lo usa el movimiento)
+    void ejecutar(const ContextoIteracion &contexto, Etapa etapa, double paso);
+};
+
+// Crea un motor para las opciones de una simulacion
+using FabricaMotor = std::unique_ptr<Motor> (*)(const Opciones &opciones);
+
+// Motores registrados, por nombre. Al empezar estan los de la biblioteca: "scalar" (la version en serie original,
+// la referencia; con el nucleo rapido, la lista de pares o el reposo usa las versiones "gather" en serie, las
+// unicas que tienen), "gather" (las versiones "gather" en serie) y "threads" (las versiones "gather" en paralelo
+// sobre un pool de hilos, ver EtapasParalelas). Registrar un nombre que ya existe sustituye su motor
+void registrarMotor(const std::string &nombre, FabricaMotor fabrica);
+
+[[nodiscard]] bool existeMotor(const std::string &nombre);
+
+[[nodiscard]] std::vector<std::string> nombresMotores();
+
+// Devuelve nullptr si no hay un motor con ese nombre
+[[nodiscard]] std::unique_ptr<Motor> crearMotor(const std::string &nombre, const Opciones &opciones);
+
+// Motor de las opciones: el de --engine o, si no se da, "threads" con --threads (sin --task-graph) y si no "scalar"
+[[nodiscard]] std::string nombreMotor(const Opciones &opciones);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_MOTORES_HPP
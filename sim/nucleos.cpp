@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include "nucleos.hpp"
+
+
+namespace Nucleos {
+    void calcularInversas(Block &block) {
+        block.inversasDensidad.resize(block.particles.size());
+        for (std::size_t i = 0; i < block.particles.size(); ++i) {
+            block.inversasDensidad[i] = 1 / block.particles[i].density;
+        }
+    }
+
+
+    // Funcion que recorre "muestras" distancias al cuadrado repartidas en (0, h^2) y compara ambos nucleos
+    InformeNucleos compararConExactos(const Constantes::ConstAccTransf &constAccTransf, int muestras) {
+        InformeNucleos informe{0.0, 0.0, 0.0};
+        double maximoRadial = 0.0;
+        for (int muestra = 1; muestra <= muestras; ++muestra) {
+            const double distSquared = constAccTransf.hSquared * muestra / (muestras + 1);
+            const double densidad = std::pow(constAccTransf.hSquared - distSquared, 3);
+            const double errorDensidad = std::abs(densidadRapida(constAccTransf.hSquared, distSquared) - densidad);
+            informe.errorDensidad = std::max(informe.errorDensidad, errorDensidad / densidad);
+            const double raiz = 1 / std::sqrt(distSquared);
+            informe.errorRaiz = std::max(informe.errorRaiz, std::abs(raizInversa(distSquared) - raiz) / raiz);
+            const double dist = std::sqrt(std::max(distSquared, Constantes::smallQ));
+            const double radial = std::pow(constAccTransf.h - dist, 2) / dist;
+            maximoRadial = std::max(maximoRadial, radial);
+            informe.errorAceleracion = std::max(informe.errorAceleracion,
+                                                std::abs(factorRadialRapido(constAccTransf.h, distSquared) - radial));
+        }
+        if (maximoRadial > 0.0) {
+            informe.errorAceleracion /= maximoRadial;
+        }
+        return informe;
+    }
+
+
+    void mostrarInforme(std::ostream &salida, const Constantes::ConstAccTransf &constAccTransf) {
+        constexpr int muestrasInforme = 10000;
+        const InformeNucleos informe = compararConExactos(constAccTransf, muestrasInforme);
+        salida << "Kernel: fast (max relative error: density " << informe.errorDensidad << ", 1/sqrt "
+               << informe.errorRaiz << ", acceleration " << informe.errorAceleracion << ")\n";
+    }
+}
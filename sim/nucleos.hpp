@@ -0,0 +1,86 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_NUCLEOS_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_NUCLEOS_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <ostream>
+#include <tuple>
+#include "sim/block.hpp"
+#include "sim/constantes.hpp"
+
+// Nucleos de suavizado de las interacciones entre pares. El exacto usa las expresiones originales (pow, sqrt y
+// divisiones); el rapido las evalua a partir de la distancia al cuadrado con una raiz inversa aproximada y las
+// inversas de las densidades calculadas una vez por particula, a cambio de un error acotado (ver compararConExactos)
+enum class ModoNucleo { exacto, rapido };
+
+namespace Nucleos {
+    // Pasos de Newton tras la aproximacion inicial de la raiz inversa (cada paso eleva el error relativo al cuadrado)
+    constexpr int pasosNewton = 3;
+
+    // Funcion que aproxima 1/sqrt(x) a partir de los bits de x y la refina con "pasosNewton" pasos de Newton
+    inline double raizInversa(double valor) {
+        constexpr std::uint64_t magico = 0x5FE6EB50C7B537A9;
+        constexpr double tresMedios = 1.5;
+        double raiz = std::bit_cast<double>(magico - (std::bit_cast<std::uint64_t>(valor) >> 1U));
+        const double mitad = valor * Constantes::factor05;
+        for (int paso = 0; paso < pasosNewton; ++paso) {
+            raiz = raiz * (tresMedios - mitad * raiz * raiz);
+        }
+        return raiz;
+    }
+
+    // Incremento de densidad de un par, (h^2 - d^2)^3, sin pow
+    inline double densidadRapida(double hSquared, double distSquared) {
+        const double diferencia = hSquared - distSquared;
+        return diferencia * diferencia * diferencia;
+    }
+
+    // (h - d)^2 / d a partir de d^2 (es el factor radial de la aceleracion)
+    inline double factorRadialRapido(double h, double distSquared) {
+        const double acotada = std::max(distSquared, Constantes::smallQ);
+        const double inversaDist = raizInversa(acotada);
+        const double hMenosDist = h - acotada * inversaDist;
+        return hMenosDist * hMenosDist * inversaDist;
+    }
+
+    // Lo que el nucleo rapido necesita de un par ademas de las particulas
+    struct FactoresPar {
+        double distSquared;
+        double inversaDensidades; // 1 / (densidad1 * densidad2)
+    };
+
+    // Aceleracion de un par con el nucleo rapido
+    inline std::tuple<double, double, double> deltasRapidos(const Particle &particle1, const Particle &particle2,
+                                                            const Constantes::ConstAccTransf &constAccTransf,
+                                                            const FactoresPar &par) {
+        const double deltaDensity = particle1.density + particle2.density - 2 * Constantes::densFluido;
+        const double factorcomun = constAccTransf.commonFactor * factorRadialRapido(constAccTransf.h, par.distSquared) *
+                                   deltaDensity;
+        const double factor2 = constAccTransf.factor2;
+        return {((particle1.px - particle2.px) * factorcomun + (particle2.vx - particle1.vx) * factor2) *
+                par.inversaDensidades,
+                ((particle1.py - particle2.py) * factorcomun + (particle2.vy - particle1.vy) * factor2) *
+                par.inversaDensidades,
+                ((particle1.pz - particle2.pz) * factorcomun + (particle2.vz - particle1.vz) * factor2) *
+                par.inversaDensidades};
+    }
+
+    // Guarda en el bloque la inversa de la densidad (ya transformada) de cada una de sus particulas
+    void calcularInversas(Block &block);
+
+    // Errores maximos del nucleo rapido frente al exacto en todo el radio de suavizado: relativos para la densidad
+    // y la raiz inversa, y relativos al maximo del factor radial para la aceleracion (que se anula en d = h)
+    struct InformeNucleos {
+        double errorDensidad;
+        double errorRaiz;
+        double errorAceleracion;
+    };
+
+    InformeNucleos compararConExactos(const Constantes::ConstAccTransf &constAccTransf, int muestras);
+
+    void mostrarInforme(std::ostream &salida, const Constantes::ConstAccTransf &constAccTransf);
+}
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_NUCLEOS_HPP
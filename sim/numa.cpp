@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <numeric>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include "numa.hpp"
+
+
+namespace {
+    // Lee el numero que empieza en "texto" y avanza tras el (0 si no hay numero)
+    int leerNumero(std::string_view &texto) {
+        int numero = 0;
+        const auto resultado = std::from_chars(texto.data(), texto.data() + texto.size(), numero);
+        texto.remove_prefix(static_cast<std::size_t>(resultado.ptr - texto.data()));
+        return numero;
+    }
+}
+
+
+namespace Numa {
+    std::vector<std::vector<int>> leerTopologia(const std::string &raiz) {
+        std::vector<std::vector<int>> nodos;
+        for (int nodo = 0;; ++nodo) {
+            std::ifstream fichero(raiz + "/node" + std::to_string(nodo) + "/cpulist");
+            std::string lista;
+            if (!fichero || !std::getline(fichero, lista)) {
+                break;
+            }
+            std::vector<int> cpus = parsearListaCpus(lista);
+            if (!cpus.empty()) { // Los nodos solo de memoria no tienen CPUs a las que fijar hilos
+                nodos.push_back(std::move(cpus));
+            }
+        }
+        if (nodos.empty()) {
+            nodos.emplace_back(std::max(1U, std::thread::hardware_concurrency()));
+            std::iota(nodos[0].begin(), nodos[0].end(), 0);
+        }
+        return nodos;
+    }
+
+
+    std::vector<int> parsearListaCpus(std::string_view lista) {
+        std::vector<int> cpus;
+        while (!lista.empty() && lista.front() >= '0' && lista.front() <= '9') {
+            const int primera = leerNumero(lista);
+            int ultima = primera;
+            if (!lista.empty() && lista.front() == '-') {
+                lista.remove_prefix(1);
+                ultima = leerNumero(lista);
+            }
+            for (int cpu = primera; cpu <= ultima; ++cpu) {
+                cpus.push_back(cpu);
+            }
+            if (!lista.empty() && lista.front() == ',') {
+                lista.remove_prefix(1);
+            }
+        }
+        return cpus;
+    }
+
+
+    // El hilo i va al nodo i * numNodos / numHilos, y dentro del nodo a su siguiente CPU (dando la vuelta si hay
+    // mas hilos que CPUs en el nodo)
+    std::vector<int> asignarCpus(const std::vector<std::vector<int>> &nodos, int numHilos) {
+        std::vector<int> cpus;
+        std::vector<std::size_t> usadas(nodos.size(), 0);
+        const auto numNodos = static_cast<int>(nodos.size());
+        for (int hilo = 0; hilo < numHilos; ++hilo) {
+            const auto nodo = static_cast<std::size_t>(hilo * numNodos / numHilos);
+            const std::vector<int> &cpusNodo = nodos[nodo];
+            cpus.push_back(cpusNodo[usadas[nodo]++ % cpusNodo.size()]);
+        }
+        return cpus;
+    }
+
+
+    bool fijarHiloActual(int cpu) {
+        cpu_set_t conjunto;
+        CPU_ZERO(&conjunto);
+        CPU_SET(static_cast<std::size_t>(cpu), &conjunto);
+        return ::pthread_setaffinity_np(::pthread_self(), sizeof(conjunto), &conjunto) == 0;
+    }
+}
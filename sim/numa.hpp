@@ -0,0 +1,25 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_NUMA_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_NUMA_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Topologia NUMA de la maquina y fijacion de hilos a CPUs (Linux)
+namespace Numa {
+    // CPUs de cada nodo (con CPUs) segun "raiz/nodeN/cpulist". Si no se puede leer, un unico nodo con todas
+    std::vector<std::vector<int>> leerTopologia(const std::string &raiz = "/sys/devices/system/node");
+
+    // Convierte una lista de CPUs del kernel ("0-3,8,10-11") en la lista de sus numeros
+    std::vector<int> parsearListaCpus(std::string_view lista);
+
+    // CPU de cada hilo. Los hilos consecutivos (que reciben rangos de bloques consecutivos) van al mismo nodo, asi
+    // cada nodo se queda con una parte contigua de la malla
+    std::vector<int> asignarCpus(const std::vector<std::vector<int>> &nodos, int numHilos);
+
+    // Fija el hilo que llama a una CPU; devuelve false si el sistema no lo permite
+    bool fijarHiloActual(int cpu);
+}
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_NUMA_HPP
@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <tuple>
+#include "paralelo.hpp"
+#include "numa.hpp"
+#include "nucleos.hpp"
+
+
+int hilosEfectivos(const Opciones &opciones) {
+    if (opciones.hilos > 0) {
+        return opciones.hilos;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+
+// Funcion que calcula la densidad (sin transformar) de las particulas de un bloque
+void densidadesBloque(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla) {
+    Block &block1 = blocks[indice];
+    for (auto &particle1: block1.particles) {
+        malla.paraCadaVecino(block1, [&](int neighborIndex) {
+            for (const auto &particle2: blocks[neighborIndex].particles) {
+                if (particle1.id != particle2.id) {
+                    double const deltaX = particle1.px - particle2.px;
+                    double const deltaY = particle1.py - particle2.py;
+                    double const deltaZ = particle1.pz - particle2.pz;
+                    double const distSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                    if (distSquared < hSquared) {
+                        particle1.density += std::pow(((hSquared) - distSquared), 3);
+                    }
+                }
+            }
+        });
+    }
+}
+
+
+// Funcion que calcula la aceleracion de las particulas de un bloque (la contribucion de cada par es antisimetrica,
+// asi que sumarla solo en "particle1" desde ambos lados da el mismo resultado que restarla en "particle2")
+void aceleracionesBloque(std::vector<Block> &blocks, int indice, const Constantes::ConstAccTransf &constAccTransf,
+                         const Grid &malla) {
+    Block &block1 = blocks[indice];
+    for (auto &particle1: block1.particles) {
+        malla.paraCadaVecino(block1, [&](int neighborIndex) {
+            for (const auto &particle2: blocks[neighborIndex].particles) {
+                if (particle1.id != particle2.id) {
+                    double const deltaX = particle1.px - particle2.px;
+                    double const deltaY = particle1.py - particle2.py;
+                    double const deltaZ = particle1.pz - particle2.pz;
+                    double const distSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                    if (distSquared < constAccTransf.hSquared) {
+                        auto [deltaAijX, deltaAijY, deltaAijZ] =
+                                calcularDeltas(particle1, particle2, constAccTransf, distSquared);
+                        particle1.ax += deltaAijX;
+                        particle1.ay += deltaAijY;
+                        particle1.az += deltaAijZ;
+                    }
+                }
+            }
+        });
+    }
+}
+
+
+namespace {
+    // Densidad con el nucleo rapido (sin pow)
+    void densidadesBloqueRapido(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla) {
+        Block &block1 = blocks[indice];
+        for (auto &particle1: block1.particles) {
+            malla.paraCadaVecino(block1, [&](int neighborIndex) {
+                for (const auto &particle2: blocks[neighborIndex].particles) {
+                    double const deltaX = particle1.px - particle2.px;
+                    double const deltaY = particle1.py - particle2.py;
+                    double const deltaZ = particle1.pz - particle2.pz;
+                    double const distSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                    if (particle1.id != particle2.id && distSquared < hSquared) {
+                        particle1.density += Nucleos::densidadRapida(hSquared, distSquared);
+                    }
+                }
+            });
+        }
+    }
+
+    // Aceleracion con el nucleo rapido: sin sqrt ni divisiones por par (usa las inversas de las densidades)
+    void aceleracionesBloqueRapido(std::vector<Block> &blocks, int indice,
+                                   const Constantes::ConstAccTransf &constAccTransf, const Grid &malla) {
+        Block &block1 = blocks[indice];
+        for (std::size_t i = 0; i < block1.particles.size(); ++i) {
+            Particle &particle1 = block1.particles[i];
+            const double inversa1 = block1.inversasDensidad[i];
+            malla.paraCadaVecino(block1, [&](int neighborIndex) {
+                const Block &block2 = blocks[neighborIndex];
+                for (std::size_t j = 0; j < block2.particles.size(); ++j) {
+                    const Particle &particle2 = block2.particles[j];
+                    double const deltaX = particle1.px - particle2.px;
+                    double const deltaY = particle1.py - particle2.py;
+                    double const deltaZ = particle1.pz - particle2.pz;
+                    double const distSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                    if (particle1.id != particle2.id && distSquared < constAccTransf.hSquared) {
+                        const Nucleos::FactoresPar par{distSquared, inversa1 * block2.inversasDensidad[j]};
+                        auto [deltaAijX, deltaAijY, deltaAijZ] =
+                                Nucleos::deltasRapidos(particle1, particle2, constAccTransf, par);
+                        particle1.ax += deltaAijX;
+                        particle1.ay += deltaAijY;
+                        particle1.az += deltaAijZ;
+                    }
+                }
+            });
+        }
+    }
+
+    // Densidad con el nucleo exacto que ademas anota en el bloque los pares que interactuan, en el orden en que se
+    // suman (la densidad es la misma que la de densidadesBloque)
+    void densidadesBloqueLista(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla) {
+        Block &block1 = blocks[indice];
+        block1.pares.clear();
+        block1.finPares.clear();
+        for (auto &particle1: block1.particles) {
+            malla.paraCadaVecino(block1, [&](int neighborIndex) {
+                const VectorParticulas &particulas2 = blocks[neighborIndex].particles;
+                for (std::size_t j = 0; j < particulas2.size(); ++j) {
+                    double const deltaX = particle1.px - particulas2[j].px;
+                    double const deltaY = particle1.py - particulas2[j].py;
+                    double const deltaZ = particle1.pz - particulas2[j].pz;
+                    double const distSquared = deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ;
+                    if (particle1.id != particulas2[j].id && distSquared < hSquared) {
+                        particle1.density += std::pow(((hSquared) - distSquared), 3);
+                        const double distancia = std::sqrt(std::max(distSquared, Constantes::smallQ));
+                        block1.pares.push_back(ParVecino{neighborIndex - indice, static_cast<int>(j), distancia,
+                                                         1 / distancia});
+                    }
+                }
+            });
+            block1.finPares.push_back(static_cast<int>(block1.pares.size()));
+        }
+    }
+
+    // Contribucion de un par a la aceleracion de particle1 (las expresiones de calcularDeltas, con la distancia ya
+    // calculada)
+    std::tuple<double, double, double> deltasPar(const Particle &particle1, const Particle &particle2,
+                                                 const Constantes::ConstAccTransf &constAccTransf,
+                                                 const ParVecino &par) {
+        const double hMinusDistSquared = std::pow(constAccTransf.h - par.distancia, 2);
+        const double deltaDensity = (particle1.density + particle2.density - 2 * Constantes::densFluido);
+        const double densitydivmul = 1 / (particle1.density * particle2.density);
+        const double factorcomun = constAccTransf.commonFactor * hMinusDistSquared * par.inversaDistancia *
+                                   deltaDensity;
+        const double deltaAijX = ((particle1.px - particle2.px) * factorcomun +
+                                  (particle2.vx - particle1.vx) * constAccTransf.factor2) * densitydivmul;
+        const double deltaAijY = ((particle1.py - particle2.py) * factorcomun +
+                                  (particle2.vy - particle1.vy) * constAccTransf.factor2) * densitydivmul;
+        const double deltaAijZ = ((particle1.pz - particle2.pz) * factorcomun +
+                                  (particle2.vz - particle1.vz) * constAccTransf.factor2) * densitydivmul;
+        return std::make_tuple(deltaAijX, deltaAijY, deltaAijZ);
+    }
+
+    // Aceleracion a partir de los pares que anoto la etapa de densidades, sin recorrer los bloques vecinos (entre
+    // las dos etapas las particulas no cambian de bloque ni de orden)
+    void aceleracionesBloqueLista(std::vector<Block> &blocks, int indice,
+                                  const Constantes::ConstAccTransf &constAccTransf) {
+        Block &block1 = blocks[indice];
+        auto par = block1.pares.begin();
+        for (std::size_t i = 0; i < block1.particles.size(); ++i) {
+            Particle &particle1 = block1.particles[i];
+            for (const auto fin = block1.pares.begin() + block1.finPares[i]; par != fin; ++par) {
+                const Particle &particle2 = blocks[indice + par->desplazamiento].particles[par->indice];
+                auto [deltaAijX, deltaAijY, deltaAijZ] = deltasPar(particle1, particle2, constAccTransf, *par);
+                particle1.ax += deltaAijX;
+                particle1.ay += deltaAijY;
+                particle1.az += deltaAijZ;
+            }
+        }
+    }
+}
+
+
+void densidadesBloque(std::vector<Block> &blocks, int indice, const ParametrosSimulacion &parametros,
+                      const Grid &malla) {
+    if (blocks[indice].dormido) {
+        return;
+    }
+    if (parametros.nucleo == ModoNucleo::rapido) {
+        densidadesBloqueRapido(blocks, indice, parametros.constAccTransf.hSquared, malla);
+    } else if (parametros.determinista) {
+        densidadesBloqueOrdenado(blocks, indice, parametros.constAccTransf.hSquared, malla);
+    } else if (parametros.listaPares) {
+        densidadesBloqueLista(blocks, indice, parametros.constAccTransf.hSquared, malla);
+    } else {
+        densidadesBloque(blocks, indice, parametros.constAccTransf.hSquared, malla);
+    }
+}
+
+
+void aceleracionesBloque(std::vector<Block> &blocks, int indice, const ParametrosSimulacion &parametros,
+                         const Grid &malla) {
+    if (blocks[indice].dormido) {
+        return;
+    }
+    if (parametros.nucleo == ModoNucleo::rapido) {
+        aceleracionesBloqueRapido(blocks, indice, parametros.constAccTransf, malla);
+    } else if (parametros.determinista) {
+        aceleracionesBloqueOrdenado(blocks, indice, parametros.constAccTransf, malla);
+    } else if (parametros.listaPares) {
+        aceleracionesBloqueLista(blocks, indice, parametros.constAccTransf);
+    } else {
+        aceleracionesBloque(blocks, indice, parametros.constAccTransf, malla);
+    }
+}
+
+
+void interaccionesBloques(std::vector<Block> &blocks, const Grid &malla, const ParametrosSimulacion &parametros) {
+    const int numBloques = static_cast<int>(blocks.size());
+    for (int indice = 0; indice < numBloques; ++indice) {
+        densidadesBloque(blocks, indice, parametros, malla);
+    }
+    for (auto &block: blocks) {
+        transformarDensidadesBloque(block, parametros);
+    }
+    for (int indice = 0; indice < numBloques; ++indice) {
+        aceleracionesBloque(blocks, indice, parametros, malla);
+    }
+}
+
+
+IteracionGrafo::IteracionGrafo(int numHilos) : grafo(numHilos) {}
+
+
+void IteracionGrafo::ejecutar(std::vector<Block> &blocks, const Grid &malla, const ParametrosSimulacion &parametros,
+                              bool conMovimiento) {
+    bloques = &blocks;
+    mallaActual = &malla;
+    parametrosActuales = &parametros;
+    // En la malla densa los vecinos no cambian, asi que el grafo se reutiliza; en la dispersa se reconstruye
+    if (malla.getDisperso() || bloquesGrafo != blocks.size() || movimientoGrafo != conMovimiento ||
+        grafo.numTareas() == 0) {
+        construir(malla, conMovimiento);
+    }
+    grafo.ejecutar();
+}
+
+
+// Funcion que crea las tareas de cada bloque y sus dependencias con las tareas de los bloques vecinos
+void IteracionGrafo::construir(const Grid &malla, bool conMovimiento) {
+    grafo.vaciar();
+    const int numBloques = static_cast<int>(bloques->size());
+    std::vector<int> densidad(numBloques);
+    std::vector<int> transformacion(numBloques);
+    std::vector<int> aceleracion(numBloques);
+    for (int i = 0; i < numBloques; ++i) {
+        densidad[i] = grafo.agregarTarea([this, i] {
+            densidadesBloque(*bloques, i, *parametrosActuales, *mallaActual);
+        });
+        transformacion[i] = grafo.agregarTarea([this, i] {
+            transformarDensidadesBloque((*bloques)[i], *parametrosActuales);
+        });
+        aceleracion[i] = grafo.agregarTarea([this, i] {
+            aceleracionesBloque(*bloques, i, *parametrosActuales, *mallaActual);
+        });
+        grafo.agregarDependencia(densidad[i], transformacion[i]);
+    }
+    for (int i = 0; i < numBloques; ++i) {
+        const int movimiento = !conMovimiento ? -1 : grafo.agregarTarea([this, i] {
+            const Punto numBloquesMalla{mallaActual->getNumberblocksx(), mallaActual->getNumberblocksy(),
+                                        mallaActual->getNumberblocksz()};
+            Block &block = (*bloques)[i];
+            colisionesBloque(block, numBloquesMalla, Constantes::pasoTiempo, mallaActual->getSubdivision());
+            movimientoBloque(block, Constantes::pasoTiempo);
+            limitesBloque(block, numBloquesMalla, mallaActual->getSubdivision());
+        });
+        malla.paraCadaVecino((*bloques)[i], [&](int vecino) {
+            // La aceleracion necesita las densidades finales de los vecinos y el movimiento espera a que los
+            // vecinos hayan leido sus posiciones y velocidades
+            grafo.agregarDependencia(transformacion[vecino], aceleracion[i]);
+            if (movimiento >= 0) {
+                grafo.agregarDependencia(aceleracion[vecino], movimiento);
+            }
+        });
+    }
+    bloquesGrafo = bloques->size();
+    movimientoGrafo = conMovimiento;
+}
+
+
+namespace {
+    // Trozos por hilo: suficientes para que el robo de trabajo compense los desequilibrios
+    constexpr int trozosPorHilo = 8;
+}
+
+
+EtapasParalelas::EtapasParalelas(int numHilos, bool fijarHilos)
+        : pool(numHilos, fijarHilos ? Numa::asignarCpus(Numa::leerTopologia(), numHilos) : std::vector<int>{}) {}
+
+
+void EtapasParalelas::reposicionar(std::vector<Block> &blocks, Grid &malla) {
+    if (malla.getDisperso()) {
+        malla.reposicionarParticulasBloque(blocks);
+        return;
+    }
+    dividirEnTrozos(blocks);
+    malla.prepararReposicion();
+    std::atomic<int> lejanas{0};
+    paraCadaBloque([&](int indice) {
+        if (const int saltan = malla.anotarDestinos(blocks, indice); saltan > 0) {
+            lejanas += saltan;
+        }
+    });
+    paraCadaBloque([&](int indice) { malla.recogerParticulas(blocks, indice); });
+    malla.terminarReposicion(blocks, lejanas.load() > 0);
+}
+
+
+void EtapasParalelas::interacciones(std::vector<Block> &blocks, const Grid &malla,
+                                    const ParametrosSimulacion &parametros) {
+    dividirEnTrozos(blocks);
+    paraCadaBloque([&](int indice) {
+        densidadesBloque(blocks, indice, parametros, malla);
+    });
+    paraCadaBloque([&](int indice) {
+        transformarDensidadesBloque(blocks[indice], parametros);
+    });
+    paraCadaBloque([&](int indice) {
+        aceleracionesBloque(blocks, indice, parametros, malla);
+    });
+}
+
+
+// Los trozos de "interacciones" siguen siendo validos: entre ambas llamadas ninguna particula cambia de bloque
+void EtapasParalelas::movimiento(std::vector<Block> &blocks, const Punto &numBloques, double pasoTiempo,
+                                 int subdivision) {
+    paraCadaBloque([&](int indice) {
+        Block &block = blocks[indice];
+        colisionesBloque(block, numBloques, pasoTiempo, subdivision);
+        movimientoBloque(block, pasoTiempo);
+        limitesBloque(block, numBloques, subdivision);
+    });
+}
+
+
+// Funcion que reparte los bloques en trozos contiguos de peso parecido (cada bloque pesa sus particulas mas uno,
+// para que los bloques vacios tambien cuenten algo)
+void EtapasParalelas::dividirEnTrozos(const std::vector<Block> &blocks) {
+    const auto numTrozos = static_cast<std::size_t>(pool.numHilos() * trozosPorHilo);
+    const std::size_t total = std::accumulate(blocks.begin(), blocks.end(), blocks.size(),
+                                              [](std::size_t suma, const Block &block) {
+                                                  return suma + block.particles.size();
+                                              });
+    limites.clear();
+    limites.push_back(0);
+    std::size_t acumulado = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        acumulado += blocks[i].particles.size() + 1;
+        // Se cierra un trozo cada vez que el peso acumulado supera la siguiente fraccion del total
+        if (acumulado * numTrozos >= total * limites.size() && i + 1 < blocks.size()) {
+            limites.push_back(static_cast<int>(i + 1));
+        }
+    }
+    limites.push_back(static_cast<int>(blocks.size()));
+}
+
+
+void RecursosSimulacion::preparar(const Opciones &opciones) {
+    tiempos.reiniciar(!opciones.ficheroTiempos.empty() || !opciones.ficheroRoofline.empty() ||
+                      !opciones.ficheroTraza.empty(), !opciones.ficheroMemoria.empty());
+    Traza::activar(!opciones.ficheroTraza.empty());
+    reposo.reiniciar(opciones);
+    const std::string nombre = ::nombreMotor(opciones);
+    roofline.reiniciar(opciones, opciones.grafoTareas || nombre == "threads" ? hilosEfectivos(opciones) : 1);
+    if (opciones.grafoTareas && !grafo) {
+        grafo = std::make_unique<IteracionGrafo>(hilosEfectivos(opciones));
+    }
+    if (!motor || nombre != nombreMotor) {
+        motor = crearMotor(nombre, opciones);
+        nombreMotor = nombre;
+    }
+    contraste.reiniciar(opciones);
+}
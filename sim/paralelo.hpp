@@ -0,0 +1,115 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_PARALELO_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_PARALELO_HPP
+
+#include <memory>
+#include <vector>
+#include "sim/grid.hpp"
+#include "sim/contraste.hpp"
+#include "sim/hilos.hpp"
+#include "sim/motores.hpp"
+#include "sim/progargs.hpp"
+#include "sim/reposo.hpp"
+#include "sim/roofline.hpp"
+#include "sim/simulacion.hpp"
+#include "sim/tareas.hpp"
+#include "sim/tiempos.hpp"
+
+// Numero de hilos a usar segun las opciones (0 = tantos como nucleos)
+int hilosEfectivos(const Opciones &opciones);
+
+// Versiones "gather" de las etapas con vecinos: cada particula del bloque acumula las contribuciones de todas sus
+// vecinas y solo se escribe en las particulas del propio bloque, asi varios bloques se pueden calcular a la vez
+void densidadesBloque(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla);
+
+void aceleracionesBloque(std::vector<Block> &blocks, int indice, const Constantes::ConstAccTransf &constAccTransf,
+                         const Grid &malla);
+
+// Las mismas, con el nucleo que indican los parametros (el rapido necesita las inversas de las densidades de los
+// vecinos, que se guardan al transformarlas). Con el exacto y "determinista", usan las versiones que suman en
+// el orden de la version en serie (simulacion.hpp). No hacen nada en los bloques dormidos (reposo.hpp)
+void densidadesBloque(std::vector<Block> &blocks, int indice, const ParametrosSimulacion &parametros,
+                      const Grid &malla);
+
+void aceleracionesBloque(std::vector<Block> &blocks, int indice, const ParametrosSimulacion &parametros,
+                         const Grid &malla);
+
+// Densidades, transformacion y aceleraciones con las versiones "gather", en serie
+void interaccionesBloques(std::vector<Block> &blocks, const Grid &malla, const ParametrosSimulacion &parametros);
+
+// Ejecuta las etapas de una iteracion (tras reposicionar) como un grafo de tareas por bloque. La aceleracion de un
+// bloque empieza en cuanto estan transformadas las densidades de sus vecinos, y un bloque se mueve en cuanto sus
+// vecinos han terminado de leer sus particulas, asi las etapas avanzan en frente de onda sin barreras globales
+class IteracionGrafo {
+public:
+    explicit IteracionGrafo(int numHilos);
+
+    // Si "conMovimiento" es falso, el grafo termina tras la transferencia de aceleraciones
+    void ejecutar(std::vector<Block> &blocks, const Grid &malla, const ParametrosSimulacion &parametros,
+                  bool conMovimiento);
+
+private:
+    GrafoTareas grafo;
+    std::vector<Block> *bloques{nullptr};
+    const Grid *mallaActual{nullptr};
+    const ParametrosSimulacion *parametrosActuales{nullptr};
+    std::size_t bloquesGrafo{0};
+    bool movimientoGrafo{false};
+
+    void construir(const Grid &malla, bool conMovimiento);
+};
+
+
+// Ejecuta las etapas por bloque como bucles paralelos sobre un pool con robo de trabajo. Los bloques se agrupan en
+// trozos contiguos con un numero parecido de particulas, asi los bloques densos no dejan a un hilo atrasado
+class EtapasParalelas {
+public:
+    // Con "fijarHilos", cada hilo se fija a una CPU, repartiendo los hilos consecutivos por nodos NUMA
+    EtapasParalelas(int numHilos, bool fijarHilos);
+
+    // Reposicionamiento en paralelo por bloques destino (en la malla dispersa se hace en serie). Cada hilo reserva
+    // y escribe primero las particulas de sus bloques, asi quedan en la memoria de su nodo NUMA
+    void reposicionar(std::vector<Block> &blocks, Grid &malla);
+
+    // Densidades, transformacion y transferencia de aceleraciones (tras reposicionar)
+    void interacciones(std::vector<Block> &blocks, const Grid &malla, const ParametrosSimulacion &parametros);
+
+    // Colisiones, movimiento y limites con el paso dado
+    void movimiento(std::vector<Block> &blocks, const Punto &numBloques, double pasoTiempo, int subdivision);
+
+private:
+    PoolHilos pool;
+    std::vector<int> limites;
+
+    void dividirEnTrozos(const std::vector<Block> &blocks);
+
+    template <typename Funcion>
+    void paraCadaBloque(Funcion &&funcion) {
+        auto tarea = [&](std::size_t trozo) {
+            for (int indice = limites[trozo]; indice < limites[trozo + 1]; ++indice) {
+                funcion(indice);
+            }
+        };
+        pool.ejecutar(limites.size() - 1, tarea);
+    }
+};
+
+
+// Motores paralelos y bloques que se pueden reutilizar de una simulacion a la siguiente (en el modo por lotes), asi
+// no se vuelven a crear los hilos ni a reservar la memoria de los bloques
+struct RecursosSimulacion {
+    std::unique_ptr<IteracionGrafo> grafo;
+    std::unique_ptr<Motor> motor; // El de nombreMotor(opciones) (ver motores.hpp)
+    std::string nombreMotor;
+    std::vector<Block> bloques;
+    TiemposEtapas tiempos; // Solo se miden con --stage-times, --memory-stats, --roofline o --trace
+    Reposo reposo; // Solo con --sleep
+    Roofline roofline; // Solo con --roofline
+    Contraste contraste; // Solo con --cross-check
+
+    // Crea los motores que piden las opciones (si no estan ya creados) y pone los tiempos, el reposo, los recuentos
+    // del roofline, la traza y la comprobacion cruzada a cero
+    void preparar(const Opciones &opciones);
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_PARALELO_HPP
@@ -2,9 +2,15 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 #include "progargs.hpp"
 #include "sim/constantes.hpp"
 #include "sim/grid.hpp"
+#include "sim/motores.hpp"
 
 
 //NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -36,33 +42,327 @@ Constantes::ErrorCode leerFluido(std::ifstream &in, Fluid &fluid) {
 // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
 
 
+namespace {
+    // Funcion que guarda en "porId" un puntero a cada particula por su id. Los bloques son el unico almacen de
+    // particulas (las que aun no se han colocado en los bloques siguen en el fluido). Devuelve false si un id no es
+    // de ninguna particula del fluido o si falta alguna
+    bool indexarPorId(const Fluid &fluid, const std::vector<Block> &blocks, std::vector<const Particle *> &porId) {
+        porId.assign(static_cast<std::size_t>(fluid.numberparticles), nullptr);
+        for (std::size_t i = 0; i < std::min(porId.size(), fluid.particles.size()); ++i) {
+            porId[i] = &fluid.particles[i];
+        }
+        for (const auto &block: blocks) {
+            for (const auto &particle: block.particles) {
+                if (particle.id < 0 || static_cast<std::size_t>(particle.id) >= porId.size()) {
+                    std::cerr << "Error: Particle id " << particle.id << " out of range\n";
+                    return false;
+                }
+                porId[static_cast<std::size_t>(particle.id)] = &particle;
+            }
+        }
+        const auto falta = std::ranges::find(porId, nullptr);
+        if (falta != porId.end()) {
+            std::cerr << "Error: Missing particle " << falta - porId.begin() << "\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+
 //NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
-void escribirFluido(std::ofstream &out, Fluid &fluid, const std::vector<Block> &blocks) {
+Constantes::ErrorCode escribirFluido(std::ofstream &out, const Fluid &fluid, const std::vector<Block> &blocks) {
+    // Un indice por id permite escribir las particulas en el orden original sin copiarlas
+    std::vector<const Particle *> porId;
+    if (!indexarPorId(fluid, blocks, porId)) {
+        return Constantes::ErrorCode::INVALID_PARTICLE_COUNT;
+    }
     auto temp = static_cast<float>(fluid.particlespermeter);
     out.write(reinterpret_cast<const char *>(&temp), sizeof(float));
     out.write(reinterpret_cast<const char *>(&fluid.numberparticles), sizeof(int));
 
-    // Recorre todos los bloques y sus particulas
-    for (const auto &block: blocks) {
-        for (const auto &particle: block.particles) {
-            // Actualiza las particulas del fluid (asi podremos imprimirlas en el orden original)
-            fluid.particles[particle.id] = particle;
-        }
-    }
-
     // Escribe las particulas ordenadas en el archivo de salida (y en formato "float")
-    for (auto &particle: fluid.particles) {
-        for (double *attr: {&particle.px, &particle.py, &particle.pz,
-                            &particle.hvx, &particle.hvy, &particle.hvz,
-                            &particle.vx, &particle.vy, &particle.vz}) {
-            temp = static_cast<float>(*attr);
+    for (const Particle *particle: porId) {
+        for (const double attr: {particle->px, particle->py, particle->pz,
+                                 particle->hvx, particle->hvy, particle->hvz,
+                                 particle->vx, particle->vy, particle->vz}) {
+            temp = static_cast<float>(attr);
             out.write(reinterpret_cast<const char *>(&temp), sizeof(float));
         }
     }
+    return Constantes::ErrorCode::NO_ERROR;
 }
 // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
 
 
+namespace {
+    // Cada opcion tiene un nombre, si necesita valor y la funcion que guarda ese valor en "Opciones"
+    using AsignarOpcion = void (*)(Opciones &opciones, const std::string &valor);
+
+    struct DefinicionOpcion {
+        std::string_view nombre;
+        bool requiereValor;
+        AsignarOpcion asignar;
+    };
+
+    // Convierte el valor al modo de paginas grandes ("thp" o "explicit"; si no es ninguno, lanza una excepcion)
+    PoolParticulas::PaginasGrandes modoPaginasGrandes(const std::string &valor) {
+        if (valor == "thp") {
+            return PoolParticulas::PaginasGrandes::transparentes;
+        }
+        if (valor == "explicit") {
+            return PoolParticulas::PaginasGrandes::explicitas;
+        }
+        throw std::invalid_argument(valor);
+    }
+
+    // Convierte el valor al modo de los nucleos ("exact" o "fast"; si no es ninguno, lanza una excepcion)
+    ModoNucleo modoNucleo(const std::string &valor) {
+        if (valor == "exact") {
+            return ModoNucleo::exacto;
+        }
+        if (valor == "fast") {
+            return ModoNucleo::rapido;
+        }
+        throw std::invalid_argument(valor);
+    }
+
+    // Comprueba que hay un motor registrado con ese nombre (si no, lanza una excepcion)
+    std::string motorRegistrado(const std::string &valor) {
+        if (!existeMotor(valor)) {
+            throw std::invalid_argument(valor);
+        }
+        return valor;
+    }
+
+    // Convierte el valor a un entero no negativo (si no puede o sobran caracteres, lanza una excepcion)
+    int enteroNoNegativo(const std::string &valor) {
+        std::size_t leidos = 0;
+        const int numero = std::stoi(valor, &leidos);
+        if (numero < 0 || leidos != valor.size()) {
+            throw std::invalid_argument(valor);
+        }
+        return numero;
+    }
+
+    // Convierte el valor a un entero positivo (si no puede, es 0 o sobran caracteres, lanza una excepcion)
+    int enteroPositivo(const std::string &valor) {
+        const int numero = enteroNoNegativo(valor);
+        if (numero == 0) {
+            throw std::invalid_argument(valor);
+        }
+        return numero;
+    }
+
+    // Convierte el valor a un real positivo (si no puede o sobran caracteres, lanza una excepcion)
+    double realPositivo(const std::string &valor) {
+        std::size_t leidos = 0;
+        const double numero = std::stod(valor, &leidos);
+        if (!(numero > 0.0) || leidos != valor.size()) {
+            throw std::invalid_argument(valor);
+        }
+        return numero;
+    }
+
+    const auto tablaOpciones = std::to_array<DefinicionOpcion>({
+        {"sort-every", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.intervaloOrden = enteroNoNegativo(valor);
+        }},
+        {"sparse", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.mallaDispersa = true;
+        }},
+        {"time", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.tiempoObjetivo = realPositivo(valor);
+        }},
+        {"cfl", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.factorCFL = realPositivo(valor);
+        }},
+        {"max-step", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.pasoMaximo = realPositivo(valor);
+        }},
+        {"threads", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.hilos = enteroNoNegativo(valor);
+        }},
+        {"task-graph", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.grafoTareas = true;
+        }},
+        {"ranks", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.rangos = enteroPositivo(valor);
+        }},
+        {"pin", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.fijarHilos = true;
+        }},
+        {"hugepages", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.paginasGrandes = modoPaginasGrandes(valor);
+        }},
+        {"batch", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.manifiesto = valor;
+        }},
+        {"serve", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.socketServidor = valor;
+        }},
+        {"subdivide", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.subdivision = enteroPositivo(valor);
+        }},
+        {"kernel", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.nucleo = modoNucleo(valor);
+        }},
+        {"deterministic", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.determinista = true;
+        }},
+        {"pair-list", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.listaPares = true;
+        }},
+        {"sleep", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.umbralReposo = realPositivo(valor);
+        }},
+        {"sleep-steps", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.pasosReposo = enteroPositivo(valor);
+        }},
+        {"engine", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.motor = motorRegistrado(valor);
+        }},
+        {"cross-check", false, [](Opciones &opciones, const std::string & /*valor*/) {
+            opciones.contraste = true;
+        }},
+        {"cross-check-tolerance", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.toleranciaContraste = realPositivo(valor);
+        }},
+        {"out-of-core", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.directorioCapas = valor;
+        }},
+        {"stage-times", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.ficheroTiempos = valor;
+        }},
+        {"memory-stats", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.ficheroMemoria = valor;
+        }},
+        {"trace", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.ficheroTraza = valor;
+        }},
+        {"roofline", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.ficheroRoofline = valor;
+        }},
+        {"telemetry", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.intervaloTelemetria = enteroNoNegativo(valor);
+        }},
+        {"telemetry-out", true, [](Opciones &opciones, const std::string &valor) {
+            opciones.destinoTelemetria = valor;
+        }},
+    });
+
+    // Busca la opcion en la tabla (devuelve nullptr si no existe)
+    const DefinicionOpcion *buscarOpcion(std::string_view nombre) {
+        const auto *opcion = std::ranges::find(tablaOpciones, nombre, &DefinicionOpcion::nombre);
+        return opcion == tablaOpciones.end() ? nullptr : opcion;
+    }
+
+    // Una opcion que no se puede usar con otras: su nombre y la funcion que dice si se ha dado
+    struct OpcionUsada {
+        std::string_view nombre;
+        bool (*usada)(const Opciones &opciones);
+    };
+
+    const OpcionUsada usaRangos{"--ranks", [](const Opciones &opciones) { return opciones.rangos > 1; }};
+    const OpcionUsada usaGrafo{"--task-graph", [](const Opciones &opciones) { return opciones.grafoTareas; }};
+    const OpcionUsada usaDispersa{"--sparse", [](const Opciones &opciones) { return opciones.mallaDispersa; }};
+    const OpcionUsada usaCapas{"--out-of-core", [](const Opciones &opciones) {
+        return !opciones.directorioCapas.empty();
+    }};
+    const OpcionUsada usaContraste{"--cross-check", [](const Opciones &opciones) { return opciones.contraste; }};
+    const OpcionUsada usaMotor{"--engine", [](const Opciones &opciones) { return !opciones.motor.empty(); }};
+    const OpcionUsada usaTiempos{"--stage-times", [](const Opciones &opciones) {
+        return !opciones.ficheroTiempos.empty();
+    }};
+    const OpcionUsada usaTraza{"--trace", [](const Opciones &opciones) {
+        return !opciones.ficheroTraza.empty();
+    }};
+    const OpcionUsada usaMemoria{"--memory-stats", [](const Opciones &opciones) {
+        return !opciones.ficheroMemoria.empty();
+    }};
+    const OpcionUsada usaRoofline{"--roofline", [](const Opciones &opciones) {
+        return !opciones.ficheroRoofline.empty();
+    }};
+    const OpcionUsada usaReposo{"--sleep", [](const Opciones &opciones) { return opciones.umbralReposo > 0.0; }};
+
+    // Pares de opciones que no se pueden usar juntas
+    const auto combinacionesInvalidas = std::to_array<std::pair<OpcionUsada, OpcionUsada>>({
+        {usaContraste, usaGrafo}, // El grafo no ejecuta con el motor las etapas con vecinos
+        {usaMotor, usaGrafo},
+        {usaMotor, usaRangos}, // Los rangos tienen sus propias etapas
+        {usaContraste, usaRangos},
+        {usaTiempos, usaRangos}, // Los rangos no miden sus etapas
+        {usaTraza, usaRangos}, // Ni las anotan
+        {usaMemoria, usaRangos}, // Ni cuentan sus reservas
+        {usaRoofline, usaRangos}, // Ni su trabajo
+        {usaReposo, usaRangos}, // El reposo cambia el resultado y solo lo tienen los motores en memoria
+        {usaReposo, usaDispersa},
+        {usaReposo, usaCapas},
+    });
+
+    // Funcion que comprueba que no se han dado juntas dos opciones incompatibles
+    Constantes::ErrorCode comprobarCombinaciones(const Opciones &opciones) {
+        for (const auto &[primera, segunda]: combinacionesInvalidas) {
+            if (primera.usada(opciones) && segunda.usada(opciones)) {
+                std::cerr << "Error: " << primera.nombre << " cannot be used with " << segunda.nombre << "\n";
+                return Constantes::ErrorCode::INVALID_ARGUMENTS;
+            }
+        }
+        return Constantes::ErrorCode::NO_ERROR;
+    }
+}
+
+
+// Funcion que procesa la opcion arguments[i] (avanza "i" si su valor va en el siguiente argumento)
+Constantes::ErrorCode procesarOpcion(const std::vector<std::string> &arguments, std::size_t &i, Opciones &opciones) {
+    const std::string &argumento = arguments[i];
+    const std::size_t igual = argumento.find('=');
+    const DefinicionOpcion *opcion = buscarOpcion(std::string_view{argumento}.substr(2, igual - 2));
+    if (opcion == nullptr) {
+        std::cerr << "Error: Unknown option " << argumento << "\n";
+        return Constantes::ErrorCode::INVALID_ARGUMENTS;
+    }
+
+    // El valor puede ir tras un "=" o en el siguiente argumento
+    std::string valor;
+    if (igual != std::string::npos) {
+        valor = argumento.substr(igual + 1);
+    } else if (opcion->requiereValor) {
+        if (i + 1 == arguments.size()) {
+            std::cerr << "Error: Missing value for option " << argumento << "\n";
+            return Constantes::ErrorCode::INVALID_ARGUMENTS;
+        }
+        valor = arguments[++i];
+    }
+
+    try {
+        opcion->asignar(opciones, valor);
+    } catch (const std::logic_error &e) {  // std::invalid_argument y std::out_of_range
+        std::cerr << "Error: Invalid value for option " << argumento << "\n";
+        return Constantes::ErrorCode::INVALID_NUMERIC_FORMAT;
+    }
+    return Constantes::ErrorCode::NO_ERROR;
+}
+
+
+Constantes::ErrorCode extraerOpciones(std::vector<std::string> &arguments, Opciones &opciones) {
+    std::vector<std::string> posicionales;
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        // Solo se consideran opciones los argumentos que empiezan por "--" (asi "-3" sigue siendo un numero)
+        if (!arguments[i].starts_with("--")) {
+            posicionales.push_back(arguments[i]);
+            continue;
+        }
+        const Constantes::ErrorCode errorCode = procesarOpcion(arguments, i, opciones);
+        if (errorCode != Constantes::ErrorCode::NO_ERROR) {
+            return errorCode;
+        }
+    }
+    arguments = std::move(posicionales);
+    return comprobarCombinaciones(opciones);
+}
+
+
 Constantes::ErrorCode comprobarArgsEntrada(int argc, std::vector<std::string> arguments, Argumentos &argumentos) {
     // Comprueba el numero de argumentos
     if (argc != 4) {
@@ -100,6 +400,9 @@ Constantes::ErrorCode comprobarParticulas(std::vector<std::string> arguments, Ar
         std::cerr << "Error: Cannot open " << argumentos.archivoEntrada << " for reading\n";
         return Constantes::ErrorCode::CANNOT_OPEN_FILE_READING;
     }
+    if (!argumentos.opciones.directorioCapas.empty()) { // Fuera de memoria se leen por capas (capas.hpp)
+        return Constantes::ErrorCode::NO_ERROR;
+    }
 
     // Comprueba el numero de particulas del archivo de entrada
     const Constantes::ErrorCode errorCode = leerFluido(input, argumentos.fluid);
@@ -127,8 +430,11 @@ comprobarArgsSalida(std::vector<std::string> arguments, Argumentos &argumentos,
     }
 
     // Escribir el estado final del fluido en el archivo de salida
-    escribirFluido(output, argumentos.fluid, blocks);
+    const Constantes::ErrorCode error = escribirFluido(output, argumentos.fluid, blocks);
     output.close();
+    if (error != Constantes::ErrorCode::NO_ERROR) {
+        return error;
+    }
     std::cout << "Simulación completada. Estado final del fluido guardado en: " << arguments[2] << "\n";
     return Constantes::ErrorCode::NO_ERROR;
 }
@@ -8,6 +8,41 @@
 #include <span>
 #include "sim/constantes.hpp"
 #include "sim/grid.hpp"
+#include "sim/nucleos.hpp"
+
+
+// Opciones adicionales (todas opcionales), se pasan como "--nombre=valor" antes o despues de los argumentos
+struct Opciones {
+    int intervaloOrden = 0;  // Cada cuantas iteraciones se reordenan las particulas de cada bloque (0 = nunca)
+    bool mallaDispersa = false;  // Guarda y recorre solo los bloques con particulas
+    double tiempoObjetivo = 0.0;  // Tiempo simulado a alcanzar con paso adaptativo (0 = paso fijo)
+    double factorCFL = Constantes::factorCFL;  // Fraccion del paso estable que se usa con paso adaptativo
+    double pasoMaximo = Constantes::pasoTiempoMaximo;  // Paso maximo permitido con paso adaptativo
+    int hilos = 0;  // Hilos de los motores paralelos (0 = tantos como nucleos)
+    bool grafoTareas = false;  // Ejecuta las etapas como un grafo de tareas por bloque
+    int rangos = 1;  // Procesos entre los que se reparte la malla (1 = sin distribuir)
+    bool fijarHilos = false;  // Fija cada hilo del pool a una CPU, repartiendolos por nodos NUMA
+    PoolParticulas::PaginasGrandes paginasGrandes = PoolParticulas::PaginasGrandes::ninguna;
+    std::string manifiesto;  // Fichero con los trabajos del modo por lotes (vacio = un unico trabajo)
+    ModoNucleo nucleo = ModoNucleo::exacto;  // Nucleos de las interacciones (el rapido tiene un error acotado)
+    int subdivision = 1;  // Celdas de la malla por longitud de suavizado en cada eje
+    bool determinista = false;  // Los motores paralelos suman en el mismo orden que la version en serie
+    bool listaPares = false;  // La densidad anota los pares que interactuan y la aceleracion los reutiliza
+    double umbralReposo = 0.0;  // Cambio de velocidad por paso por debajo del cual un bloque esta quieto (0 = nunca)
+    int pasosReposo = Constantes::pasosReposo;  // Pasos quietos para dormir un bloque y maximo de pasos dormido
+    std::string motor;  // Motor de calculo de las etapas (vacio = el que eligen las demas opciones, ver motores.hpp)
+    bool contraste = false;  // Ejecuta tambien el motor de referencia y compara cada etapa con el de la simulacion
+    double toleranciaContraste = Constantes::toleranciaContraste;  // Diferencia relativa maxima en la comparacion
+    std::string directorioCapas;  // Directorio de los ficheros de la simulacion por capas (vacio = en memoria)
+    std::string ficheroTiempos;  // Fichero JSON con el tiempo de cada etapa (vacio = no se miden)
+    std::string ficheroMemoria;  // Fichero JSON con las reservas de memoria de cada etapa (vacio = no se cuentan)
+    std::string ficheroTraza;  // Fichero JSON con la traza de iteraciones, etapas y trozos (vacio = no se traza)
+    std::string ficheroRoofline;  // Fichero JSON con el trabajo y el rendimiento de cada etapa (vacio = no se cuenta)
+    int intervaloTelemetria = 0;  // Cada cuantas iteraciones se escribe una muestra de telemetria (0 = nunca)
+    std::string destinoTelemetria;  // Destino de la telemetria: fichero o "unix:ruta" (vacio = salida de errores)
+    int descriptorTelemetria = -1;  // Socket ya abierto al que se envia la telemetria (lo usa el servidor)
+    std::string socketServidor;  // Socket UNIX en el que escucha el modo servidor (vacio = un unico trabajo)
+};
 
 
 // Estructura para almacenar conjuntamente los argumentos
@@ -16,9 +51,14 @@ struct Argumentos {
     std::string archivoEntrada;
     std::string archivoSalida;
     Fluid fluid;
+    Opciones opciones;
 };
 
 
+// Funcion que extrae las opciones "--nombre=valor" de los argumentos, dejando solo los argumentos posicionales
+Constantes::ErrorCode extraerOpciones(std::vector<std::string> &arguments, Opciones &opciones);
+
+
 // Funciones para leer, comprobar y almacenar los valores del fichero de entrada
 Constantes::ErrorCode comprobarArgsEntrada(int argc, std::vector<std::string> arguments, Argumentos &argumentos);
 
@@ -27,7 +67,8 @@ Constantes::ErrorCode comprobarParticulas(std::vector<std::string> arguments, Ar
 Constantes::ErrorCode leerFluido(std::ifstream &in, Fluid &fluid);
 
 
-// Funcion para comprobar los argumentos relativos a la salida y que esta se puede hacer correctamente
+// Funcion para comprobar los argumentos relativos a la salida y que esta se puede hacer correctamente (cada particula
+// de los bloques tiene que tener un id valido y no puede faltar ninguna)
 Constantes::ErrorCode
 comprobarArgsSalida(std::vector<std::string> arguments, Argumentos &argumentos, std::vector<Block> &blocks);
 
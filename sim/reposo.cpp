@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include "reposo.hpp"
+
+namespace {
+    constexpr double porcentaje = 100.0;
+
+    // Los bloques junto a una pared no se duermen: las colisiones y los limites cambian su aceleracion
+    bool juntoAPared(const Block &block, const Grid &malla) {
+        const int subdivision = malla.getSubdivision();
+        const auto cerca = [subdivision](int indice, double numBloques) {
+            return indice < subdivision || indice >= static_cast<int>(numBloques) - subdivision;
+        };
+        return cerca(block.cx, malla.getNumberblocksx()) || cerca(block.cy, malla.getNumberblocksy()) ||
+               cerca(block.cz, malla.getNumberblocksz());
+    }
+}
+
+
+void Reposo::reiniciar(const Opciones &opciones) {
+    umbral = opciones.mallaDispersa ? 0.0 : opciones.umbralReposo;
+    pasos = opciones.pasosReposo;
+    estados.clear();
+    bloquesSaltados = 0;
+    bloquesCalculados = 0;
+    errorMaximo = 0.0;
+}
+
+
+void Reposo::restaurar(std::vector<Block> &blocks) {
+    if (!activo()) {
+        return;
+    }
+    // Tras reposicionar los bloques son los del otro buffer: su marca se vuelve a tomar del estado de su posicion
+    for (std::size_t indice = 0; indice < blocks.size(); ++indice) {
+        Block &block = blocks[indice];
+        block.dormido = indice < estados.size() && estados[indice].dormido;
+        if (!block.dormido) {
+            continue;
+        }
+        EstadoBloque &estado = estados[indice];
+        if (!std::ranges::equal(block.particles, estado.ids, {}, &Particle::id)) { // No se puede estimar su error
+            block.dormido = estado.dormido = false;
+            estado.pasosDormido = 0;
+            continue;
+        }
+        for (std::size_t i = 0; i < block.particles.size(); ++i) {
+            Particle &particle = block.particles[i];
+            const auto &[density, ax, ay, az] = estado.congeladas[i];
+            particle.density = density;
+            particle.ax = ax;
+            particle.ay = ay;
+            particle.az = az;
+        }
+    }
+}
+
+
+void Reposo::actualizar(std::vector<Block> &blocks, const Grid &malla, double paso) {
+    if (!activo()) {
+        return;
+    }
+    estados.resize(blocks.size());
+    for (std::size_t indice = 0; indice < blocks.size(); ++indice) {
+        medir(blocks[indice], estados[indice], paso);
+    }
+    for (std::size_t indice = 0; indice < blocks.size(); ++indice) {
+        Block &block = blocks[indice];
+        EstadoBloque &estado = estados[indice];
+        if (estado.dormido) {
+            block.dormido = estado.dormido = estado.pasosDormido < pasos && vecinosQuietos(block, malla, 1);
+        } else if (estado.pasosQuieto >= pasos && !block.particles.empty() && !juntoAPared(block, malla) &&
+                   vecinosQuietos(block, malla, pasos)) {
+            dormir(block, estado);
+        }
+    }
+}
+
+
+// Funcion que cuenta el bloque y mide su actividad si esta despierto (y, si se acaba de despertar, el error de
+// velocidad que han acumulado sus particulas mientras dormia)
+void Reposo::medir(const Block &block, EstadoBloque &estado, double paso) {
+    if (estado.dormido) {
+        ++bloquesSaltados;
+        ++estado.pasosDormido;
+        return;
+    }
+    ++bloquesCalculados;
+    const bool despertado = estado.pasosDormido > 0 &&
+                            std::ranges::equal(block.particles, estado.ids, {}, &Particle::id);
+    double maxAceleracion2 = 0.0;
+    double maxDesviacion2 = 0.0;
+    for (std::size_t i = 0; i < block.particles.size(); ++i) {
+        const Particle &particle = block.particles[i];
+        maxAceleracion2 = std::max(maxAceleracion2, particle.ax * particle.ax + particle.ay * particle.ay +
+                                                    particle.az * particle.az);
+        if (despertado) {
+            const auto &[density, ax, ay, az] = estado.congeladas[i];
+            const double deltaX = particle.ax - ax;
+            const double deltaY = particle.ay - ay;
+            const double deltaZ = particle.az - az;
+            maxDesviacion2 = std::max(maxDesviacion2, deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ);
+        }
+    }
+    errorMaximo = std::max(errorMaximo, std::sqrt(maxDesviacion2) * paso * estado.pasosDormido);
+    estado.pasosDormido = 0;
+    estado.pasosQuieto = std::sqrt(maxAceleracion2) * paso < umbral ? estado.pasosQuieto + 1 : 0;
+}
+
+
+// Funcion que indica si todos los vecinos del bloque (y el mismo) llevan al menos "minimo" pasos quietos
+bool Reposo::vecinosQuietos(const Block &block, const Grid &malla, int minimo) const {
+    bool quietos = true;
+    malla.paraCadaVecino(block, [&](int vecino) {
+        quietos = quietos && (estados[vecino].dormido || estados[vecino].pasosQuieto >= minimo);
+    });
+    return quietos;
+}
+
+
+// Funcion que congela la densidad y la aceleracion de las particulas del bloque y lo duerme
+void Reposo::dormir(Block &block, EstadoBloque &estado) {
+    estado.ids.clear();
+    estado.congeladas.clear();
+    for (const Particle &particle: block.particles) {
+        estado.ids.push_back(particle.id);
+        estado.congeladas.push_back({particle.density, particle.ax, particle.ay, particle.az});
+    }
+    estado.pasosDormido = 0;
+    block.dormido = estado.dormido = true;
+}
+
+
+void Reposo::escribirInforme(std::ostream &salida) const {
+    const long total = bloquesSaltados + bloquesCalculados;
+    salida << "Quiescent blocks: skipped " << bloquesSaltados << " of " << total << " block updates ("
+           << (total > 0 ? porcentaje * static_cast<double>(bloquesSaltados) / static_cast<double>(total) : 0.0)
+           << "%), estimated max velocity error " << errorMaximo << " m/s\n";
+}
@@ -0,0 +1,72 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_REPOSO_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_REPOSO_HPP
+
+#include <array>
+#include <ostream>
+#include <vector>
+#include "sim/grid.hpp"
+#include "sim/progargs.hpp"
+
+// Bloques en reposo (--sleep=umbral): tras cada iteracion se mide el mayor cambio de velocidad de las particulas de
+// cada bloque (|a|·paso). Un bloque lejos de las paredes se duerme cuando el y sus vecinos llevan --sleep-steps
+// pasos por debajo del umbral, y mientras duerme sus particulas se mueven con la densidad y la aceleracion que
+// tenian al dormirse, sin recalcularlas. Se despierta si un vecino deja de estar quieto, si cambian sus particulas
+// o tras --sleep-steps pasos dormido; entonces se recalcula y la diferencia con la aceleracion congelada da una
+// estimacion del error de velocidad que se ha acumulado, que se informa al terminar
+class Reposo {
+public:
+    // Olvida el estado anterior y toma el umbral de las opciones (con la malla dispersa no se duerme nada, porque
+    // sus bloques cambian en cada iteracion)
+    void reiniciar(const Opciones &opciones);
+
+    [[nodiscard]] inline bool activo() const { return umbral > 0.0; }
+
+    // Tras reposicionar: marca los bloques que duermen en esta iteracion (Block::dormido) y les devuelve la densidad
+    // y la aceleracion congeladas (los que han cambiado de particulas se despiertan)
+    void restaurar(std::vector<Block> &blocks);
+
+    // Tras mover: mide la actividad de los bloques despiertos y decide que bloques duermen en la siguiente iteracion
+    void actualizar(std::vector<Block> &blocks, const Grid &malla, double paso);
+
+    // Indica si el bloque de esa posicion duerme en la siguiente iteracion
+    [[nodiscard]] inline bool getDormido(std::size_t indice) const {
+        return indice < estados.size() && estados[indice].dormido;
+    }
+
+    // Bloques que se han saltado y calculado hasta ahora (una vez por iteracion cada uno)
+    [[nodiscard]] inline long getBloquesSaltados() const { return bloquesSaltados; }
+
+    [[nodiscard]] inline long getBloquesCalculados() const { return bloquesCalculados; }
+
+    // Mayor error de velocidad estimado al despertar un bloque
+    [[nodiscard]] inline double getErrorMaximo() const { return errorMaximo; }
+
+    void escribirInforme(std::ostream &salida) const;
+
+private:
+    // Estado de cada posicion de bloque (el vector de bloques se intercambia con el buffer de la malla al
+    // reposicionar, asi que no se puede guardar en los bloques)
+    struct EstadoBloque {
+        bool dormido{false};
+        int pasosQuieto{0};
+        int pasosDormido{0}; // Se mantiene al despertar hasta medir el error en la siguiente iteracion
+        std::vector<int> ids; // Particulas del bloque al dormirse, en su orden
+        std::vector<std::array<double, 4>> congeladas; // Su densidad y su aceleracion
+    };
+
+    double umbral{0.0};
+    int pasos{0};
+    std::vector<EstadoBloque> estados;
+    long bloquesSaltados{0};
+    long bloquesCalculados{0};
+    double errorMaximo{0.0};
+
+    void medir(const Block &block, EstadoBloque &estado, double paso);
+
+    [[nodiscard]] bool vecinosQuietos(const Block &block, const Grid &malla, int minimo) const;
+
+    void dormir(Block &block, EstadoBloque &estado);
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_REPOSO_HPP
@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <thread>
+#include "roofline.hpp"
+#include "sim/motores.hpp"
+#include "sim/telemetria.hpp"
+
+namespace {
+    constexpr double giga = 1e9;
+
+    // Operaciones en coma flotante de los nucleos exactos (las comparaciones no cuentan)
+    constexpr double flopsPrueba = 8.0; // Distancia al cuadrado entre dos particulas
+    constexpr double flopsDensidadPar = 5.0; // (h² - d²)³ sumado a las dos particulas
+    constexpr double flopsDensidadGather = 4.0; // Sumado solo a la particula que recoge
+    constexpr double flopsAceleracionPar = 36.0; // "calcularDeltas" y su suma a las dos particulas
+    constexpr double flopsAceleracionGather = 33.0;
+    constexpr double flopsTransformacion = 3.0;
+    constexpr double flopsReposicion = 6.0; // Indice del bloque en cada eje
+    constexpr double flopsMovimiento = 30.0;
+    constexpr double flopsColision = 6.0; // Por particula y eje junto a una pared
+    constexpr double flopsLimite = 4.0;
+
+    // Sonda de los picos: triada sobre 3 vectores de 32 MiB repartidos entre los hilos y cadenas de
+    // multiplicaciones y sumas en 32 acumuladores independientes
+    constexpr std::size_t elementosTriada = std::size_t{1} << 22U;
+    constexpr int pasadasTriada = 5;
+    constexpr std::size_t acumuladores = 32;
+    constexpr long iteracionesFma = 1L << 22U;
+    constexpr int pasadasFma = 3;
+    constexpr double factorFma = 0.999999;
+    constexpr double sumandoFma = 1e-6;
+
+    // Ejecuta "cuerpo" en "hilos" hilos que se esperan en una barrera antes de cada fase (la primera espera separa
+    // la preparacion) y devuelve los segundos de la fase mas rapida
+    template <typename Cuerpo>
+    double mejorFase(int hilos, Cuerpo &&cuerpo) {
+        auto marca = std::chrono::steady_clock::now();
+        double mejor = std::numeric_limits<double>::max();
+        bool preparados = false;
+        std::barrier sincronizar(hilos, [&]() noexcept {
+            const auto ahora = std::chrono::steady_clock::now();
+            if (preparados) {
+                mejor = std::min(mejor, std::chrono::duration<double>(ahora - marca).count());
+            }
+            preparados = true;
+            marca = ahora;
+        });
+        {
+            std::vector<std::jthread> trabajadores;
+            for (int hilo = 0; hilo < hilos; ++hilo) {
+                trabajadores.emplace_back([&] { cuerpo(sincronizar); });
+            }
+        }
+        return mejor;
+    }
+
+    // Bytes por segundo de la triada a = b + k·c (cada hilo toca primero su parte, para que quede en su nodo)
+    double medirBanda(int hilos, std::atomic<double> &sumidero) {
+        const std::size_t porHilo = elementosTriada / static_cast<std::size_t>(hilos);
+        const double segundos = mejorFase(hilos, [&](auto &sincronizar) {
+            std::vector<double> destino(porHilo, 0.0);
+            const std::vector<double> primero(porHilo, 1.0);
+            const std::vector<double> segundo(porHilo, 2.0);
+            sincronizar.arrive_and_wait();
+            for (int pasada = 0; pasada < pasadasTriada; ++pasada) {
+                for (std::size_t i = 0; i < porHilo; ++i) {
+                    destino[i] = primero[i] + factorFma * segundo[i];
+                }
+                sincronizar.arrive_and_wait();
+            }
+            sumidero.fetch_add(destino[porHilo / 2]);
+        });
+        return 3.0 * sizeof(double) * static_cast<double>(porHilo) * hilos / segundos;
+    }
+
+    // Operaciones por segundo de x = x·k + s (una multiplicacion y una suma fusionadas) en cada acumulador
+    double medirCalculo(int hilos, std::atomic<double> &sumidero) {
+        const double segundos = mejorFase(hilos, [&](auto &sincronizar) {
+            std::array<double, acumuladores> acumulado{};
+            sincronizar.arrive_and_wait();
+            for (int pasada = 0; pasada < pasadasFma; ++pasada) {
+                for (long iteracion = 0; iteracion < iteracionesFma; ++iteracion) {
+                    for (double &valor: acumulado) {
+                        valor = std::fma(valor, factorFma, sumandoFma);
+                    }
+                }
+                sincronizar.arrive_and_wait();
+            }
+            sumidero.fetch_add(acumulado[0]);
+        });
+        return 2.0 * acumuladores * static_cast<double>(iteracionesFma) * hilos / segundos;
+    }
+
+    // Ejes en los que el bloque esta junto a una pared (los unicos en los que actuan colisiones y limites)
+    int ejesJuntoAPared(const Block &block, const Grid &malla) {
+        const int subdivision = malla.getSubdivision();
+        const auto cerca = [subdivision](int indice, double numBloques) {
+            return indice < subdivision || indice >= static_cast<int>(numBloques) - subdivision ? 1 : 0;
+        };
+        return cerca(block.cx, malla.getNumberblocksx()) + cerca(block.cy, malla.getNumberblocksy()) +
+               cerca(block.cz, malla.getNumberblocksz());
+    }
+
+    // Pares que interactuan con una particula del bloque como la de menor id
+    long paresInteraccionBloque(const std::vector<Block> &blocks, const Block &block, const Grid &malla,
+                                double hSquared) {
+        long pares = 0;
+        malla.paraCadaVecino(block, [&](int vecino) {
+            for (const Particle &particle: block.particles) {
+                for (const Particle &otra: blocks[vecino].particles) {
+                    const double deltaX = particle.px - otra.px;
+                    const double deltaY = particle.py - otra.py;
+                    const double deltaZ = particle.pz - otra.pz;
+                    pares += particle.id < otra.id && deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ < hSquared;
+                }
+            }
+        });
+        return pares;
+    }
+
+    void escribirEtapa(std::ostream &salida, double segundos, const Trabajo &trabajo, const PicosMaquina &picos) {
+        const double intensidad = trabajo.bytes > 0.0 ? trabajo.flops / trabajo.bytes : 0.0;
+        const double alcanzable = std::min(picos.flopsPorSegundo, intensidad * picos.bytesPorSegundo);
+        const double logrado = trabajo.flops / segundos;
+        salida << "{\"seconds\": " << segundos << ", \"gflop\": " << trabajo.flops / giga
+               << ", \"gbytes\": " << trabajo.bytes / giga << ", \"gflops\": " << logrado / giga
+               << ", \"gbs\": " << trabajo.bytes / segundos / giga << ", \"flops_per_byte\": " << intensidad
+               << ", \"attainable_gflops\": " << alcanzable / giga
+               << ", \"efficiency\": " << (alcanzable > 0.0 ? logrado / alcanzable : 0.0) << ", \"bound\": \""
+               << (intensidad * picos.bytesPorSegundo < picos.flopsPorSegundo ? "memory" : "compute") << "\"}";
+    }
+}
+
+
+PicosMaquina medirPicos(int hilos) {
+    hilos = std::max(1, hilos);
+    std::atomic<double> sumidero{0.0};
+    const PicosMaquina picos{medirCalculo(hilos, sumidero), medirBanda(hilos, sumidero)};
+    volatile double resultado = sumidero.load(); // Que no se eliminen los bucles de la sonda
+    static_cast<void>(resultado);
+    return picos;
+}
+
+
+void Roofline::reiniciar(const Opciones &opciones, int hilosMotor) {
+    activado = !opciones.ficheroRoofline.empty();
+    // Los motores registrados por otros programas se cuentan como "scalar"
+    const std::string motor = nombreMotor(opciones);
+    gather = motor == "gather" || motor == "threads" || opciones.grafoTareas || opciones.nucleo == ModoNucleo::rapido ||
+             opciones.listaPares || (opciones.umbralReposo > 0.0 && !opciones.mallaDispersa);
+    listaPares = opciones.listaPares;
+    movimientoJunto = !opciones.grafoTareas && motor == "threads";
+    grafoConMovimiento = opciones.grafoTareas && opciones.tiempoObjetivo <= 0.0;
+    hilos = hilosMotor;
+    iteraciones = 0;
+    particulas = 0.0;
+    pruebas = 0.0;
+    pares = 0.0;
+    enParedes = 0.0;
+    particulasParedes = 0.0;
+}
+
+
+void Roofline::contar(const std::vector<Block> &blocks, const Grid &malla, double hSquared) {
+    if (!activado) {
+        return;
+    }
+    ++iteraciones;
+    pruebas += static_cast<double>(paresCandidatos(blocks, malla));
+    for (const Block &block: blocks) {
+        const auto enBloque = static_cast<double>(block.particles.size());
+        const int ejes = ejesJuntoAPared(block, malla);
+        particulas += enBloque;
+        enParedes += enBloque * ejes;
+        particulasParedes += ejes > 0 ? enBloque : 0.0;
+        pares += static_cast<double>(paresInteraccionBloque(blocks, block, malla, hSquared));
+    }
+}
+
+
+Trabajo Roofline::trabajo(Etapa etapa) const {
+    const auto suma = [this](std::initializer_list<Etapa> partes) {
+        Trabajo total{0.0, 0.0};
+        for (const Etapa parte: partes) {
+            const Trabajo trabajoParte = trabajoElemental(parte);
+            total.flops += trabajoParte.flops;
+            total.bytes += trabajoParte.bytes;
+        }
+        return total;
+    };
+    const std::initializer_list<Etapa> vecinos = {Etapa::densidades, Etapa::transformacion, Etapa::aceleraciones};
+    const std::initializer_list<Etapa> todas = {Etapa::reposicion, Etapa::densidades, Etapa::transformacion,
+                                                Etapa::aceleraciones, Etapa::colisiones, Etapa::movimiento,
+                                                Etapa::limites};
+    switch (etapa) {
+        case Etapa::interacciones:
+            return suma(vecinos);
+        case Etapa::movimiento:
+            return movimientoJunto ? suma({Etapa::colisiones, Etapa::movimiento, Etapa::limites})
+                                   : trabajoElemental(etapa);
+        case Etapa::grafo:
+            return grafoConMovimiento ? suma({Etapa::densidades, Etapa::transformacion, Etapa::aceleraciones,
+                                              Etapa::colisiones, Etapa::movimiento, Etapa::limites}) : suma(vecinos);
+        case Etapa::total:
+            return suma(todas);
+        default:
+            return trabajoElemental(etapa);
+    }
+}
+
+
+// Funcion que da el trabajo de una sola etapa: cada prueba o par se evalua una vez en serie y dos en "gather", y
+// cada pasada lee y escribe sus particulas una vez
+Trabajo Roofline::trabajoElemental(Etapa etapa) const {
+    const double lados = gather ? 2.0 : 1.0;
+    const double bytes = 2.0 * sizeof(Particle) * particulas;
+    const double bytesParedes = 2.0 * sizeof(Particle) * particulasParedes;
+    switch (etapa) {
+        case Etapa::reposicion:
+            return {flopsReposicion * particulas, bytes};
+        case Etapa::densidades:
+            return {lados * (flopsPrueba * pruebas + (gather ? flopsDensidadGather : flopsDensidadPar) * pares), bytes};
+        case Etapa::transformacion:
+            return {flopsTransformacion * particulas, bytes};
+        case Etapa::aceleraciones: // La lista de pares no vuelve a comprobar distancias
+            return {lados * ((listaPares ? 0.0 : flopsPrueba * pruebas) +
+                             (gather ? flopsAceleracionGather : flopsAceleracionPar) * pares), bytes};
+        case Etapa::colisiones:
+            return {flopsColision * enParedes, bytesParedes};
+        case Etapa::movimiento:
+            return {flopsMovimiento * particulas, bytes};
+        case Etapa::limites:
+            return {flopsLimite * enParedes, bytesParedes};
+        default:
+            return {0.0, 0.0};
+    }
+}
+
+
+void Roofline::escribirJson(std::ostream &salida, const TiemposEtapas &tiempos, const PicosMaquina &picos) const {
+    salida << "{\"iterations\": " << iteraciones << ", \"threads\": " << hilos
+           << ", \"peak_gflops\": " << picos.flopsPorSegundo / giga
+           << ", \"peak_gbs\": " << picos.bytesPorSegundo / giga
+           << ", \"ridge_flops_per_byte\": " << picos.flopsPorSegundo / picos.bytesPorSegundo
+           << ", \"particle_bytes\": " << sizeof(Particle) << ", \"particle_updates\": " << particulas
+           << ", \"pair_tests\": " << pruebas << ", \"interacting_pairs\": " << pares;
+    for (std::size_t indice = 0; indice < TiemposEtapas::numEtapas; ++indice) {
+        const auto etapa = static_cast<Etapa>(indice);
+        if (tiempos.getLlamadas(etapa) == 0 || tiempos.getSegundos(etapa) <= 0.0) {
+            continue;
+        }
+        salida << ", \"" << nombreEtapa(etapa) << "\": ";
+        escribirEtapa(salida, tiempos.getSegundos(etapa), trabajo(etapa), picos);
+    }
+    salida << "}\n";
+}
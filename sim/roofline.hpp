@@ -0,0 +1,75 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_ROOFLINE_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_ROOFLINE_HPP
+
+#include <ostream>
+#include <vector>
+#include "sim/grid.hpp"
+#include "sim/progargs.hpp"
+#include "sim/tiempos.hpp"
+
+// Picos de la maquina con los hilos de la simulacion: operaciones en coma flotante por segundo (cadenas de
+// multiplicaciones y sumas independientes en registros) y bytes por segundo (triada de STREAM sobre vectores que no
+// caben en la cache)
+struct PicosMaquina {
+    double flopsPorSegundo;
+    double bytesPorSegundo;
+};
+
+PicosMaquina medirPicos(int hilos);
+
+// Operaciones en coma flotante y bytes de memoria de una etapa
+struct Trabajo {
+    double flops;
+    double bytes;
+};
+
+// Modelo de roofline (--roofline=fichero.json). En cada iteracion cuenta las particulas, los pares que comprueban
+// las etapas con vecinos (los de bloques vecinos) y los que interactuan (a menos de la longitud de suavizado). Con
+// ellos y las operaciones de cada prueba, par o particula de los nucleos exactos da el trabajo de cada etapa. Los
+// bytes suponen que cada etapa lee y escribe una vez cada "Particle" entera (las vecinas se leen de la cache), asi
+// que dependen de su tamaño. Con los tiempos de --stage-times da los GFLOP/s y GB/s de cada etapa y, con los picos
+// medidos, si la limita la memoria o el calculo y a que fraccion del techo esta
+class Roofline {
+public:
+    // Sin --roofline no cuenta nada. Las versiones "gather" (las del motor de las opciones, ver motores.hpp)
+    // comprueban cada par desde sus dos particulas
+    void reiniciar(const Opciones &opciones, int hilosMotor);
+
+    [[nodiscard]] inline bool activo() const { return activado; }
+
+    [[nodiscard]] inline int getHilos() const { return hilos; }
+
+    // Pares comprobados y pares que interactuan en toda la simulacion (cada par una vez por iteracion)
+    [[nodiscard]] inline double getPruebas() const { return pruebas; }
+
+    [[nodiscard]] inline double getPares() const { return pares; }
+
+    // Tras reposicionar: cuenta el trabajo de la iteracion
+    void contar(const std::vector<Block> &blocks, const Grid &malla, double hSquared);
+
+    // Trabajo de una etapa en toda la simulacion (las etapas que un motor ejecuta juntas suman sus partes)
+    [[nodiscard]] Trabajo trabajo(Etapa etapa) const;
+
+    // Escribe un objeto JSON con los picos, los recuentos y, por cada etapa medida, su trabajo, su rendimiento y
+    // su posicion respecto al techo
+    void escribirJson(std::ostream &salida, const TiemposEtapas &tiempos, const PicosMaquina &picos) const;
+
+private:
+    bool activado{false};
+    bool gather{false};
+    bool listaPares{false};
+    bool movimientoJunto{false}; // "movimiento" incluye colisiones y limites (con el motor "threads")
+    bool grafoConMovimiento{false};
+    int hilos{1};
+    int iteraciones{0};
+    double particulas{0.0};
+    double pruebas{0.0}; // Pares de bloques vecinos, cada uno una vez
+    double pares{0.0}; // Pares que interactuan, cada uno una vez
+    double enParedes{0.0}; // Particulas por eje de los bloques junto a una pared en ese eje
+    double particulasParedes{0.0}; // Particulas de los bloques junto a alguna pared
+
+    [[nodiscard]] Trabajo trabajoElemental(Etapa etapa) const;
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_ROOFLINE_HPP
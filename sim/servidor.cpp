@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "servidor.hpp"
+
+namespace {
+    constexpr std::size_t tamanoLectura = 4096;
+    constexpr std::size_t longitudMaximaLinea = 65536; // Sin salto de linea antes, se cierra la conexion
+    constexpr const char *ordenDetener = "shutdown";
+
+    volatile std::sig_atomic_t senalRecibida = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+    void detenerConSenal(int /*senal*/) {
+        senalRecibida = 1;
+    }
+
+    // Mientras existe, lo que se escribe en la salida de errores se guarda para enviarlo al cliente (y al terminar
+    // se copia en la salida de errores del servidor)
+    class CapturaErrores {
+    public:
+        CapturaErrores() : anterior(std::cerr.rdbuf(texto.rdbuf())) {}
+
+        ~CapturaErrores() {
+            std::cerr.rdbuf(anterior);
+            std::cerr << texto.str();
+        }
+
+        CapturaErrores(const CapturaErrores &) = delete;
+
+        CapturaErrores &operator=(const CapturaErrores &) = delete;
+
+        CapturaErrores(CapturaErrores &&) = delete;
+
+        CapturaErrores &operator=(CapturaErrores &&) = delete;
+
+        [[nodiscard]] std::string mensaje() const {
+            std::string resultado = texto.str();
+            while (!resultado.empty() && resultado.back() == '\n') {
+                resultado.pop_back();
+            }
+            return resultado;
+        }
+
+    private:
+        std::ostringstream texto;
+        std::streambuf *anterior;
+    };
+
+    // Texto entre comillas de JSON (se quitan los caracteres de control salvo los saltos de linea)
+    std::string textoJson(const std::string &texto) {
+        std::string resultado = "\"";
+        for (const char caracter: texto) {
+            if (caracter == '"' || caracter == '\\') {
+                resultado += '\\';
+                resultado += caracter;
+            } else if (caracter == '\n') {
+                resultado += "\\n";
+            } else if (static_cast<unsigned char>(caracter) >= ' ') {
+                resultado += caracter;
+            }
+        }
+        return resultado + "\"";
+    }
+
+    // Envia todo el texto (sin SIGPIPE si el cliente ya se ha ido)
+    void enviar(int cliente, const std::string &texto) {
+        std::size_t enviados = 0;
+        while (enviados < texto.size()) {
+            const ssize_t escritos = ::send(cliente, texto.data() + enviados, texto.size() - enviados,
+                                            MSG_NOSIGNAL);
+            if (escritos <= 0) {
+                return;
+            }
+            enviados += static_cast<std::size_t>(escritos);
+        }
+    }
+
+    // Las opciones de los motores paralelos y del modo de ejecucion son las del servidor, el resto las elige cada
+    // trabajo. La telemetria sin destino va al cliente
+    void fijarOpcionesServidor(Opciones &opcionesTrabajo, const Opciones &opciones, int cliente) {
+        opcionesTrabajo.hilos = opciones.hilos;
+        opcionesTrabajo.grafoTareas = opciones.grafoTareas;
+        opcionesTrabajo.fijarHilos = opciones.fijarHilos;
+        opcionesTrabajo.paginasGrandes = opciones.paginasGrandes;
+        opcionesTrabajo.manifiesto.clear();
+        opcionesTrabajo.socketServidor.clear();
+        if (opcionesTrabajo.destinoTelemetria.empty()) {
+            opcionesTrabajo.descriptorTelemetria = cliente;
+        }
+    }
+
+    sockaddr_un direccionSocket(const std::string &ruta) {
+        sockaddr_un direccion{};
+        if (ruta.size() >= sizeof(direccion.sun_path)) {
+            throw std::runtime_error("Error: Socket path too long: " + ruta);
+        }
+        direccion.sun_family = AF_UNIX;
+        std::ranges::copy(ruta, std::begin(direccion.sun_path));
+        return direccion;
+    }
+
+    // Crea el socket de escucha. Si la ruta es un socket en el que nadie escucha (queda de un servidor anterior) se
+    // borra; si hay otro servidor escuchando, es un error
+    int escuchar(const std::string &ruta) {
+        const sockaddr_un direccion = direccionSocket(ruta);
+        const auto *generica = reinterpret_cast<const sockaddr *>(&direccion); // NOLINT
+        const int escucha = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const int prueba = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool ocupado = prueba >= 0 && ::connect(prueba, generica, sizeof(direccion)) == 0;
+        ::close(prueba);
+        std::error_code error;
+        if (!ocupado && std::filesystem::is_socket(ruta, error)) {
+            ::unlink(ruta.c_str());
+        }
+        if (escucha < 0 || ocupado || ::bind(escucha, generica, sizeof(direccion)) != 0 ||
+            ::listen(escucha, SOMAXCONN) != 0) {
+            const std::string causa = ocupado ? "another server is listening" : std::strerror(errno);
+            ::close(escucha);
+            throw std::runtime_error("Error: Cannot listen on " + ruta + ": " + causa);
+        }
+        return escucha;
+    }
+
+    // Linea JSON con el resultado de un trabajo
+    std::string lineaEstado(int trabajo, Constantes::ErrorCode errorCode, double segundos,
+                            const std::string &mensaje) {
+        std::ostringstream estado;
+        estado << "{\"job\": " << trabajo << ", \"status\": \""
+               << (errorCode == Constantes::ErrorCode::NO_ERROR ? "ok" : "error") << "\", \"code\": "
+               << static_cast<int>(errorCode) << ", \"seconds\": " << segundos << ", \"message\": "
+               << textoJson(mensaje) << "}\n";
+        return estado.str();
+    }
+
+    std::string primeraPalabra(const std::string &linea) {
+        std::istringstream campos(linea);
+        std::string primera;
+        campos >> primera;
+        return primera;
+    }
+
+    // SIGINT y SIGTERM solo marcan que hay que terminar (sin SA_RESTART, asi "accept" vuelve con EINTR)
+    void instalarSenales() {
+        struct sigaction accion{};
+        accion.sa_handler = detenerConSenal;
+        sigemptyset(&accion.sa_mask);
+        ::sigaction(SIGINT, &accion, nullptr);
+        ::sigaction(SIGTERM, &accion, nullptr);
+    }
+}
+
+
+Servidor::Servidor(const Opciones &opciones) : opciones(opciones), lote(opciones) {}
+
+
+bool Servidor::atender(int cliente) {
+    std::string pendiente;
+    std::array<char, tamanoLectura> buffer{};
+    ssize_t leidos = 0;
+    while ((leidos = ::read(cliente, buffer.data(), buffer.size())) > 0) {
+        pendiente.append(buffer.data(), static_cast<std::size_t>(leidos));
+        for (std::size_t fin = pendiente.find('\n'); fin != std::string::npos; fin = pendiente.find('\n')) {
+            const std::string linea = pendiente.substr(0, fin);
+            pendiente.erase(0, fin + 1);
+            const std::string primero = primeraPalabra(linea);
+            if (primero == ordenDetener) {
+                enviar(cliente, "{\"status\": \"shutdown\"}\n");
+                return false;
+            }
+            if (!primero.empty() && !primero.starts_with('#')) {
+                enviar(cliente, ejecutarLinea(linea, cliente));
+            }
+        }
+        if (pendiente.size() > longitudMaximaLinea) { // Un cliente no puede llenar la memoria del servidor
+            enviar(cliente, "{\"status\": \"error\", \"message\": \"line too long\"}\n");
+            break;
+        }
+    }
+    return senalRecibida == 0;
+}
+
+
+std::string Servidor::ejecutarLinea(const std::string &linea, int cliente) {
+    const auto inicio = std::chrono::steady_clock::now();
+    std::istringstream campos(linea);
+    std::vector<std::string> arguments{std::istream_iterator<std::string>(campos),
+                                       std::istream_iterator<std::string>()};
+    Opciones opcionesTrabajo = opciones;
+    Constantes::ErrorCode errorCode = Constantes::ErrorCode::NO_ERROR;
+    std::string mensaje;
+    {
+        const CapturaErrores errores;
+        errorCode = extraerOpciones(arguments, opcionesTrabajo);
+        fijarOpcionesServidor(opcionesTrabajo, opciones, cliente);
+        try {
+            if (errorCode == Constantes::ErrorCode::NO_ERROR) {
+                errorCode = lote.ejecutarTrabajo(arguments, opcionesTrabajo);
+            }
+        } catch (const std::exception &e) { // Un trabajo que falla no detiene al servidor
+            std::cerr << e.what() << "\n";
+            errorCode = Constantes::ErrorCode::INVALID_ARGUMENTS;
+        }
+        mensaje = errores.mensaje();
+    }
+    return lineaEstado(++trabajos, errorCode,
+                       std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count(), mensaje);
+}
+
+
+Constantes::ErrorCode ejecutarServidor(const Opciones &opciones) {
+    int escucha = -1;
+    try {
+        escucha = escuchar(opciones.socketServidor);
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+        return Constantes::ErrorCode::CANNOT_OPEN_FILE_WRITING;
+    }
+    instalarSenales();
+    Servidor servidor(opciones);
+    bool seguir = true;
+    while (seguir && senalRecibida == 0) {
+        const int cliente = ::accept4(escucha, nullptr, nullptr, SOCK_CLOEXEC);
+        if (cliente >= 0) {
+            seguir = servidor.atender(cliente);
+            ::close(cliente);
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            std::cerr << "Error: accept failed: " << std::strerror(errno) << "\n";
+            seguir = false;
+        }
+    }
+    ::close(escucha);
+    ::unlink(opciones.socketServidor.c_str());
+    return Constantes::ErrorCode::NO_ERROR;
+}
@@ -0,0 +1,38 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_SERVIDOR_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_SERVIDOR_HPP
+
+#include <string>
+#include "sim/constantes.hpp"
+#include "sim/lote.hpp"
+#include "sim/progargs.hpp"
+
+// Modo servidor (--serve=ruta): el proceso se queda escuchando en un socket UNIX y ejecuta con un lote los trabajos
+// que recibe, asi la malla, los bloques y los motores paralelos siguen preparados de un trabajo al siguiente y cada
+// trabajo no paga el arranque de un proceso. Cada linea recibida es un trabajo con los argumentos de "fluid"
+// ("iteraciones entrada salida" y sus opciones) y se responde con una linea JSON de estado. Si el trabajo pide
+// --telemetry sin --telemetry-out, antes se envian por la misma conexion sus lineas de telemetria. La linea
+// "shutdown" detiene el servidor
+class Servidor {
+public:
+    explicit Servidor(const Opciones &opciones);
+
+    // Atiende las lineas de un cliente ya conectado hasta que cierra la conexion o envia mas de 64 KiB sin un salto
+    // de linea (entonces se le responde con un error y se deja de leer). Devuelve falso si ha pedido detener el
+    // servidor
+    bool atender(int cliente);
+
+    // Ejecuta la linea de un trabajo (enviando su telemetria al cliente) y devuelve su linea JSON de estado
+    std::string ejecutarLinea(const std::string &linea, int cliente);
+
+private:
+    Opciones opciones;
+    Lote lote;
+    int trabajos{0};
+};
+
+// Escucha en "opciones.socketServidor" y atiende a los clientes de uno en uno hasta que uno pide detenerlo (o
+// llega SIGINT o SIGTERM)
+Constantes::ErrorCode ejecutarServidor(const Opciones &opciones);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_SERVIDOR_HPP
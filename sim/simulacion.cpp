@@ -4,18 +4,28 @@
 #include <array>
 #include <limits>
 #include <tuple>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <utility>
 #include "sim/grid.hpp"
 #include "sim/constantes.hpp"
 #include "sim/progargs.hpp"
 #include "simulacion.hpp"
-
-
-// Funcion que gestiona las iteraciones, calculando previamente valores y luego llamando a cada etapa las veces pedidas
-std::vector<Block>
-ejecutarIteraciones(Grid &malla, Argumentos &argumentos, double smoothingLength, double particleMass) {
-    // Calcula previamente valores para no tener que hacerlo en cada iteracion
-    const double factorDensTransf = (315.0 / (64.0 * std::numbers::pi * std::pow(smoothingLength, 9))) * particleMass;
-    Constantes::ConstAccTransf constAccTransf{};
+#include "sim/paralelo.hpp"
+#include "sim/nucleos.hpp"
+#include "sim/telemetria.hpp"
+
+
+// Funcion que calcula los valores que usan las etapas y que no cambian entre iteraciones
+ParametrosSimulacion calcularParametros(double smoothingLength, double particleMass, ModoNucleo nucleo,
+                                        bool determinista) {
+    ParametrosSimulacion parametros{};
+    parametros.nucleo = nucleo;
+    parametros.determinista = determinista;
+    parametros.smoothingLength = smoothingLength;
+    parametros.factorDensTransf = (315.0 / (64.0 * std::numbers::pi * std::pow(smoothingLength, 9))) * particleMass;
+    Constantes::ConstAccTransf &constAccTransf = parametros.constAccTransf;
     constAccTransf.h = smoothingLength;
     constAccTransf.hSquared = smoothingLength * smoothingLength;
     const double piMulSmoothingPowSix = std::numbers::pi * std::pow(smoothingLength, Constantes::seis);
@@ -23,20 +33,201 @@ ejecutarIteraciones(Grid &malla, Argumentos &argumentos, double smoothingLength,
                               particleMass);
     constAccTransf.commonFactor = (Constantes::quince / (piMulSmoothingPowSix)) *
                                   ((3 * particleMass * Constantes::presRigidez) * Constantes::factor05);
+    return parametros;
+}
+
+
+ParametrosSimulacion calcularParametros(double smoothingLength, double particleMass, const Opciones &opciones) {
+    ParametrosSimulacion parametros = calcularParametros(smoothingLength, particleMass, opciones.nucleo,
+                                                         opciones.determinista);
+    parametros.listaPares = opciones.listaPares;
+    return parametros;
+}
+
+
+// Funcion que gestiona las iteraciones, calculando previamente valores y luego llamando a cada etapa las veces pedidas
+std::vector<Block>
+ejecutarIteraciones(Grid &malla, Argumentos &argumentos, double smoothingLength, double particleMass) {
+    RecursosSimulacion recursos;
+    const Opciones &opciones = argumentos.opciones;
+    return std::move(ejecutarIteraciones(malla, argumentos, calcularParametros(smoothingLength, particleMass, opciones),
+                                         recursos));
+}
+
+
+// Version que reutiliza los motores y los bloques de "recursos" (de una simulacion anterior, si los hay)
+std::vector<Block> &ejecutarIteraciones(Grid &malla, Argumentos &argumentos, const ParametrosSimulacion &parametros,
+                                        RecursosSimulacion &recursos) {
+    const ContextoIteracion contexto{malla, argumentos.opciones, parametros, recursos};
+    recursos.preparar(argumentos.opciones);
+    prepararBloques(malla, recursos.bloques);
+    malla.reposicionarParticulasFluid(argumentos.fluid, recursos.bloques); // Reposicionamiento con "Fluid"
+    Telemetria telemetria(argumentos, 0);
+    double tiempo = 0.0;
+    int iter = 0;
+    recursos.tiempos.medir(Etapa::total, [&] {
+        for (; quedanIteraciones(argumentos, iter, tiempo); ++iter) { // Ejecuta las etapas de la simulacion
+            tiempo += ejecutarIteracion(contexto, iter, tiempo);
+            telemetria.muestrear(recursos.bloques, malla, iter + 1, tiempo);
+        }
+    });
+    if (argumentos.opciones.tiempoObjetivo > 0.0) {
+        std::cout << "Simulated time: " << tiempo << " in " << iter << " steps\n";
+    }
+    if (recursos.reposo.activo()) {
+        recursos.reposo.escribirInforme(std::cout);
+    }
+    recursos.contraste.escribirInforme(std::cout); // Solo con --cross-check
+    escribirTiempos(argumentos.opciones, recursos, iter);
+    return recursos.bloques;
+}
+
+
+// Funcion que guarda el tiempo de cada etapa en el fichero de --stage-times, su memoria en el de --memory-stats, su
+// trabajo y rendimiento en el de --roofline y la traza en el de --trace (los que se hayan pedido; los picos de la
+// maquina se miden ahora)
+void escribirTiempos(const Opciones &opciones, const RecursosSimulacion &recursos, int iteraciones) {
+    ContadorMemoria::activar(false);
+    Traza::activar(false);
+    const auto escribir = [](const std::string &ruta, auto &&funcion) {
+        if (ruta.empty()) {
+            return;
+        }
+        std::ofstream fichero(ruta);
+        if (!fichero) {
+            std::cerr << "Error: Cannot open " << ruta << " for writing\n";
+            return;
+        }
+        funcion(fichero);
+    };
+    const TiemposEtapas &tiempos = recursos.tiempos;
+    escribir(opciones.ficheroTiempos, [&](std::ostream &salida) { tiempos.escribirJson(salida, iteraciones); });
+    escribir(opciones.ficheroMemoria, [&](std::ostream &salida) { tiempos.escribirJsonMemoria(salida, iteraciones); });
+    escribir(opciones.ficheroRoofline, [&](std::ostream &salida) {
+        recursos.roofline.escribirJson(salida, tiempos, medirPicos(recursos.roofline.getHilos()));
+    });
+    escribir(opciones.ficheroTraza, [](std::ostream &salida) { Traza::escribirJson(salida); });
+}
+
+
+// Funcion que ejecuta una iteracion y devuelve el paso usado (con --sleep, despues decide que bloques duermen)
+double ejecutarIteracion(const ContextoIteracion &contexto, int iter, double tiempo) {
+    const Traza::Ambito ambito("iteration", "iteration", iter);
+    const double paso = ejecutarEtapas(contexto, iter, tiempo);
+    contexto.recursos.reposo.actualizar(contexto.recursos.bloques, contexto.malla, paso);
+    return paso;
+}
+
+
+// Funcion que ejecuta las etapas de una iteracion con el motor que piden las opciones y devuelve el paso usado
+double ejecutarEtapas(const ContextoIteracion &contexto, int iter, double tiempo) {
+    const Opciones &opciones = contexto.opciones;
+    std::vector<Block> &blocks = contexto.recursos.bloques;
+    IteracionGrafo *grafo = opciones.grafoTareas ? contexto.recursos.grafo.get() : nullptr;
+    const bool adaptativo = opciones.tiempoObjetivo > 0.0;
+    etapaReposicion(contexto, iter);
+    contexto.recursos.roofline.contar(blocks, contexto.malla, contexto.parametros.constAccTransf.hSquared);
+
+    // Con el grafo de tareas, el movimiento solo va dentro del grafo si el paso es fijo
+    if (grafo != nullptr) {
+        contexto.recursos.tiempos.medir(Etapa::grafo, [&] {
+            grafo->ejecutar(blocks, contexto.malla, contexto.parametros, !adaptativo);
+        });
+        if (!adaptativo) {
+            return Constantes::pasoTiempo;
+        }
+    } else {
+        etapasInteraccion(contexto, iter);
+    }
+    // Con paso adaptativo, el ultimo paso se recorta para terminar justo en el tiempo objetivo
+    const double paso = !adaptativo ? Constantes::pasoTiempo
+                                    : std::min(calcularPasoAdaptativo(blocks, contexto.parametros.smoothingLength,
+                                                                      opciones), opciones.tiempoObjetivo - tiempo);
+    etapasMovimiento(contexto, iter, paso);
+    return paso;
+}
+
 
-    std::vector<Block> blocks = malla.getBlocks();
-    malla.reposicionarParticulasFluid(argumentos.fluid, blocks); // Reposicionamiento con "Fluid"
-    for (int iter = 0; iter < argumentos.iteraciones; ++iter) { // Ejecuta las etapas de la simulacion
+// Inicializacion de densidades y aceleraciones, reposicionamiento (con el motor) y reordenacion espacial opcional
+void etapaReposicion(const ContextoIteracion &contexto, int iter) {
+    std::vector<Block> &blocks = contexto.recursos.bloques;
+    const int intervaloOrden = contexto.opciones.intervaloOrden;
+    contexto.recursos.tiempos.medir(Etapa::reposicion, [&] {
         initAccelerations(blocks);
-        malla.reposicionarParticulasBloque(blocks);
-        incrementDensities(blocks, constAccTransf.hSquared, malla);
-        transformDensities(blocks, smoothingLength, factorDensTransf);
-        transferAcceleration(blocks, constAccTransf, malla);
-        particleColissions(blocks, malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz());
-        particlesMovement(blocks);
-        limitInteractions(blocks, malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz());
+        contexto.recursos.contraste.ejecutar(contexto, Etapa::reposicion, iter, 0.0);
+        if (intervaloOrden > 0 && iter % intervaloOrden == 0) {
+            contexto.malla.ordenarParticulasBloques(blocks);
+        }
+        contexto.recursos.reposo.restaurar(blocks);
+    });
+}
+
+
+// Densidades, transformacion y transferencia de aceleraciones con el motor (con --cross-check, tambien con el de
+// referencia)
+void etapasInteraccion(const ContextoIteracion &contexto, int iter) {
+    contexto.recursos.contraste.ejecutar(contexto, Etapa::interacciones, iter, 0.0);
+}
+
+
+// Colisiones, movimiento y limites con el paso dado, con el motor (y el de referencia con --cross-check)
+void etapasMovimiento(const ContextoIteracion &contexto, int iter, double paso) {
+    contexto.recursos.contraste.ejecutar(contexto, Etapa::movimiento, iter, paso);
+}
+
+
+// Funcion que deja los bloques listos para reposicionar el fluido: si los de la simulacion anterior tienen las mismas
+// dimensiones (o la malla es dispersa) se vacian conservando su memoria, si no se copian los de la malla
+void prepararBloques(const Grid &malla, std::vector<Block> &blocks) {
+    const std::vector<Block> &bloquesMalla = malla.getBlocks();
+    const bool mismasDimensiones = blocks.size() == bloquesMalla.size() && !blocks.empty() &&
+                                   blocks.back().cx == bloquesMalla.back().cx &&
+                                   blocks.back().cy == bloquesMalla.back().cy &&
+                                   blocks.back().cz == bloquesMalla.back().cz;
+    if (!malla.getDisperso() && !mismasDimensiones) {
+        blocks = bloquesMalla;
+        return;
+    }
+    for (Block &block: blocks) {
+        block.particles.clear();
+        block.dormido = false;
     }
-    return blocks;
+}
+
+
+// Funcion que indica si quedan iteraciones: con paso fijo se cuentan, con paso adaptativo se compara el tiempo
+// simulado con el objetivo (y las iteraciones, si no son 0, actuan como limite)
+bool quedanIteraciones(const Argumentos &argumentos, int iter, double tiempo) {
+    const double tiempoObjetivo = argumentos.opciones.tiempoObjetivo;
+    if (tiempoObjetivo <= 0.0) {
+        return iter < argumentos.iteraciones;
+    }
+    return tiempo < tiempoObjetivo && (argumentos.iteraciones == 0 || iter < argumentos.iteraciones);
+}
+
+
+// Funcion que calcula el mayor paso de tiempo estable: ninguna particula avanza mas de una fraccion (CFL) de la
+// longitud de suavizado, y tampoco se supera el limite de estabilidad del muelle de las colisiones
+double calcularPasoAdaptativo(const std::vector<Block> &blocks, double smoothingLength, const Opciones &opciones) {
+    double maxVelocidad2 = 0.0;
+    double maxAceleracion2 = 0.0;
+    for (const auto &block: blocks) {
+        for (const auto &particle: block.particles) {
+            maxVelocidad2 = std::max(maxVelocidad2, particle.hvx * particle.hvx + particle.hvy * particle.hvy +
+                                                    particle.hvz * particle.hvz);
+            maxAceleracion2 = std::max(maxAceleracion2, particle.ax * particle.ax + particle.ay * particle.ay +
+                                                        particle.az * particle.az);
+        }
+    }
+
+    double paso = std::min(opciones.pasoMaximo, opciones.factorCFL * 2 / std::sqrt(Constantes::colisRigidez));
+    if (maxVelocidad2 > 0.0) {
+        paso = std::min(paso, opciones.factorCFL * smoothingLength / std::sqrt(maxVelocidad2));
+    }
+    if (maxAceleracion2 > 0.0) {
+        paso = std::min(paso, opciones.factorCFL * std::sqrt(smoothingLength / std::sqrt(maxAceleracion2)));
+    }
+    return paso;
 }
 
 
@@ -56,40 +247,14 @@ void initAccelerations(std::vector<Block> &blocks) {
 }
 
 
-// Funcion que calcula el indice de los bloques vecinos (para incremento de densidades y transferencia de aceleracion)
-inline int calcNeighborIndex(const Grid &malla, const int neighbor_cx, const int neighbor_cy, const int neighbor_cz) {
-    const int neighborIndex = static_cast<int>(neighbor_cz +
-                                               neighbor_cy * malla.getNumberblocksz()
-                                               + neighbor_cx * malla.getNumberblocksz() *
-                                                 malla.getNumberblocksy());
-    return neighborIndex;
-}
-
-
 // Funcion para la etapa de incremento de densidades
 void incrementDensities(std::vector<Block> &blocks, double hSquared, Grid &malla) {
     for (auto &block1: blocks) {
         for (auto &particle1: block1.particles) {
-
-            // Considera solo los bloques que son vecinos inmediatos de block1
-            for (int dz = -1; dz <= 1; ++dz) {
-                for (int dy = -1; dy <= 1; ++dy) {
-                    for (int dx = -1; dx <= 1; ++dx) {
-                        const int neighbor_cx = block1.cx + dx;
-                        const int neighbor_cy = block1.cy + dy;
-                        const int neighbor_cz = block1.cz + dz;
-
-                        // Comprueba si las coordenadas del vecino estan dentro de los limites del Grid
-                        if (neighbor_cx >= 0 && neighbor_cx < malla.getNumberblocksx() &&
-                            neighbor_cy >= 0 && neighbor_cy < malla.getNumberblocksy() &&
-                            neighbor_cz >= 0 && neighbor_cz < malla.getNumberblocksz()) {
-                            // Calcula el indice del bloque vecino
-                            int const neighborIndex = calcNeighborIndex(malla, neighbor_cx, neighbor_cy, neighbor_cz);
-                            comprobarParticula2Dens(blocks, particle1, hSquared, neighborIndex);
-                        }
-                    }
-                }
-            }
+            // Considera solo los bloques vecinos de block1 (en la malla dispersa solo los que existen)
+            malla.paraCadaVecinoZYX(block1, [&](int neighborIndex) {
+                comprobarParticula2Dens(blocks, particle1, hSquared, neighborIndex);
+            });
         }
     }
 }
@@ -131,73 +296,82 @@ double calculateDistanceSquared(const Particle &particle1, const Particle &parti
 // Funcion para la etapa de transformacion de densidades
 void transformDensities(std::vector<Block> &blocks, double h, double factorDensTransf) {
     for (auto &block: blocks) {
-        for (auto &particle: block.particles) {
-            particle.density = (particle.density + std::pow(h, Constantes::seis)) * factorDensTransf;
-        }
+        transformarDensidadesBloque(block, h, factorDensTransf);
+    }
+}
+
+
+// Transformacion de densidades de las particulas de un solo bloque
+void transformarDensidadesBloque(Block &block, double h, double factorDensTransf) {
+    for (auto &particle: block.particles) {
+        particle.density = (particle.density + std::pow(h, Constantes::seis)) * factorDensTransf;
+    }
+}
+
+
+// Con el nucleo rapido, ademas guarda las inversas de las densidades para la transferencia de aceleraciones (en los
+// bloques dormidos no hace nada: sus densidades ya estan transformadas)
+void transformarDensidadesBloque(Block &block, const ParametrosSimulacion &parametros) {
+    if (block.dormido) {
+        return;
+    }
+    transformarDensidadesBloque(block, parametros.smoothingLength, parametros.factorDensTransf);
+    if (parametros.nucleo == ModoNucleo::rapido) {
+        Nucleos::calcularInversas(block);
     }
 }
 
 
 // Funcion para la etapa de transferencia de aceleracion
-void transferAcceleration(std::vector<Block> &blocks, Constantes::ConstAccTransf &constAccTransf, Grid &malla) {
+void transferAcceleration(std::vector<Block> &blocks, const Constantes::ConstAccTransf &constAccTransf, Grid &malla) {
     for (auto &block1: blocks) {
         for (auto &particle1: block1.particles) {
-
-            // Considera solo los bloques que son vecinos inmediatos de block1
-            for (int dx = -1; dx <= 1; ++dx) {
-                for (int dy = -1; dy <= 1; ++dy) {
-                    for (int dz = -1; dz <= 1; ++dz) {
-                        const int neighbor_cx = block1.cx + dx;
-                        const int neighbor_cy = block1.cy + dy;
-                        const int neighbor_cz = block1.cz + dz;
-
-                        // Comprueba si las coordenadas del vecino estan dentro de los limites del Grid
-                        if (neighbor_cx >= 0 && neighbor_cx < malla.getNumberblocksx() &&
-                            neighbor_cy >= 0 && neighbor_cy < malla.getNumberblocksy() &&
-                            neighbor_cz >= 0 && neighbor_cz < malla.getNumberblocksz()) {
-                            // Calcula el indice del bloque vecino
-                            int const neighborIndex = calcNeighborIndex(malla, neighbor_cx, neighbor_cy, neighbor_cz);
-                            comprobarParticula2Acc(blocks, particle1, constAccTransf, neighborIndex);
-                        }
-                    }
-                }
-            }
+            // Considera solo los bloques vecinos de block1 (en la malla dispersa solo los que existen)
+            malla.paraCadaVecino(block1, [&](int neighborIndex) {
+                comprobarParticula2Acc(blocks, particle1, constAccTransf, neighborIndex);
+            });
         }
     }
 }
 
 
 // Funcion que realiza los calculos correspondientes a los bloques vecinos (es decir, a las "particle2")
-void comprobarParticula2Acc(std::vector<Block> &blocks, Particle &particle1, Constantes::ConstAccTransf &constAccTransf,
-                            int neighborIndex) {
+void comprobarParticula2Acc(std::vector<Block> &blocks, Particle &particle1,
+                            const Constantes::ConstAccTransf &constAccTransf, int neighborIndex) {
     Block &block2 = blocks[neighborIndex];
     for (auto &particle2: block2.particles) {
 
         // Calculamos valores para todas las particle2 con un indice mayor, asi nos aseguramos de no repetir
         if (particle1.id < particle2.id) {
-            const double distSquared = calculateDistanceSquared(particle1, particle2);
+            interaccionPar(particle1, particle2, constAccTransf);
+        }
+    }
+}
 
-            // Solo continuamos si la distancia al cuadrado es mayor que "hSquared"
-            if (distSquared >= constAccTransf.hSquared) {
-                continue;
-            }
 
-            // Calculamos la diferencia para cada coordenada y se lo aplicamos a ambas particulas
-            auto [deltaAijX, deltaAijY, deltaAijZ] = calcularDeltas(particle1, particle2, constAccTransf, distSquared);
-            particle1.ax += deltaAijX;
-            particle1.ay += deltaAijY;
-            particle1.az += deltaAijZ;
-            particle2.ax -= deltaAijX;
-            particle2.ay -= deltaAijY;
-            particle2.az -= deltaAijZ;
-        }
+// Funcion que aplica la interaccion de un par a las aceleraciones de ambas particulas
+void interaccionPar(Particle &particle1, Particle &particle2, const Constantes::ConstAccTransf &constAccTransf) {
+    const double distSquared = calculateDistanceSquared(particle1, particle2);
+
+    // Solo continuamos si la distancia al cuadrado es menor que "hSquared"
+    if (distSquared >= constAccTransf.hSquared) {
+        return;
     }
+
+    // Calculamos la diferencia para cada coordenada y se lo aplicamos a ambas particulas
+    auto [deltaAijX, deltaAijY, deltaAijZ] = calcularDeltas(particle1, particle2, constAccTransf, distSquared);
+    particle1.ax += deltaAijX;
+    particle1.ay += deltaAijY;
+    particle1.az += deltaAijZ;
+    particle2.ax -= deltaAijX;
+    particle2.ay -= deltaAijY;
+    particle2.az -= deltaAijZ;
 }
 
 
 // Funcion que calcula la diferencia que se va a sumar y restar a las aceleraciones de las particulas
 std::tuple<double, double, double>
-calcularDeltas(Particle &particle1, Particle &particle2, Constantes::ConstAccTransf &constAccTransf,
+calcularDeltas(const Particle &particle1, const Particle &particle2, const Constantes::ConstAccTransf &constAccTransf,
                double distSquared) {
     const double maxDistanceSquared = std::max(distSquared, Constantes::smallQ);
     const double dist = std::sqrt(maxDistanceSquared);
@@ -224,9 +398,92 @@ calcularDeltas(Particle &particle1, Particle &particle2, Constantes::ConstAccTra
 }
 
 
+namespace {
+    // Suma a particle1 las contribuciones de las particulas [desde, hasta) de un vecino con menor id que ella (en la
+    // version en serie esas particulas son "particle1" y la contribucion la recibe la otra, "particle2")
+    template <typename Sumar>
+    void sumarComoSegunda(Particle &particle1, const VectorParticulas &particulas,
+                          std::pair<std::size_t, std::size_t> rango, Sumar &sumar) {
+        for (std::size_t j = rango.first; j < rango.second; ++j) {
+            if (particulas[j].id < particle1.id) {
+                sumar(particle1, particulas[j], false);
+            }
+        }
+    }
+
+    // Suma a particle1 las contribuciones de las particulas de un vecino con mayor id que ella
+    template <typename Sumar>
+    void sumarComoPrimera(Particle &particle1, const VectorParticulas &particulas, Sumar &sumar) {
+        for (const auto &particle2: particulas) {
+            if (particle1.id < particle2.id) {
+                sumar(particle1, particle2, true);
+            }
+        }
+    }
+
+    // Recorre los pares de cada particula del bloque en el orden en que la version en serie se los suma. Esta
+    // recorre los bloques por indice (el orden de paraCadaVecino) y, para cada particula, sus vecinas con mayor id
+    // en el orden de su vecindad, asi una particula recibe primero lo de las vecinas con menor id que van antes que
+    // ella, despues lo suyo y al final lo de las vecinas con menor id que van despues
+    template <bool ordenZYX, typename Sumar>
+    void paresEnOrdenSerie(std::vector<Block> &blocks, int indice, const Grid &malla, Sumar &&sumar) {
+        Block &block1 = blocks[indice];
+        for (std::size_t i = 0; i < block1.particles.size(); ++i) {
+            Particle &particle1 = block1.particles[i];
+            malla.paraCadaVecino(block1, [&](int vecino) {
+                const std::size_t hasta = vecino < indice ? blocks[vecino].particles.size() : i;
+                sumarComoSegunda(particle1, blocks[vecino].particles, {0, vecino <= indice ? hasta : 0}, sumar);
+            });
+            const auto comoPrimera = [&](int vecino) { sumarComoPrimera(particle1, blocks[vecino].particles, sumar); };
+            if constexpr (ordenZYX) {
+                malla.paraCadaVecinoZYX(block1, comoPrimera);
+            } else {
+                malla.paraCadaVecino(block1, comoPrimera);
+            }
+            malla.paraCadaVecino(block1, [&](int vecino) {
+                const std::size_t desde = vecino > indice ? 0 : i + 1;
+                const std::size_t hasta = vecino >= indice ? blocks[vecino].particles.size() : 0;
+                sumarComoSegunda(particle1, blocks[vecino].particles, {desde, hasta}, sumar);
+            });
+        }
+    }
+}
+
+
+void densidadesBloqueOrdenado(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla) {
+    paresEnOrdenSerie<true>(blocks, indice, malla, [hSquared](Particle &particle1, const Particle &particle2,
+                                                              bool /*esPrimera*/) {
+        const double distSquared = calculateDistanceSquared(particle1, particle2);
+        if (distSquared < hSquared) {
+            particle1.density += std::pow(((hSquared) - distSquared), 3);
+        }
+    });
+}
+
+
+// Cada par se aplica con "interaccionPar", igual que en la version en serie, pero la otra particula es una copia
+// (cada bloque solo escribe en sus propias particulas). Asi las operaciones de cada par son las mismas, incluidas
+// las multiplicaciones y sumas que el compilador fusiona
+void aceleracionesBloqueOrdenado(std::vector<Block> &blocks, int indice,
+                                 const Constantes::ConstAccTransf &constAccTransf, const Grid &malla) {
+    paresEnOrdenSerie<false>(blocks, indice, malla, [&constAccTransf](Particle &particle1, const Particle &particle2,
+                                                                      bool esPrimera) {
+        if (calculateDistanceSquared(particle1, particle2) >= constAccTransf.hSquared) {
+            return;
+        }
+        Particle copia = particle2;
+        if (esPrimera) {
+            interaccionPar(particle1, copia, constAccTransf);
+        } else {
+            interaccionPar(copia, particle1, constAccTransf);
+        }
+    });
+}
+
+
 // Funcion que gestiona las colisiones de particulas en el eje x
-void handleXCollisions(Particle &particle, int cx, double numberblocksx) {
-    double const newPositionX = particle.px + particle.hvx * Constantes::pasoTiempo;
+void handleXCollisions(Particle &particle, int cx, double numberblocksx, double pasoTiempo) {
+    double const newPositionX = particle.px + particle.hvx * pasoTiempo;
     double deltaX = NAN;
 
     if (cx == 0) {
@@ -244,8 +501,8 @@ void handleXCollisions(Particle &particle, int cx, double numberblocksx) {
 
 
 // Funcion que gestiona las colisiones de particulas en el eje y
-void handleYCollisions(Particle &particle, int cy, double numberblocksy) {
-    double const newPositionY = particle.py + particle.hvy * Constantes::pasoTiempo;
+void handleYCollisions(Particle &particle, int cy, double numberblocksy, double pasoTiempo) {
+    double const newPositionY = particle.py + particle.hvy * pasoTiempo;
     double deltaY = NAN;
 
     if (cy == 0) {
@@ -263,8 +520,8 @@ void handleYCollisions(Particle &particle, int cy, double numberblocksy) {
 
 
 // Funcion que gestiona las colisiones de particulas en el eje z
-void handleZCollisions(Particle &particle, int cz, double numberblocksz) {
-    double const newPositionZ = particle.pz + particle.hvz * Constantes::pasoTiempo;
+void handleZCollisions(Particle &particle, int cz, double numberblocksz, double pasoTiempo) {
+    double const newPositionZ = particle.pz + particle.hvz * pasoTiempo;
     double deltaZ = NAN;
 
     if (cz == 0) {
@@ -283,50 +540,79 @@ void handleZCollisions(Particle &particle, int cz, double numberblocksz) {
 
 // Funcion para la etapa de colisiones de particulas
 void particleColissions(std::vector<Block> &blocks, double numberblocksx, double numberblocksy, double numberblocksz) {
+    particleColissions(blocks, Punto{numberblocksx, numberblocksy, numberblocksz}, Constantes::pasoTiempo);
+}
+
+
+// Funcion para la etapa de colisiones de particulas con un paso de tiempo dado ("numBloques" por coordenada)
+void particleColissions(std::vector<Block> &blocks, const Punto &numBloques, double pasoTiempo, int subdivision) {
     for (auto &block: blocks) {
-        for (auto &particula: block.particles) {
-            /* Si un bloque tiene cx==0 o cx== numbrblocks-1, se actualiza el ax de todas las particulas de ese bloque
-            llamando a handleXCollisions */
-            if (block.cx == 0 || block.cx == static_cast<int>(numberblocksx) - 1) {
-                handleXCollisions(particula, block.cx, numberblocksx);
-            }
-            /* Si un bloque tiene cy==0 o cy== numbrblocks-1, se actualiza el ay de todas las particulas de ese bloque
-            llamando a handleYCollisions */
-            if (block.cy == 0 || block.cy == static_cast<int>(numberblocksy) - 1) {
-                handleYCollisions(particula, block.cy, numberblocksy);
-            }
-            /* Si un bloque tiene cz==0 o cz== numbrblocks-1, se actualiza el az de todas las particulas de ese bloque
-            llamando a handleZCollisions */
-            if (block.cz == 0 || block.cz == static_cast<int>(numberblocksz) - 1) {
-                handleZCollisions(particula, block.cz, numberblocksz);
-            }
+        colisionesBloque(block, numBloques, pasoTiempo, subdivision);
+    }
+}
+
+
+// Funcion que devuelve el indice que ven las funciones de las paredes: 0 en las celdas del primer bloque sin
+// subdividir, numBloques - 1 en las del ultimo y -1 en el resto (con "subdivision" 1, el propio indice o -1)
+int indicePared(int indice, double numBloques, int subdivision) {
+    if (indice < subdivision) {
+        return 0;
+    }
+    if (indice >= static_cast<int>(numBloques) - subdivision) {
+        return static_cast<int>(numBloques) - 1;
+    }
+    return -1;
+}
+
+
+// Colisiones de las particulas de un solo bloque
+void colisionesBloque(Block &block, const Punto &numBloques, double pasoTiempo, int subdivision) {
+    const int paredX = indicePared(block.cx, numBloques.x, subdivision);
+    const int paredY = indicePared(block.cy, numBloques.y, subdivision);
+    const int paredZ = indicePared(block.cz, numBloques.z, subdivision);
+    for (auto &particula: block.particles) {
+        // Solo las particulas de los bloques junto a una pared pueden chocar con ella
+        if (paredX >= 0) {
+            handleXCollisions(particula, paredX, numBloques.x, pasoTiempo);
+        }
+        if (paredY >= 0) {
+            handleYCollisions(particula, paredY, numBloques.y, pasoTiempo);
+        }
+        if (paredZ >= 0) {
+            handleZCollisions(particula, paredZ, numBloques.z, pasoTiempo);
         }
     }
 }
 
 
 // Funcion para la etapa de movimiento de particulas
-void particlesMovement(std::vector<Block> &blocks) {
+void particlesMovement(std::vector<Block> &blocks, double pasoTiempo) {
     for (auto &block: blocks) {
-        for (auto &particle: block.particles) {
-            // Actualiza los valores de la posicion
-            particle.px = particle.px + particle.hvx * Constantes::pasoTiempo +
-                          particle.ax * std::pow(Constantes::pasoTiempo, 2);
-            particle.py = particle.py + particle.hvy * Constantes::pasoTiempo +
-                          particle.ay * std::pow(Constantes::pasoTiempo, 2);
-            particle.pz = particle.pz + particle.hvz * Constantes::pasoTiempo +
-                          particle.az * std::pow(Constantes::pasoTiempo, 2);
+        movimientoBloque(block, pasoTiempo);
+    }
+}
 
-            // Actualiza los valores de la velocidad
-            particle.vx = particle.hvx + (particle.ax * Constantes::pasoTiempo) * Constantes::factor05;
-            particle.vy = particle.hvy + (particle.ay * Constantes::pasoTiempo) * Constantes::factor05;
-            particle.vz = particle.hvz + (particle.az * Constantes::pasoTiempo) * Constantes::factor05;
 
-            // Actualiza los valores del gradiente de velocidad
-            particle.hvx = particle.hvx + particle.ax * Constantes::pasoTiempo;
-            particle.hvy = particle.hvy + particle.ay * Constantes::pasoTiempo;
-            particle.hvz = particle.hvz + particle.az * Constantes::pasoTiempo;
-        }
+// Movimiento de las particulas de un solo bloque
+void movimientoBloque(Block &block, double pasoTiempo) {
+    for (auto &particle: block.particles) {
+        // Actualiza los valores de la posicion
+        particle.px = particle.px + particle.hvx * pasoTiempo +
+                      particle.ax * std::pow(pasoTiempo, 2);
+        particle.py = particle.py + particle.hvy * pasoTiempo +
+                      particle.ay * std::pow(pasoTiempo, 2);
+        particle.pz = particle.pz + particle.hvz * pasoTiempo +
+                      particle.az * std::pow(pasoTiempo, 2);
+
+        // Actualiza los valores de la velocidad
+        particle.vx = particle.hvx + (particle.ax * pasoTiempo) * Constantes::factor05;
+        particle.vy = particle.hvy + (particle.ay * pasoTiempo) * Constantes::factor05;
+        particle.vz = particle.hvz + (particle.az * pasoTiempo) * Constantes::factor05;
+
+        // Actualiza los valores del gradiente de velocidad
+        particle.hvx = particle.hvx + particle.ax * pasoTiempo;
+        particle.hvy = particle.hvy + particle.ay * pasoTiempo;
+        particle.hvz = particle.hvz + particle.az * pasoTiempo;
     }
 }
 
@@ -389,23 +675,33 @@ void InteractionLimitZ(Particle &particle, int cz, double numberblocksz) {
 
 // Funcion para la etapa de interacciones con los limites del recinto
 void limitInteractions(std::vector<Block> &blocks, double numberblocksx, double numberblocksy, double numberblocksz) {
+    limitInteractions(blocks, Punto{numberblocksx, numberblocksy, numberblocksz}, 1);
+}
+
+
+// Funcion para la etapa de interacciones con los limites con la malla subdividida ("numBloques" por coordenada)
+void limitInteractions(std::vector<Block> &blocks, const Punto &numBloques, int subdivision) {
     for (auto &block: blocks) {
-        for (auto &particula: block.particles) {
-            /* Si un bloque tiene cx==0 o cx== numbrblocks-1, se actualiza el ax de todas las particulas de ese bloque
-            llamando a handleXCollisions */
-            if (block.cx == 0 || block.cx == static_cast<int>(numberblocksx) - 1) {
-                InteractionLimitX(particula, block.cx, numberblocksx);
-            }
-            /* Si un bloque tiene cy==0 o cy== numbrblocks-1, se actualiza el ay de todas las particulas de ese bloque
-            llamando a handleYCollisions */
-            if (block.cy == 0 || block.cy == static_cast<int>(numberblocksy) - 1) {
-                InteractionLimitY(particula, block.cy, numberblocksy);
-            }
-            /* Si un bloque tiene cz==0 o cz== numbrblocks-1, se actualiza el az de todas las particulas de ese bloque
-            llamando a handleZCollisions */
-            if (block.cz == 0 || block.cz == static_cast<int>(numberblocksz) - 1) {
-                InteractionLimitZ(particula, block.cz, numberblocksz);
-            }
+        limitesBloque(block, numBloques, subdivision);
+    }
+}
+
+
+// Interacciones con los limites del recinto de las particulas de un solo bloque
+void limitesBloque(Block &block, const Punto &numBloques, int subdivision) {
+    const int paredX = indicePared(block.cx, numBloques.x, subdivision);
+    const int paredY = indicePared(block.cy, numBloques.y, subdivision);
+    const int paredZ = indicePared(block.cz, numBloques.z, subdivision);
+    for (auto &particula: block.particles) {
+        // Solo las particulas de los bloques junto a una pared pueden haberla atravesado
+        if (paredX >= 0) {
+            InteractionLimitX(particula, paredX, numBloques.x);
+        }
+        if (paredY >= 0) {
+            InteractionLimitY(particula, paredY, numBloques.y);
+        }
+        if (paredZ >= 0) {
+            InteractionLimitZ(particula, paredZ, numBloques.z);
         }
     }
 }
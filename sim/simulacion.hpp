@@ -17,10 +17,56 @@
 #include "sim/constantes.hpp"
 #include "sim/progargs.hpp"
 
+// Valores calculados una vez antes de iterar, comunes a todas las etapas
+struct ParametrosSimulacion {
+    double smoothingLength;
+    double factorDensTransf;
+    Constantes::ConstAccTransf constAccTransf;
+    ModoNucleo nucleo;
+    bool determinista; // Las versiones "gather" suman en el orden de la version en serie (ver paralelo.hpp)
+    bool listaPares; // La densidad anota los pares que interactuan y la aceleracion los recorre (ver paralelo.hpp)
+};
+
+ParametrosSimulacion calcularParametros(double smoothingLength, double particleMass,
+                                        ModoNucleo nucleo = ModoNucleo::exacto, bool determinista = false);
+
+// Los mismos, con el nucleo y los modos de interaccion de las opciones
+ParametrosSimulacion calcularParametros(double smoothingLength, double particleMass, const Opciones &opciones);
+
+// Motores paralelos y bloques que se pueden reutilizar de una simulacion a la siguiente (ver paralelo.hpp)
+struct RecursosSimulacion;
+
 // Funcion llamada una vez por iteracion, llama al resto de funciones
 std::vector<Block>
 ejecutarIteraciones(Grid &malla, Argumentos &argumentos, double smoothingLength, double particleMass);
 
+std::vector<Block> &ejecutarIteraciones(Grid &malla, Argumentos &argumentos, const ParametrosSimulacion &parametros,
+                                        RecursosSimulacion &recursos);
+
+void prepararBloques(const Grid &malla, std::vector<Block> &blocks);
+
+// Lo que necesita cada iteracion de una simulacion en curso (los bloques estan en "recursos")
+struct ContextoIteracion {
+    Grid &malla;
+    const Opciones &opciones;
+    const ParametrosSimulacion &parametros;
+    RecursosSimulacion &recursos;
+};
+
+double ejecutarIteracion(const ContextoIteracion &contexto, int iter, double tiempo);
+
+double ejecutarEtapas(const ContextoIteracion &contexto, int iter, double tiempo);
+
+void etapaReposicion(const ContextoIteracion &contexto, int iter);
+
+void etapasInteraccion(const ContextoIteracion &contexto, int iter);
+
+void etapasMovimiento(const ContextoIteracion &contexto, int iter, double paso);
+
+void escribirTiempos(const Opciones &opciones, const RecursosSimulacion &recursos, int iteraciones);
+
+bool quedanIteraciones(const Argumentos &argumentos, int iter, double tiempo);
+
 // Inicializacion de la densidad y las aceleraciones
 void initAccelerations(std::vector<Block> &blocks);
 
@@ -33,23 +79,54 @@ void comprobarParticula2Dens(std::vector<Block> &blocks, Particle &particle1, do
 void transformDensities(std::vector<Block> &blocks, double h, double factorDensTransf);
 
 // Transferencia de aceleraciones
-void transferAcceleration(std::vector<Block> &blocks, Constantes::ConstAccTransf &constAccTransf, Grid &malla);
+void transferAcceleration(std::vector<Block> &blocks, const Constantes::ConstAccTransf &constAccTransf, Grid &malla);
+
+void comprobarParticula2Acc(std::vector<Block> &blocks, Particle &particle1,
+                            const Constantes::ConstAccTransf &constAccTransf, int neighborIndex);
 
-void comprobarParticula2Acc(std::vector<Block> &blocks, Particle &particle1, Constantes::ConstAccTransf &constAccTransf,
-                            int neighborIndex);
+void interaccionPar(Particle &particle1, Particle &particle2, const Constantes::ConstAccTransf &constAccTransf);
+
+double calculateDistanceSquared(const Particle &particle1, const Particle &particle2);
 
 std::tuple<double, double, double>
-calcularDeltas(Particle &particle1, Particle &particle2, Constantes::ConstAccTransf &constAccTransf,
+calcularDeltas(const Particle &particle1, const Particle &particle2, const Constantes::ConstAccTransf &constAccTransf,
                double distSquared);
 
+// Versiones "gather" de las dos etapas anteriores que suman las contribuciones de cada particula del bloque en el
+// mismo orden que ellas, asi el resultado es identico bit a bit al de la version en serie con cualquier numero de
+// hilos. Estan junto a las etapas en serie para que el compilador genere las mismas operaciones para cada par
+void densidadesBloqueOrdenado(std::vector<Block> &blocks, int indice, double hSquared, const Grid &malla);
+
+void aceleracionesBloqueOrdenado(std::vector<Block> &blocks, int indice,
+                                 const Constantes::ConstAccTransf &constAccTransf, const Grid &malla);
+
+// Paso de tiempo adaptativo (el mayor paso estable segun la velocidad y la aceleracion maximas)
+double calcularPasoAdaptativo(const std::vector<Block> &blocks, double smoothingLength, const Opciones &opciones);
+
 // Colisiones de particulas
 void particleColissions(std::vector<Block> &blocks, double numberblocksx, double numberblocksy, double numberblocksz);
 
+// Con la malla subdividida, las paredes afectan a todas las celdas del primer y el ultimo bloque sin subdividir
+void particleColissions(std::vector<Block> &blocks, const Punto &numBloques, double pasoTiempo, int subdivision = 1);
+
 // Movimiento de particulas
-void particlesMovement(std::vector<Block> &blocks);
+void particlesMovement(std::vector<Block> &blocks, double pasoTiempo = Constantes::pasoTiempo);
 
 // Interaciones con los limites del recinto
 void limitInteractions(std::vector<Block> &blocks, double numberblocksx, double numberblocksy, double numberblocksz);
 
+void limitInteractions(std::vector<Block> &blocks, const Punto &numBloques, int subdivision);
+
+// Versiones de las etapas que solo afectan a las particulas de un bloque (las usan los motores paralelos)
+void transformarDensidadesBloque(Block &block, double h, double factorDensTransf);
+
+void transformarDensidadesBloque(Block &block, const ParametrosSimulacion &parametros);
+
+void colisionesBloque(Block &block, const Punto &numBloques, double pasoTiempo, int subdivision = 1);
+
+void movimientoBloque(Block &block, double pasoTiempo);
+
+void limitesBloque(Block &block, const Punto &numBloques, int subdivision = 1);
+
 
 #endif //FLUID_SIMULACION_HPP
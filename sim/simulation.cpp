@@ -0,0 +1,183 @@
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "sim/constantes.hpp"
+#include "sim/grid.hpp"
+#include "sim/paralelo.hpp"
+#include "sim/simulacion.hpp"
+#include "simulation.hpp"
+
+namespace {
+    const Simulation::VistaCampo::Componentes componentesPosicion = {&Particle::px, &Particle::py, &Particle::pz};
+    const Simulation::VistaCampo::Componentes componentesVelocidad = {&Particle::vx, &Particle::vy, &Particle::vz};
+}
+
+// Todo lo que la simulacion conserva entre llamadas. "ubicaciones" (id -> bloque y posicion) se construye al
+// acceder por id y se descarta cuando las particulas se mueven
+struct Simulation::Estado {
+    Opciones opciones;
+    Grid malla{Constantes::limInferior, Constantes::limSuperior};
+    ParametrosSimulacion parametros{};
+    RecursosSimulacion recursos;
+    std::vector<Particle> iniciales;
+    double particulasPorMetro{0.0};
+    double tiempo{0.0};
+    int iteraciones{0};
+    mutable std::vector<std::pair<int, int>> ubicaciones;
+    mutable bool ubicacionesValidas{false};
+
+    [[nodiscard]] bool terminada() const {
+        return opciones.tiempoObjetivo > 0.0 && tiempo >= opciones.tiempoObjetivo;
+    }
+
+    // Funcion que devuelve la particula con ese id, reconstruyendo el indice si las particulas se han movido
+    [[nodiscard]] const Particle &particula(int id) const {
+        if (id < 0 || static_cast<std::size_t>(id) >= iniciales.size()) {
+            throw std::out_of_range("Simulation: particle id out of range");
+        }
+        const std::vector<Block> &bloques = recursos.bloques;
+        if (!ubicacionesValidas) {
+            ubicaciones.resize(iniciales.size());
+            for (std::size_t bloque = 0; bloque < bloques.size(); ++bloque) {
+                const VectorParticulas &particulas = bloques[bloque].particles;
+                for (std::size_t posicion = 0; posicion < particulas.size(); ++posicion) {
+                    ubicaciones[particulas[posicion].id] = {static_cast<int>(bloque), static_cast<int>(posicion)};
+                }
+            }
+            ubicacionesValidas = true;
+        }
+        const auto [bloque, posicion] = ubicaciones[id];
+        return bloques[bloque].particles[posicion];
+    }
+};
+
+
+Simulation::Simulation(const Opciones &opciones) : estado(std::make_unique<Estado>()) {
+    estado->opciones = opciones;
+}
+
+Simulation::~Simulation() = default;
+
+Simulation::Simulation(Simulation &&) noexcept = default;
+
+Simulation &Simulation::operator=(Simulation &&) noexcept = default;
+
+
+// Funcion que comprueba las particulas (ids 0..n-1 sin repetir), las guarda y vuelve al tiempo 0
+void Simulation::load(std::span<const Particle> particulas, double particlesPerMeter) {
+    if (!(particlesPerMeter > 0.0)) {
+        throw std::invalid_argument("Simulation::load: particles per meter must be positive");
+    }
+    std::vector<bool> vistos(particulas.size(), false);
+    for (const Particle &particula: particulas) {
+        if (particula.id < 0 || static_cast<std::size_t>(particula.id) >= particulas.size() ||
+            vistos[particula.id]) {
+            throw std::invalid_argument("Simulation::load: particle ids must be 0..n-1 without repeats");
+        }
+        vistos[particula.id] = true;
+    }
+    estado->iniciales.assign(particulas.begin(), particulas.end());
+    estado->particulasPorMetro = particlesPerMeter;
+    reset();
+}
+
+
+// Funcion que divide la malla (solo si cambia la longitud de suavizado) y vuelve a colocar las particulas cargadas
+void Simulation::reset() {
+    Estado &actual = *estado;
+    if (actual.iniciales.empty()) {
+        throw std::logic_error("Simulation::reset: no particles loaded");
+    }
+    // Mismas expresiones que "simular_malla", asi los resultados coinciden con los de "fluid"
+    const double smoothingLength = Constantes::multRadio / actual.particulasPorMetro;
+    const double particleMass = std::pow(10.0, 3.0) / std::pow(actual.particulasPorMetro, 3.0);
+    actual.parametros = calcularParametros(smoothingLength, particleMass, actual.opciones);
+    actual.malla.setDisperso(actual.opciones.mallaDispersa);
+    actual.malla.setSubdivision(actual.opciones.subdivision);
+    actual.malla.dividirEnBloques(smoothingLength);
+    actual.recursos.preparar(actual.opciones);
+    prepararBloques(actual.malla, actual.recursos.bloques);
+    actual.malla.reposicionarParticulas(actual.iniciales, actual.recursos.bloques);
+    actual.tiempo = 0.0;
+    actual.iteraciones = 0;
+    actual.ubicacionesValidas = false;
+}
+
+
+void Simulation::step(int pasos) {
+    Estado &actual = *estado;
+    if (actual.iniciales.empty()) {
+        throw std::logic_error("Simulation::step: no particles loaded");
+    }
+    const ContextoIteracion contexto{actual.malla, actual.opciones, actual.parametros, actual.recursos};
+    for (int paso = 0; paso < pasos && !actual.terminada(); ++paso) {
+        actual.tiempo += ejecutarIteracion(contexto, actual.iteraciones, actual.tiempo);
+        ++actual.iteraciones;
+    }
+    actual.ubicacionesValidas = false;
+}
+
+
+double Simulation::time() const { return estado->tiempo; }
+
+int Simulation::iterations() const { return estado->iteraciones; }
+
+std::size_t Simulation::size() const { return estado->iniciales.size(); }
+
+Simulation::VistaCampo Simulation::positions() const { return {estado.get(), componentesPosicion}; }
+
+Simulation::VistaCampo Simulation::velocities() const { return {estado.get(), componentesVelocidad}; }
+
+
+Simulation::VistaCampo::VistaCampo(const Estado *estado, const Componentes &componentes)
+        : estado(estado), componentes(componentes) {}
+
+Simulation::VistaCampo::Iterador Simulation::VistaCampo::begin() const {
+    return {&estado->recursos.bloques, 0, &componentes};
+}
+
+Simulation::VistaCampo::Iterador Simulation::VistaCampo::end() const {
+    return {&estado->recursos.bloques, estado->recursos.bloques.size(), &componentes};
+}
+
+std::size_t Simulation::VistaCampo::size() const { return estado->iniciales.size(); }
+
+Punto Simulation::VistaCampo::operator[](int id) const {
+    const Particle &particula = estado->particula(id);
+    return {particula.*componentes[0], particula.*componentes[1], particula.*componentes[2]};
+}
+
+
+Simulation::VistaCampo::Iterador::Iterador(const std::vector<Block> *bloques, std::size_t bloque,
+                                           const Componentes *componentes)
+        : bloques(bloques), bloque(bloque), componentes(componentes) {
+    saltarVacios();
+}
+
+Punto Simulation::VistaCampo::Iterador::operator*() const {
+    const Particle &particula = (*bloques)[bloque].particles[posicion];
+    return {particula.*(*componentes)[0], particula.*(*componentes)[1], particula.*(*componentes)[2]};
+}
+
+int Simulation::VistaCampo::Iterador::id() const { return (*bloques)[bloque].particles[posicion].id; }
+
+Simulation::VistaCampo::Iterador &Simulation::VistaCampo::Iterador::operator++() {
+    ++posicion;
+    saltarVacios();
+    return *this;
+}
+
+Simulation::VistaCampo::Iterador Simulation::VistaCampo::Iterador::operator++(int) {
+    Iterador anterior = *this;
+    ++*this;
+    return anterior;
+}
+
+// Funcion que pasa al siguiente bloque con particulas cuando se acaban las del actual (o se llega al final)
+void Simulation::VistaCampo::Iterador::saltarVacios() {
+    while (bloque < bloques->size() && posicion == (*bloques)[bloque].particles.size()) {
+        ++bloque;
+        posicion = 0;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_SIMULATION_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_SIMULATION_HPP
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <vector>
+#include "sim/block.hpp"
+#include "sim/progargs.hpp"
+
+// Simulacion embebible: otro programa carga las particulas, avanza paso a paso y lee posiciones y velocidades sin
+// pasar por ficheros. La malla, los bloques y los motores paralelos quedan dentro; las vistas recorren las
+// particulas en el orden en que estan guardadas (no por id) y dejan de ser validas al llamar a step, load o reset
+class Simulation {
+    struct Estado;
+
+public:
+    // Vista de solo lectura de un campo (posicion o velocidad) de todas las particulas, sin copiarlas
+    class VistaCampo {
+    public:
+        using Componentes = std::array<double Particle::*, 3>;
+
+        class Iterador {
+        public:
+            using value_type = Punto;
+            using difference_type = std::ptrdiff_t;
+
+            Iterador() = default;
+
+            Iterador(const std::vector<Block> *bloques, std::size_t bloque, const Componentes *componentes);
+
+            [[nodiscard]] Punto operator*() const;
+
+            [[nodiscard]] int id() const; // Id de la particula a la que apunta
+
+            Iterador &operator++();
+
+            Iterador operator++(int);
+
+            bool operator==(const Iterador &otro) const = default;
+
+        private:
+            const std::vector<Block> *bloques{nullptr};
+            std::size_t bloque{0};
+            std::size_t posicion{0};
+            const Componentes *componentes{nullptr};
+
+            void saltarVacios();
+        };
+
+        VistaCampo(const Estado *estado, const Componentes &componentes);
+
+        [[nodiscard]] Iterador begin() const;
+
+        [[nodiscard]] Iterador end() const;
+
+        [[nodiscard]] std::size_t size() const;
+
+        // Valor de la particula con ese id (lanza std::out_of_range si no existe)
+        [[nodiscard]] Punto operator[](int id) const;
+
+    private:
+        const Estado *estado;
+        Componentes componentes;
+    };
+
+    explicit Simulation(const Opciones &opciones = {});
+
+    ~Simulation();
+
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+    Simulation(Simulation &&) noexcept;
+    Simulation &operator=(Simulation &&) noexcept;
+
+    // Carga las particulas (sus ids deben ser 0..n-1 en cualquier orden) y deja la simulacion en el tiempo 0
+    void load(std::span<const Particle> particulas, double particlesPerMeter);
+
+    // Avanza "pasos" iteraciones (con paso adaptativo, para antes si se alcanza el tiempo objetivo)
+    void step(int pasos = 1);
+
+    // Vuelve al estado cargado con "load" reutilizando la malla, los bloques y los motores
+    void reset();
+
+    [[nodiscard]] double time() const;
+
+    [[nodiscard]] int iterations() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] VistaCampo positions() const;
+
+    [[nodiscard]] VistaCampo velocities() const;
+
+private:
+    std::unique_ptr<Estado> estado;
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_SIMULATION_HPP
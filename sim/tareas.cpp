@@ -0,0 +1,108 @@
+#include "tareas.hpp"
+#include "traza.hpp"
+
+
+// Crea los hilos de trabajo (el hilo que llama a "ejecutar" es uno mas, por eso se crean numHilos - 1)
+GrafoTareas::GrafoTareas(int numHilos) {
+    for (int i = 1; i < numHilos; ++i) {
+        hilos.emplace_back([this] { trabajar(false); });
+    }
+}
+
+
+GrafoTareas::~GrafoTareas() {
+    {
+        const std::scoped_lock bloqueo(mutex);
+        terminar = true;
+    }
+    hayTrabajo.notify_all();
+    for (std::thread &hilo: hilos) {
+        hilo.join();
+    }
+}
+
+
+int GrafoTareas::agregarTarea(std::function<void()> tarea) {
+    tareas.push_back(std::move(tarea));
+    sucesores.emplace_back();
+    numDependencias.push_back(0);
+    return static_cast<int>(tareas.size()) - 1;
+}
+
+
+void GrafoTareas::agregarDependencia(int antes, int despues) {
+    sucesores[antes].push_back(despues);
+    ++numDependencias[despues];
+}
+
+
+void GrafoTareas::vaciar() {
+    tareas.clear();
+    sucesores.clear();
+    numDependencias.clear();
+}
+
+
+// Funcion que lanza las tareas sin dependencias y trabaja hasta que se han completado todas
+void GrafoTareas::ejecutar() {
+    if (tareas.empty()) {
+        return;
+    }
+    {
+        const std::scoped_lock bloqueo(mutex);
+        pendientes = numDependencias;
+        restantes = tareas.size();
+        for (std::size_t i = 0; i < tareas.size(); ++i) {
+            if (numDependencias[i] == 0) {
+                listas.push_back(static_cast<int>(i));
+            }
+        }
+    }
+    hayTrabajo.notify_all();
+    trabajar(true);
+}
+
+
+// Bucle de un hilo: coge tareas listas y las ejecuta (con --trace, cada una es un intervalo). El hilo que llamo a
+// "ejecutar" sale al terminar el grafo, los hilos persistentes al destruir el grafo
+void GrafoTareas::trabajar(bool esperarFin) {
+    while (true) {
+        int tarea = -1;
+        {
+            std::unique_lock bloqueo(mutex);
+            hayTrabajo.wait(bloqueo, [&] {
+                return terminar || !listas.empty() || (esperarFin && restantes == 0);
+            });
+            if (listas.empty()) {
+                return;
+            }
+            tarea = listas.front();
+            listas.pop_front();
+        }
+        {
+            const Traza::Ambito ambito("task", "task", tarea);
+            tareas[tarea]();
+        }
+        completar(tarea);
+    }
+}
+
+
+// Funcion que marca una tarea como terminada y libera a las tareas que solo esperaban por ella
+void GrafoTareas::completar(int tarea) {
+    bool nuevas = false;
+    bool fin = false;
+    {
+        const std::scoped_lock bloqueo(mutex);
+        for (const int sucesor: sucesores[tarea]) {
+            if (--pendientes[sucesor] == 0) {
+                listas.push_back(sucesor);
+                nuevas = true;
+            }
+        }
+        fin = --restantes == 0;
+    }
+    if (fin || nuevas) {
+        hayTrabajo.notify_all();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_TAREAS_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_TAREAS_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Grafo de tareas con dependencias. Una tarea se ejecuta en cuanto terminan todas las tareas de las que depende,
+// sin barreras globales. Los hilos son persistentes y el grafo se puede ejecutar varias veces sin reconstruirlo
+class GrafoTareas {
+public:
+    explicit GrafoTareas(int numHilos);
+
+    GrafoTareas(const GrafoTareas &) = delete;
+    GrafoTareas &operator=(const GrafoTareas &) = delete;
+    GrafoTareas(GrafoTareas &&) = delete;
+    GrafoTareas &operator=(GrafoTareas &&) = delete;
+
+    ~GrafoTareas();
+
+    int agregarTarea(std::function<void()> tarea);
+
+    // La tarea "despues" no empezara hasta que termine la tarea "antes"
+    void agregarDependencia(int antes, int despues);
+
+    void vaciar();
+
+    [[nodiscard]] inline std::size_t numTareas() const { return tareas.size(); }
+
+    // Ejecuta todas las tareas respetando las dependencias (el hilo que llama tambien trabaja) y espera al final
+    void ejecutar();
+
+private:
+    std::vector<std::function<void()>> tareas;
+    std::vector<std::vector<int>> sucesores;
+    std::vector<int> numDependencias;
+    std::vector<int> pendientes; // Dependencias sin terminar de cada tarea en la ejecucion actual
+
+    std::mutex mutex;
+    std::condition_variable hayTrabajo;
+    std::deque<int> listas; // Tareas con todas sus dependencias terminadas
+    std::size_t restantes{0};
+    bool terminar{false};
+    std::vector<std::thread> hilos;
+
+    void trabajar(bool esperarFin);
+
+    void completar(int tarea);
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_TAREAS_HPP
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "telemetria.hpp"
+
+namespace {
+    constexpr const char *prefijoSocket = "unix:";
+    constexpr int permisosFichero = 0644;
+
+    // Conecta con un socket UNIX de tipo stream que ya esta escuchando (devuelve -1 si no se puede)
+    int conectarSocket(const std::string &ruta) {
+        sockaddr_un direccion{};
+        if (ruta.size() >= sizeof(direccion.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        direccion.sun_family = AF_UNIX;
+        std::ranges::copy(ruta, std::begin(direccion.sun_path));
+        const int descriptor = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (descriptor >= 0 &&
+            ::connect(descriptor, reinterpret_cast<const sockaddr *>(&direccion), sizeof(direccion)) != 0) {
+            ::close(descriptor);
+            return -1;
+        }
+        return descriptor;
+    }
+}
+
+
+Telemetria::Telemetria(const Argumentos &argumentos, int rango)
+        : intervalo(argumentos.opciones.intervaloTelemetria), rango(rango),
+          iteracionesObjetivo(argumentos.iteraciones), tiempoObjetivo(argumentos.opciones.tiempoObjetivo) {
+    if (intervalo > 0 && argumentos.opciones.descriptorTelemetria >= 0) {
+        descriptor = argumentos.opciones.descriptorTelemetria;
+        esSocket = true;
+    } else if (intervalo > 0) {
+        abrir(argumentos.opciones.destinoTelemetria);
+    }
+}
+
+
+Telemetria::~Telemetria() {
+    // Una linea a medias se termina aunque haya que esperar (la simulacion ya ha acabado), asi no se corta el flujo
+    while (descriptor >= 0 && !pendiente.empty()) {
+        escribirPendiente(true);
+    }
+    if (descartadas > 0) {
+        std::cerr << "Telemetry: dropped " << descartadas << " samples because the output was full\n";
+    }
+    if (propio) {
+        ::close(descriptor);
+    }
+}
+
+
+void Telemetria::abrir(const std::string &destino) {
+    if (destino.empty() || destino == "stderr") {
+        descriptor = STDERR_FILENO;
+        return;
+    }
+    esSocket = destino.starts_with(prefijoSocket);
+    descriptor = esSocket ? conectarSocket(destino.substr(std::strlen(prefijoSocket)))
+                          : ::open(destino.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, permisosFichero);
+    propio = descriptor >= 0;
+    if (!propio) {
+        std::cerr << "Error: Cannot open " << destino << " for telemetry: " << std::strerror(errno) << "\n";
+    }
+}
+
+
+// Funcion que escribe la linea de una muestra sin esperar a que el destino tenga sitio: si aun no se ha podido
+// terminar la anterior o no entra nada de la nueva, la muestra se descarta y se cuenta. Una linea cabe en una unica
+// escritura si hay sitio (asi las lineas de varios rangos no se mezclan); si solo entra una parte, el resto se
+// escribe antes que la siguiente muestra
+void Telemetria::emitir(const std::vector<Block> &blocks, const Grid &malla, int iteraciones, double tiempo) {
+    if (!pendiente.empty() && !escribirPendiente(false)) {
+        ++descartadas;
+        return;
+    }
+    pendiente = linea(blocks, malla, iteraciones, tiempo);
+    const std::size_t longitud = pendiente.size();
+    if (!escribirPendiente(false) && pendiente.size() == longitud) {
+        pendiente.clear();
+        ++descartadas;
+    }
+}
+
+
+// Funcion que escribe lo pendiente (sin esperar, salvo que se pida) y devuelve si se ha escrito todo. Si el destino
+// falla, desactiva la telemetria
+bool Telemetria::escribirPendiente(bool esperar) {
+    pollfd espera{descriptor, POLLOUT, 0};
+    if (!esperar && ::poll(&espera, 1, 0) == 0) { // Sin sitio (con los ficheros siempre hay)
+        return false;
+    }
+    const int banderas = esperar ? MSG_NOSIGNAL : MSG_NOSIGNAL | MSG_DONTWAIT;
+    const ssize_t escritos = esSocket ? ::send(descriptor, pendiente.data(), pendiente.size(), banderas)
+                                      : ::write(descriptor, pendiente.data(), pendiente.size());
+    if (escritos < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return false;
+    }
+    if (escritos < 0) {
+        std::cerr << "Error: telemetry output failed, telemetry disabled\n";
+        if (propio) {
+            ::close(descriptor);
+        }
+        descriptor = -1;
+        propio = false;
+        pendiente.clear();
+        return false;
+    }
+    pendiente.erase(0, static_cast<std::size_t>(escritos));
+    return pendiente.empty();
+}
+
+
+std::string Telemetria::linea(const std::vector<Block> &blocks, const Grid &malla, int iteraciones, double tiempo) {
+    const Reloj::time_point ahora = Reloj::now();
+    const double ventana = std::max(std::chrono::duration<double>(ahora - anterior).count(),
+                                    std::numeric_limits<double>::min());
+    const double iteracionesPorSegundo = (iteraciones - iteracionesAnteriores) / ventana;
+    const double tiempoPorSegundo = (tiempo - tiempoAnterior) / ventana;
+    std::size_t particulas = 0;
+    std::size_t maximoBloque = 0;
+    for (const Block &block: blocks) {
+        particulas += block.particles.size();
+        maximoBloque = std::max(maximoBloque, block.particles.size());
+    }
+    const auto pares = static_cast<double>(paresCandidatos(blocks, malla));
+    std::ostringstream salida;
+    salida << "{\"rank\": " << rango << ", \"iteration\": " << iteraciones << ", \"sim_time\": " << tiempo
+           << ", \"elapsed_s\": " << std::chrono::duration<double>(ahora - inicio).count()
+           << ", \"iterations_per_s\": " << iteracionesPorSegundo
+           << ", \"particles_per_s\": " << static_cast<double>(particulas) * iteracionesPorSegundo
+           << ", \"pairs_per_s\": " << pares * iteracionesPorSegundo << ", \"particles\": " << particulas
+           << ", \"peak_particles_per_block\": " << maximoBloque << ", \"eta_s\": "
+           << estimarRestante(iteracionesPorSegundo, tiempoPorSegundo, iteraciones, tiempo) << "}\n";
+    anterior = ahora;
+    iteracionesAnteriores = iteraciones;
+    tiempoAnterior = tiempo;
+    return salida.str();
+}
+
+
+// Funcion que estima los segundos hasta terminar al ritmo de la ultima ventana (con paso adaptativo, lo primero
+// que se alcance: el tiempo objetivo o el limite de pasos)
+double Telemetria::estimarRestante(double iteracionesPorSegundo, double tiempoPorSegundo, int iteraciones,
+                                   double tiempo) const {
+    double restante = std::numeric_limits<double>::max();
+    if (iteracionesObjetivo > 0 && iteracionesPorSegundo > 0.0) {
+        restante = (iteracionesObjetivo - iteraciones) / iteracionesPorSegundo;
+    }
+    if (tiempoObjetivo > 0.0 && tiempoPorSegundo > 0.0) {
+        restante = std::min(restante, (tiempoObjetivo - tiempo) / tiempoPorSegundo);
+    }
+    return restante == std::numeric_limits<double>::max() ? 0.0 : std::max(restante, 0.0);
+}
+
+
+long paresCandidatos(const std::vector<Block> &blocks, const Grid &malla) {
+    long productos = 0; // Cada par de bloques vecinos distintos cuenta dos veces, y cada bloque consigo mismo una
+    long particulas = 0;
+    for (const Block &block: blocks) {
+        long vecinas = 0;
+        malla.paraCadaVecino(block, [&](int indice) {
+            vecinas += static_cast<long>(blocks[indice].particles.size());
+        });
+        productos += static_cast<long>(block.particles.size()) * vecinas;
+        particulas += static_cast<long>(block.particles.size());
+    }
+    return (productos - particulas) / 2;
+}
@@ -0,0 +1,75 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_TELEMETRIA_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_TELEMETRIA_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "sim/grid.hpp"
+#include "sim/progargs.hpp"
+
+// Telemetria de progreso (--telemetry=N): cada N iteraciones escribe una linea JSON con el ritmo de iteraciones,
+// particulas y pares por segundo desde la muestra anterior, el maximo de particulas por bloque y el tiempo estimado
+// hasta terminar. El destino (--telemetry-out) es la salida de errores, un fichero (se añade al final, asi los
+// rangos pueden compartirlo) o un socket UNIX ("unix:ruta"). Entre muestras solo cuesta una comparacion. Nunca espera
+// a que el destino tenga sitio: las muestras que no entran se descartan (se cuentan y se informa al terminar), y si
+// el destino falla se desactiva sin detener la simulacion
+class Telemetria {
+public:
+    Telemetria(const Argumentos &argumentos, int rango);
+
+    ~Telemetria();
+
+    Telemetria(const Telemetria &) = delete;
+
+    Telemetria &operator=(const Telemetria &) = delete;
+
+    Telemetria(Telemetria &&) = delete;
+
+    Telemetria &operator=(Telemetria &&) = delete;
+
+    // Se llama tras cada iteracion con el numero de iteraciones hechas y el tiempo simulado
+    void muestrear(const std::vector<Block> &blocks, const Grid &malla, int iteraciones, double tiempo) {
+        if (descriptor >= 0 && iteraciones % intervalo == 0) {
+            emitir(blocks, malla, iteraciones, tiempo);
+        }
+    }
+
+    // Muestras descartadas porque el destino estaba lleno
+    [[nodiscard]] inline long getDescartadas() const { return descartadas; }
+
+    // Linea JSON de una muestra (sin enviarla), para las pruebas
+    [[nodiscard]] std::string linea(const std::vector<Block> &blocks, const Grid &malla, int iteraciones,
+                                    double tiempo);
+
+private:
+    using Reloj = std::chrono::steady_clock;
+
+    int intervalo;
+    int rango;
+    int iteracionesObjetivo; // 0 = sin limite (con paso adaptativo)
+    double tiempoObjetivo; // 0 = paso fijo
+    int descriptor{-1}; // -1 = desactivada
+    bool propio{false}; // El descriptor se cierra al terminar
+    bool esSocket{false};
+    Reloj::time_point inicio{Reloj::now()};
+    Reloj::time_point anterior{inicio};
+    int iteracionesAnteriores{0};
+    double tiempoAnterior{0.0};
+    std::string pendiente; // Lo que falta por escribir de la ultima linea
+    long descartadas{0};
+
+    void abrir(const std::string &destino);
+
+    void emitir(const std::vector<Block> &blocks, const Grid &malla, int iteraciones, double tiempo);
+
+    bool escribirPendiente(bool esperar);
+
+    [[nodiscard]] double estimarRestante(double iteracionesPorSegundo, double tiempoPorSegundo, int iteraciones,
+                                         double tiempo) const;
+};
+
+// Pares de particulas que comprueban las etapas con vecinos en una iteracion (cada par de bloques vecinos, una vez)
+long paresCandidatos(const std::vector<Block> &blocks, const Grid &malla);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_TELEMETRIA_HPP
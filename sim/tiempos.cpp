@@ -0,0 +1,96 @@
+#include <algorithm>
+#include "tiempos.hpp"
+#include "sim/asignador.hpp"
+
+namespace {
+    constexpr int cifrasSegundos = 9; // Cifras significativas de los tiempos
+
+    // Nombres de las etapas en el JSON, en el orden de "Etapa"
+    constexpr std::array<const char *, TiemposEtapas::numEtapas> nombres = {
+            "reposition", "densities", "transform", "accelerations", "interactions", "collisions", "movement",
+            "limits", "task-graph", "total"};
+}
+
+
+const char *nombreEtapa(Etapa etapa) {
+    return nombres[static_cast<std::size_t>(etapa)];
+}
+
+
+void TiemposEtapas::reiniciar(bool activar, bool contarMemoria) {
+    activo = activar || contarMemoria;
+    memoriaActiva = contarMemoria;
+    segundos.fill(0.0);
+    llamadas.fill(0);
+    memoria.fill({});
+    numAbiertas = 0;
+    ContadorMemoria::activar(contarMemoria);
+}
+
+
+// Funcion que guarda los contadores al empezar una etapa. El pico de la etapa que la contiene hasta ahora se guarda
+// en ella, porque el maximo se reinicia
+void TiemposEtapas::empezarMemoria() {
+    const long pico = ContadorMemoria::tomarPico();
+    if (numAbiertas > 0) {
+        abiertas[numAbiertas - 1].pico = std::max(abiertas[numAbiertas - 1].pico, pico);
+    }
+    abiertas[numAbiertas++] = {ContadorMemoria::leer(), ContadorMemoria::bytesVivos()};
+}
+
+
+void TiemposEtapas::terminarMemoria(Etapa etapa) {
+    const EtapaAbierta &abierta = abiertas[--numAbiertas];
+    const long pico = std::max(ContadorMemoria::tomarPico(), abierta.pico);
+    const ContadorMemoria::Recuento fin = ContadorMemoria::leer();
+    MemoriaEtapa &total = memoria[static_cast<std::size_t>(etapa)];
+    const long reservas = fin.reservas - abierta.inicio.reservas;
+    if (llamadas[static_cast<std::size_t>(etapa)] == 0) {
+        total.reservasPrimera = reservas;
+    }
+    total.recuento.reservas += reservas;
+    total.recuento.liberaciones += fin.liberaciones - abierta.inicio.liberaciones;
+    total.recuento.bytesReservados += fin.bytesReservados - abierta.inicio.bytesReservados;
+    total.recuento.bytesLiberados += fin.bytesLiberados - abierta.inicio.bytesLiberados;
+    total.picoVivos = std::max(total.picoVivos, pico);
+    total.rssMaximoKb = std::max(total.rssMaximoKb, ContadorMemoria::rssMaximoKb());
+    if (numAbiertas > 0) {
+        abiertas[numAbiertas - 1].pico = std::max(abiertas[numAbiertas - 1].pico, pico);
+    }
+}
+
+
+void TiemposEtapas::escribirJson(std::ostream &salida, int iteraciones) const {
+    const auto precision = salida.precision(cifrasSegundos);
+    salida << "{\"iterations\": " << iteraciones;
+    for (std::size_t etapa = 0; etapa < numEtapas; ++etapa) {
+        if (llamadas[etapa] > 0) {
+            salida << ", \"" << nombres[etapa] << "\": " << segundos[etapa];
+        }
+    }
+    salida << "}\n";
+    salida.precision(precision);
+}
+
+
+void TiemposEtapas::escribirJsonMemoria(std::ostream &salida, int iteraciones) const {
+    const PoolParticulas::Huella huella = PoolParticulas::huella();
+    salida << "{\"iterations\": " << iteraciones << ", \"rss_hwm_kb\": " << ContadorMemoria::rssMaximoKb()
+           << ", \"particle_bytes_in_use\": " << huella.bytesEnUso
+           << ", \"particle_pool_bytes\": " << huella.bytesSistema;
+    for (std::size_t etapa = 0; etapa < numEtapas; ++etapa) {
+        if (llamadas[etapa] == 0) {
+            continue;
+        }
+        const MemoriaEtapa &datos = memoria[etapa];
+        salida << ", \"" << nombres[etapa] << "\": {\"allocations\": " << datos.recuento.reservas;
+        if (etapa != static_cast<std::size_t>(Etapa::total)) { // El total se mide una sola vez
+            salida << ", \"allocations_after_first_call\": " << datos.recuento.reservas - datos.reservasPrimera;
+        }
+        salida << ", \"frees\": " << datos.recuento.liberaciones
+               << ", \"bytes_allocated\": " << datos.recuento.bytesReservados
+               << ", \"bytes_freed\": " << datos.recuento.bytesLiberados
+               << ", \"peak_live_bytes\": " << datos.picoVivos << ", \"rss_hwm_kb\": " << datos.rssMaximoKb << "}";
+    }
+    salida << "}\n";
+}
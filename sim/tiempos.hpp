@@ -0,0 +1,97 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_TIEMPOS_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_TIEMPOS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include "sim/memoria.hpp"
+#include "sim/traza.hpp"
+
+// Etapas que se miden por separado. Los motores paralelos miden juntas las que ejecutan juntas: "interacciones"
+// (densidades, transformacion y aceleraciones con --threads o con el nucleo rapido), "movimiento" (con --threads
+// tambien colisiones y limites) y "grafo" (todo lo que ejecuta el grafo de tareas)
+enum class Etapa {
+    reposicion, densidades, transformacion, aceleraciones, interacciones, colisiones, movimiento, limites, grafo, total
+};
+
+// Nombre de la etapa en los ficheros JSON
+const char *nombreEtapa(Etapa etapa);
+
+// Tiempo acumulado por etapa a lo largo de una simulacion (--stage-times) y, si se pide, la memoria que reserva y
+// libera cada etapa (--memory-stats, ver memoria.hpp). Con la traza activa (--trace) tambien anota cada llamada como
+// un intervalo. Sin activar, "medir" solo llama a la funcion, sin leer el reloj ni los contadores
+class TiemposEtapas {
+public:
+    static constexpr std::size_t numEtapas = static_cast<std::size_t>(Etapa::total) + 1;
+
+    // Activa (o desactiva) la medida y pone los tiempos y la memoria a cero
+    void reiniciar(bool activar, bool contarMemoria = false);
+
+    template <typename Funcion>
+    void medir(Etapa etapa, Funcion &&funcion) {
+        if (!activo) {
+            funcion();
+            return;
+        }
+        const auto inicio = std::chrono::steady_clock::now();
+        if (memoriaActiva) {
+            empezarMemoria();
+        }
+        funcion();
+        if (memoriaActiva) {
+            terminarMemoria(etapa);
+        }
+        const auto fin = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> duracion = fin - inicio;
+        segundos[static_cast<std::size_t>(etapa)] += duracion.count();
+        ++llamadas[static_cast<std::size_t>(etapa)];
+        if (Traza::activa()) {
+            Traza::anotar({nombreEtapa(etapa), inicio, fin, nullptr, 0});
+        }
+    }
+
+    [[nodiscard]] double getSegundos(Etapa etapa) const { return segundos[static_cast<std::size_t>(etapa)]; }
+
+    [[nodiscard]] long getLlamadas(Etapa etapa) const { return llamadas[static_cast<std::size_t>(etapa)]; }
+
+    // Escribe un objeto JSON de un nivel con las iteraciones y los segundos de cada etapa medida
+    void escribirJson(std::ostream &salida, int iteraciones) const;
+
+    // Memoria de una etapa en todas sus llamadas (los picos son el maximo de todas ellas)
+    struct MemoriaEtapa {
+        ContadorMemoria::Recuento recuento;
+        long reservasPrimera; // Reservas de la primera llamada (las demas indican si hay regimen sin reservas)
+        long picoVivos;
+        long rssMaximoKb;
+    };
+
+    [[nodiscard]] const MemoriaEtapa &getMemoria(Etapa etapa) const {
+        return memoria[static_cast<std::size_t>(etapa)];
+    }
+
+    // Escribe un objeto JSON con las iteraciones, el maximo de memoria residente y un objeto por etapa medida
+    void escribirJsonMemoria(std::ostream &salida, int iteraciones) const;
+
+private:
+    // Etapa en curso: contadores al empezar y pico de las etapas que contiene (las etapas se anidan en "total")
+    struct EtapaAbierta {
+        ContadorMemoria::Recuento inicio;
+        long pico;
+    };
+
+    std::array<double, numEtapas> segundos{};
+    std::array<long, numEtapas> llamadas{};
+    std::array<MemoriaEtapa, numEtapas> memoria{};
+    std::array<EtapaAbierta, numEtapas> abiertas{}; // Sin reservas, para no contarse a si misma
+    std::size_t numAbiertas{0};
+    bool activo{false};
+    bool memoriaActiva{false};
+
+    void empezarMemoria();
+
+    void terminarMemoria(Etapa etapa);
+};
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_TIEMPOS_HPP
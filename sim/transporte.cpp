@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "transporte.hpp"
+
+
+namespace {
+    // Cada mensaje va precedido de su longitud en bytes
+    using Cabecera = std::uint64_t;
+
+    // Estado de un envio o una recepcion en curso: los bytes de la cabecera y despues los del mensaje
+    struct Progreso {
+        std::array<std::byte, sizeof(Cabecera)> cabecera{};
+        std::size_t hechos{0};
+    };
+
+    [[noreturn]] void errorSocket(const char *operacion) {
+        throw std::runtime_error(std::string("Error: socket ") + operacion + " failed: " + std::strerror(errno));
+    }
+
+    // Envia los bytes pendientes que quepan sin bloquear; devuelve true al terminar
+    bool avanzarEnvio(int descriptor, Progreso &progreso, std::span<const std::byte> salida) {
+        const bool enCabecera = progreso.hechos < sizeof(Cabecera);
+        const std::byte *datos = enCabecera ? progreso.cabecera.data() + progreso.hechos
+                                            : salida.data() + (progreso.hechos - sizeof(Cabecera));
+        const std::size_t pendientes = enCabecera ? sizeof(Cabecera) - progreso.hechos
+                                                  : salida.size() - (progreso.hechos - sizeof(Cabecera));
+        const ssize_t enviados = ::send(descriptor, datos, pendientes, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (enviados < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            errorSocket("send");
+        }
+        progreso.hechos += static_cast<std::size_t>(std::max<ssize_t>(enviados, 0));
+        return progreso.hechos == sizeof(Cabecera) + salida.size();
+    }
+
+    // Recibe los bytes disponibles sin bloquear; devuelve true al terminar (la cabecera dice el tamaño del mensaje)
+    bool avanzarRecepcion(int descriptor, Progreso &progreso, std::vector<std::byte> &entrada) {
+        const bool enCabecera = progreso.hechos < sizeof(Cabecera);
+        std::byte *datos = enCabecera ? progreso.cabecera.data() + progreso.hechos
+                                      : entrada.data() + (progreso.hechos - sizeof(Cabecera));
+        const std::size_t pendientes = enCabecera ? sizeof(Cabecera) - progreso.hechos
+                                                  : entrada.size() - (progreso.hechos - sizeof(Cabecera));
+        const ssize_t recibidos = ::recv(descriptor, datos, pendientes, MSG_DONTWAIT);
+        if (recibidos == 0 || (recibidos < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            errorSocket("recv");
+        }
+        progreso.hechos += static_cast<std::size_t>(std::max<ssize_t>(recibidos, 0));
+        if (progreso.hechos == sizeof(Cabecera) && enCabecera) {
+            Cabecera longitud = 0;
+            std::memcpy(&longitud, progreso.cabecera.data(), sizeof(Cabecera));
+            entrada.resize(longitud);
+        }
+        return progreso.hechos >= sizeof(Cabecera) && progreso.hechos == sizeof(Cabecera) + entrada.size();
+    }
+}
+
+
+TransporteSocket::TransporteSocket(int rango, std::vector<int> descriptores)
+        : rangoPropio(rango), descriptores(std::move(descriptores)) {}
+
+
+TransporteSocket::~TransporteSocket() {
+    for (const int descriptor: descriptores) {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+}
+
+
+// Funcion que avanza a la vez el envio y la recepcion, esperando con poll a que alguno de los dos pueda seguir
+void TransporteSocket::intercambiar(int destino, std::span<const std::byte> salida, int origen,
+                                    std::vector<std::byte> &entrada) {
+    Progreso envio;
+    Progreso recepcion;
+    const Cabecera longitud = salida.size();
+    std::memcpy(envio.cabecera.data(), &longitud, sizeof(Cabecera));
+    entrada.clear();
+    bool enviado = destino < 0;
+    bool recibido = origen < 0;
+    while (!enviado || !recibido) {
+        // poll ignora las entradas con descriptor negativo
+        std::array<pollfd, 2> esperas{pollfd{enviado ? -1 : descriptores[destino], POLLOUT, 0},
+                                      pollfd{recibido ? -1 : descriptores[origen], POLLIN, 0}};
+        if (::poll(esperas.data(), esperas.size(), -1) < 0 && errno != EINTR) {
+            errorSocket("poll");
+        }
+        enviado = enviado || avanzarEnvio(descriptores[destino], envio, salida);
+        recibido = recibido || avanzarRecepcion(descriptores[origen], recepcion, entrada);
+    }
+}
+
+
+// Funcion que crea un socketpair por cada pareja de rangos y reparte sus extremos
+std::vector<std::unique_ptr<TransporteSocket>> crearTransportesLocales(int numRangos) {
+    const auto total = static_cast<std::size_t>(numRangos);
+    std::vector<std::vector<int>> descriptores(total, std::vector<int>(total, -1));
+    for (std::size_t i = 0; i < total; ++i) {
+        for (std::size_t j = i + 1; j < total; ++j) {
+            std::array<int, 2> par{};
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, par.data()) < 0) {
+                errorSocket("socketpair");
+            }
+            descriptores[i][j] = par[0];
+            descriptores[j][i] = par[1];
+        }
+    }
+    std::vector<std::unique_ptr<TransporteSocket>> transportes;
+    for (std::size_t i = 0; i < total; ++i) {
+        transportes.push_back(std::make_unique<TransporteSocket>(static_cast<int>(i), std::move(descriptores[i])));
+    }
+    return transportes;
+}
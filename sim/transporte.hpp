@@ -0,0 +1,62 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_TRANSPORTE_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_TRANSPORTE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+
+// Canal de comunicacion entre los procesos (rangos) de la simulacion distribuida. Se puede implementar sobre
+// cualquier red; la simulacion solo necesita intercambios punto a punto
+class Transporte {
+public:
+    Transporte() = default;
+    Transporte(const Transporte &) = delete;
+    Transporte &operator=(const Transporte &) = delete;
+    Transporte(Transporte &&) = delete;
+    Transporte &operator=(Transporte &&) = delete;
+    virtual ~Transporte() = default;
+
+    [[nodiscard]] virtual int rango() const = 0;
+
+    [[nodiscard]] virtual int numRangos() const = 0;
+
+    // Envia "salida" al rango "destino" y, a la vez, recibe en "entrada" el mensaje del rango "origen". Como envio y
+    // recepcion avanzan juntos, no se bloquea aunque los dos extremos envien mensajes grandes al mismo tiempo.
+    // Con destino -1 solo se recibe y con origen -1 solo se envia
+    virtual void intercambiar(int destino, std::span<const std::byte> salida, int origen,
+                              std::vector<std::byte> &entrada) = 0;
+};
+
+
+// Transporte local: un socket UNIX (socketpair) por cada pareja de rangos. Sirve tanto para procesos creados con
+// fork como para hilos del mismo proceso (en los tests)
+class TransporteSocket final : public Transporte {
+public:
+    // descriptores[i] es el socket conectado con el rango i (-1 en la posicion del propio rango)
+    TransporteSocket(int rango, std::vector<int> descriptores);
+
+    TransporteSocket(const TransporteSocket &) = delete;
+    TransporteSocket &operator=(const TransporteSocket &) = delete;
+    TransporteSocket(TransporteSocket &&) = delete;
+    TransporteSocket &operator=(TransporteSocket &&) = delete;
+    ~TransporteSocket() override;
+
+    [[nodiscard]] int rango() const override { return rangoPropio; }
+
+    [[nodiscard]] int numRangos() const override { return static_cast<int>(descriptores.size()); }
+
+    void intercambiar(int destino, std::span<const std::byte> salida, int origen,
+                      std::vector<std::byte> &entrada) override;
+
+private:
+    int rangoPropio;
+    std::vector<int> descriptores;
+};
+
+// Crea los transportes de "numRangos" rangos conectados entre si (el de la posicion i es el del rango i)
+std::vector<std::unique_ptr<TransporteSocket>> crearTransportesLocales(int numRangos);
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_TRANSPORTE_HPP
@@ -0,0 +1,111 @@
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+#include "traza.hpp"
+
+namespace {
+    constexpr std::size_t eventosIniciales = 4096; // Por hilo, para no reservar en las primeras iteraciones
+    constexpr int decimalesMicrosegundos = 3;
+
+    struct BufferHilo {
+        std::vector<Traza::Evento> eventos;
+    };
+
+    std::atomic<bool> trazando{false};
+    std::mutex mutexBuffers; // Solo protege la lista de buffers, no su contenido
+    std::vector<std::unique_ptr<BufferHilo>> buffers; // No se liberan: los hilos que terminan dejan sus eventos
+    Traza::Reloj::time_point origen;
+    thread_local BufferHilo *propio = nullptr;
+
+    // Buffer del hilo que llama (lo registra la primera vez)
+    BufferHilo &bufferPropio() {
+        if (propio == nullptr) {
+            auto nuevo = std::make_unique<BufferHilo>();
+            nuevo->eventos.reserve(eventosIniciales);
+            const std::scoped_lock bloqueo(mutexBuffers);
+            propio = buffers.emplace_back(std::move(nuevo)).get();
+        }
+        return *propio;
+    }
+
+    double microsegundos(Traza::Reloj::duration duracion) {
+        return std::chrono::duration<double, std::micro>(duracion).count();
+    }
+
+    void escribirEvento(std::ostream &salida, const Traza::Evento &evento, std::size_t hilo) {
+        salida << ",\n{\"name\": \"" << evento.nombre << "\", \"ph\": \"X\", \"pid\": " << ::getpid()
+               << ", \"tid\": " << hilo << ", \"ts\": " << microsegundos(evento.inicio - origen)
+               << ", \"dur\": " << microsegundos(evento.fin - evento.inicio);
+        if (evento.clave != nullptr) {
+            salida << ", \"args\": {\"" << evento.clave << "\": " << evento.valor << "}";
+        }
+        salida << "}";
+    }
+}
+
+
+namespace Traza {
+    void activar(bool trazar) {
+        if (trazar) {
+            const std::scoped_lock bloqueo(mutexBuffers);
+            for (const auto &buffer: buffers) {
+                buffer->eventos.clear();
+            }
+            origen = Reloj::now();
+        }
+        trazando.store(trazar, std::memory_order_release);
+    }
+
+    bool activa() {
+        return trazando.load(std::memory_order_relaxed);
+    }
+
+    void anotar(const Evento &evento) {
+        bufferPropio().eventos.push_back(evento);
+    }
+
+    std::size_t numEventos() {
+        const std::scoped_lock bloqueo(mutexBuffers);
+        std::size_t total = 0;
+        for (const auto &buffer: buffers) {
+            total += buffer->eventos.size();
+        }
+        return total;
+    }
+
+    void escribirJson(std::ostream &salida) {
+        const std::scoped_lock bloqueo(mutexBuffers);
+        const auto formato = salida.flags();
+        const auto precision = salida.precision(decimalesMicrosegundos);
+        salida << std::fixed << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n{\"name\": \"process_name\", "
+               << "\"ph\": \"M\", \"pid\": " << ::getpid() << ", \"args\": {\"name\": \"fluid\"}}";
+        for (std::size_t hilo = 0; hilo < buffers.size(); ++hilo) {
+            salida << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << ::getpid() << ", \"tid\": " << hilo
+                   << ", \"args\": {\"name\": \"thread " << hilo << "\"}}";
+            for (const Evento &evento: buffers[hilo]->eventos) {
+                escribirEvento(salida, evento, hilo);
+            }
+        }
+        salida << "\n]}\n";
+        salida.flags(formato);
+        salida.precision(precision);
+    }
+
+
+    Ambito::Ambito(const char *nombre, const char *clave, long valor)
+            : evento{nombre, {}, {}, clave, valor}, activo(activa()) {
+        if (activo) {
+            evento.inicio = Reloj::now();
+        }
+    }
+
+    Ambito::~Ambito() {
+        if (activo) {
+            evento.fin = Reloj::now();
+            Traza::anotar(evento);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PROYECTO_RENDIMIENTO_ARQUITECTURA_TRAZA_HPP
+#define PROYECTO_RENDIMIENTO_ARQUITECTURA_TRAZA_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+// Traza de la ejecucion (--trace=fichero.json): intervalos de cada iteracion, de cada etapa medida y de cada trozo
+// o tarea que ejecutan los hilos de los motores paralelos, en el formato de eventos de Chrome (se abre con Perfetto o
+// chrome://tracing). Cada hilo anota en su propio buffer, sin cerrojos ni atomicos: solo se toma un cerrojo la
+// primera vez que un hilo anota, para registrar su buffer. Sin activar, cada intervalo solo lee un booleano
+namespace Traza {
+    using Reloj = std::chrono::steady_clock;
+
+    // Intervalo con un argumento opcional ("clave" nullptr = sin argumento). Los nombres deben ser constantes
+    struct Evento {
+        const char *nombre;
+        Reloj::time_point inicio;
+        Reloj::time_point fin;
+        const char *clave;
+        long valor;
+    };
+
+    // Empieza o deja de trazar. Al empezar se vacian los buffers y los tiempos se cuentan desde ese momento; solo
+    // se puede llamar cuando ningun otro hilo esta anotando (entre simulaciones)
+    void activar(bool trazar);
+
+    [[nodiscard]] bool activa();
+
+    // Anota el intervalo en el buffer del hilo que llama
+    void anotar(const Evento &evento);
+
+    // Eventos anotados por todos los hilos desde que se activo la traza
+    [[nodiscard]] std::size_t numEventos();
+
+    // Escribe la traza en formato JSON de Chrome, con un hilo de la traza por buffer
+    void escribirJson(std::ostream &salida);
+
+    // Anota el intervalo desde su creacion hasta su destruccion (si la traza esta activa al crearlo)
+    class Ambito {
+    public:
+        explicit Ambito(const char *nombre, const char *clave = nullptr, long valor = 0);
+
+        Ambito(const Ambito &) = delete;
+        Ambito &operator=(const Ambito &) = delete;
+        Ambito(Ambito &&) = delete;
+        Ambito &operator=(Ambito &&) = delete;
+
+        ~Ambito();
+
+    private:
+        Evento evento;
+        bool activo; // La traza estaba activa al crearlo
+    };
+}
+
+
+#endif //PROYECTO_RENDIMIENTO_ARQUITECTURA_TRAZA_HPP
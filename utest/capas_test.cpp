@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "sim/capas.hpp"
+#include "sim/simulacion.hpp"
+//constantes para evitar avisos clang-tidy por magic number
+const int subdivision_2_value = 2;
+
+namespace {
+    std::string leerSalida(const std::string &nombre) {
+        std::ifstream fichero(nombre, std::ios::binary);
+        return {std::istreambuf_iterator<char>(fichero), std::istreambuf_iterator<char>()};
+    }
+
+    // Simula 5 iteraciones de small.fld en memoria y por capas con las mismas opciones y devuelve ambas salidas
+    std::pair<std::string, std::string> simularAmbas(Opciones opciones) {
+        const std::vector<std::string> arguments = {"5", "small.fld", "memoria.fld"};
+        Argumentos argumentos;
+        argumentos.opciones = opciones;
+        comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+        Grid malla(Constantes::limInferior, Constantes::limSuperior);
+        malla.setSubdivision(opciones.subdivision);
+        auto result = malla.simular_malla(argumentos.fluid);
+        std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+        comprobarArgsSalida(arguments, argumentos, blocks);
+
+        opciones.directorioCapas = std::filesystem::temp_directory_path().string();
+        opciones.hilos = 0; // Por capas no hay hilos: da el resultado de las versiones "gather" en serie
+        const std::vector<std::string> argumentsCapas = {"5", "small.fld", "capas.fld"};
+        Argumentos argumentosCapas;
+        argumentosCapas.opciones = opciones;
+        comprobarArgsEntrada(static_cast<int>(argumentsCapas.size()) + 1, argumentsCapas, argumentosCapas);
+        EXPECT_EQ(Constantes::ErrorCode::NO_ERROR, ejecutarPorCapas(argumentosCapas));
+        std::pair<std::string, std::string> salidas{leerSalida("memoria.fld"), leerSalida("capas.fld")};
+        std::remove("memoria.fld");
+        std::remove("capas.fld");
+        return salidas;
+    }
+}
+
+//test para comprobar que por capas el resultado es identico al de las versiones "gather" en memoria
+TEST(CapasTests, IdenticoGatherEnMemoria) {
+    for (const int subdivision: {1, subdivision_2_value}) {
+        Opciones opciones;
+        opciones.hilos = 1;
+        opciones.subdivision = subdivision;
+        const auto [memoria, capas] = simularAmbas(opciones);
+        ASSERT_FALSE(memoria.empty());
+        ASSERT_EQ(memoria, capas);
+    }
+}
+
+//test para comprobar que por capas y con "determinista" el resultado es identico al de la version en serie
+TEST(CapasTests, DeterministaIdenticoSecuencial) {
+    Opciones opciones;
+    opciones.determinista = true;
+    const auto [memoria, capas] = simularAmbas(opciones);
+    ASSERT_FALSE(memoria.empty());
+    ASSERT_EQ(memoria, capas);
+}
+
+//test para comprobar que por capas una opcion que no se tiene da error en vez de ignorarse
+TEST(CapasTests, OpcionNoAdmitida) {
+    const std::vector<std::string> arguments = {"5", "small.fld", "capas.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.opciones.directorioCapas = std::filesystem::temp_directory_path().string();
+    argumentos.opciones.ficheroTiempos = "tiempos.json";
+    ASSERT_EQ(Constantes::ErrorCode::INVALID_ARGUMENTS, ejecutarPorCapas(argumentos));
+    ASSERT_FALSE(std::filesystem::exists("capas.fld"));
+    ASSERT_FALSE(std::filesystem::exists("tiempos.json"));
+    argumentos.opciones.ficheroTiempos.clear();
+    argumentos.opciones.rangos = 2;
+    ASSERT_EQ(Constantes::ErrorCode::INVALID_ARGUMENTS, ejecutarPorCapas(argumentos));
+    ASSERT_FALSE(std::filesystem::exists("capas.fld"));
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "sim/distribuido.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int num_rangos = 3;
+const int num_iteraciones = 3;
+const std::size_t tam_mensaje = 1 << 20;
+
+// Ejecuta unas iteraciones de small.fld como el rango dado y devuelve las particulas que reune
+std::vector<Block> simularRangoSmall(Transporte &transporte, int rangos) {
+    const std::vector<std::string> arguments = {"3", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.iteraciones = num_iteraciones;
+    argumentos.opciones.rangos = rangos;
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    const std::size_t numBloques = malla.getBlocks().size();
+    std::vector<Block> reunidas = simularRango(malla, argumentos, calcularParametros(result.first, result.second),
+                                               transporte);
+    // Al terminar la malla vuelve a estar entera (el rango solo ha usado una ventana con sus capas)
+    EXPECT_EQ(numBloques, malla.getBlocks().size());
+    EXPECT_EQ(numBloques - 1, malla.indiceBloque(static_cast<int>(malla.getNumberblocksx()) - 1,
+                                                 static_cast<int>(malla.getNumberblocksy()) - 1,
+                                                 static_cast<int>(malla.getNumberblocksz()) - 1));
+    return reunidas;
+}
+
+// Pasa las particulas de los bloques a un vector en el orden de sus ids
+std::vector<Particle> porId(const std::vector<Block> &blocks) {
+    std::size_t total = 0;
+    for (const auto &block: blocks) {
+        total += block.particles.size();
+    }
+    std::vector<Particle> particulas(total);
+    for (const auto &block: blocks) {
+        for (const auto &particle: block.particles) {
+            particulas[particle.id] = particle;
+        }
+    }
+    return particulas;
+}
+
+//test para comprobar que un intercambio grande en ambos sentidos a la vez no se bloquea
+TEST(DistribuidoTests, IntercambioSimultaneo) {
+    auto transportes = crearTransportesLocales(2);
+    std::vector<std::byte> recibido0;
+    std::vector<std::byte> recibido1;
+    const std::vector<std::byte> mensaje0(tam_mensaje, std::byte{1});
+    const std::vector<std::byte> mensaje1(tam_mensaje + 1, std::byte{2});
+    std::thread otro([&] { transportes[1]->intercambiar(0, mensaje1, 0, recibido1); });
+    transportes[0]->intercambiar(1, mensaje0, 1, recibido0);
+    otro.join();
+    ASSERT_EQ(mensaje1, recibido0);
+    ASSERT_EQ(mensaje0, recibido1);
+}
+
+//test para comprobar que la simulacion repartida en rangos da el mismo resultado (salvo redondeo) que con uno solo
+TEST(DistribuidoTests, RangosIgualUnRango) {
+    auto transportes = crearTransportesLocales(num_rangos);
+    std::vector<std::thread> otros;
+    for (int rango = 1; rango < num_rangos; ++rango) {
+        otros.emplace_back([&, rango] { simularRangoSmall(*transportes[rango], num_rangos); });
+    }
+    const std::vector<Particle> repartido = porId(simularRangoSmall(*transportes[0], num_rangos));
+    for (auto &hilo: otros) {
+        hilo.join();
+    }
+    auto solo = crearTransportesLocales(1);
+    const std::vector<Particle> unRango = porId(simularRangoSmall(*solo[0], 1));
+    ASSERT_EQ(unRango.size(), repartido.size());
+    for (std::size_t i = 0; i < unRango.size(); ++i) {
+        ASSERT_NEAR(unRango[i].px, repartido[i].px, 1e-9);
+        ASSERT_NEAR(unRango[i].py, repartido[i].py, 1e-9);
+        ASSERT_NEAR(unRango[i].pz, repartido[i].pz, 1e-9);
+        ASSERT_NEAR(unRango[i].vx, repartido[i].vx, 1e-6);
+        ASSERT_NEAR(unRango[i].vy, repartido[i].vy, 1e-6);
+        ASSERT_NEAR(unRango[i].vz, repartido[i].vz, 1e-6);
+    }
+}
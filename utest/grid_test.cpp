@@ -1,3 +1,4 @@
+#include <cmath>
 #include <gtest/gtest.h>
 #include "sim/grid.hpp"
 //constantes para resolver errores clang-tidy
@@ -107,6 +108,8 @@ TEST(GridTests, repos_fluid_correcto) {
         ASSERT_EQ(1,blocks[i].particles.size());
         ASSERT_EQ(i,blocks[i].particles[0].id);
     }
+    //los bloques pasan a ser el unico almacen de particulas
+    ASSERT_TRUE(fluid.particles.empty());
 }
 
 //test para comprobar reposicionarParticulasFluid() con una particula fuera de la malla
@@ -254,4 +257,307 @@ TEST(GridTests, simular_malla){
     ASSERT_EQ(1.695,result.first);
     ASSERT_EQ(1000,result.second);
 
-}
\ No newline at end of file
+}
+
+//test para comprobar que ordenarParticulasBloques() agrupa las particulas por subcelda sin perder ninguna
+TEST(GridTests, ordenar_particulas_bloques) {
+    //creamos una malla de un unico bloque
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{1.0,1.0,1.0};
+    Grid grid(bmin, bmax);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    //las particulas 0 y 2 estan en la misma esquina del bloque, la 1 en la contraria
+    std::vector<Particle> particulas;
+    const Particle particle1={0, 0, 0.1, 0.1, 0.1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const Particle particle2={1, 0, 0.9, 0.9, 0.9, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const Particle particle3={2, 0, 0.1, 0.1, 0.1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    particulas.push_back(particle1);
+    particulas.push_back(particle2);
+    particulas.push_back(particle3);
+    Fluid fluid{1.0,3,particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    grid.ordenarParticulasBloques(blocks);
+    //las particulas cercanas quedan contiguas y, dentro de la misma subcelda, ordenadas por id
+    ASSERT_EQ(3,blocks[0].particles.size());
+    ASSERT_EQ(0,blocks[0].particles[0].id);
+    ASSERT_EQ(2,blocks[0].particles[1].id);
+    ASSERT_EQ(1,blocks[0].particles[2].id);
+}
+
+//test para comprobar que, tras calentar los buffers, reposicionarParticulasBloque() no reserva memoria nueva
+TEST(GridTests, repos_block_sin_reservas) {
+    //creamos una malla que tenga 2 bloques con una particula cada uno
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{2.0,1.0,1.0};
+    Grid grid(bmin, bmax);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    const Particle particle1={0, 0, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const Particle particle2{1, 0, 1.5, 0.0, 0.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0};
+    particulas.push_back(particle1);
+    particulas.push_back(particle2);
+    Fluid fluid{1.0,2,particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    //las dos primeras llamadas llenan los dos juegos de bloques
+    grid.reposicionarParticulasBloque(blocks);
+    grid.reposicionarParticulasBloque(blocks);
+    const std::size_t reservas = PoolParticulas::numReservasSistema();
+    //aunque las particulas cambien de bloque, la memoria ya reservada se reutiliza
+    blocks[0].particles[0].px=decimal5_value+1.0;
+    blocks[1].particles[0].px=decimal5_value;
+    for (int i = 0; i < 4; ++i) {
+        grid.reposicionarParticulasBloque(blocks);
+    }
+    ASSERT_EQ(reservas, PoolParticulas::numReservasSistema());
+    ASSERT_EQ(1,blocks[0].particles[0].id);
+    ASSERT_EQ(0,blocks[1].particles[0].id);
+}
+
+//test para comprobar que, con bloques de distinto tamaño que se intercambian sus particulas en cada iteracion,
+//reposicionarParticulasBloque() llega a un regimen sin reservas y cada bloque solo reserva sus particulas
+TEST(GridTests, repos_block_regimen_estacionario) {
+    //creamos una malla de 4 bloques en x en la que el bloque i tiene i + 1 particulas
+    const int num_bloques = 4;
+    const int iteraciones = 8;
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{num_bloques,1.0,1.0};
+    Grid grid(bmin, bmax);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    for (int i = 0; i < num_bloques; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            const auto id = static_cast<int>(particulas.size());
+            particulas.push_back(Particle{id, 0, i + decimal5_value, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+        }
+    }
+    Fluid fluid{1.0,static_cast<int>(particulas.size()),particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    std::size_t reservas = 0;
+    for (int iter = 0; iter < 2 + iteraciones; ++iter) {
+        //las dos primeras iteraciones calientan el pool, despues no se reserva nada
+        reservas = iter == 2 ? PoolParticulas::numReservasSistema() : reservas;
+        for (Block &block: blocks) {
+            for (Particle &particle: block.particles) {
+                particle.px = std::fmod(particle.px + 1.0, num_bloques);
+            }
+        }
+        grid.reposicionarParticulasBloque(blocks);
+    }
+    ASSERT_EQ(reservas, PoolParticulas::numReservasSistema());
+    //tras 10 desplazamientos cada bloque tiene las particulas de dos bloques antes
+    for (int i = 0; i < num_bloques; ++i) {
+        ASSERT_EQ((i + 2) % num_bloques + 1, blocks[i].particles.size());
+        ASSERT_EQ(blocks[i].particles.size(), blocks[i].particles.capacity());
+    }
+}
+
+//test para comprobar que, tras reposicionar (en serie y por bloques destino), el buffer no guarda particulas: solo
+//queda en uso un trozo del pool por cada bloque con particulas
+TEST(GridTests, repos_block_una_copia) {
+    const int num_bloques = 4;
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{num_bloques,1.0,1.0};
+    Grid grid(bmin, bmax);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    for (int i = 0; i < num_bloques; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            const auto id = static_cast<int>(particulas.size());
+            particulas.push_back(Particle{id, 0, i + decimal5_value, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+        }
+    }
+    Fluid fluid{1.0,static_cast<int>(particulas.size()),particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    const std::size_t trozos = PoolParticulas::huella().trozosEnUso;
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    ASSERT_EQ(trozos + num_bloques, PoolParticulas::huella().trozosEnUso);
+    grid.reposicionarParticulasBloque(blocks);
+    ASSERT_EQ(trozos + num_bloques, PoolParticulas::huella().trozosEnUso);
+    grid.prepararReposicion();
+    for (int i = 0; i < num_bloques; ++i) {
+        ASSERT_EQ(0, grid.anotarDestinos(blocks, i));
+    }
+    for (int i = 0; i < num_bloques; ++i) {
+        grid.recogerParticulas(blocks, i);
+    }
+    grid.terminarReposicion(blocks, false);
+    ASSERT_EQ(trozos + num_bloques, PoolParticulas::huella().trozosEnUso);
+    ASSERT_GE(PoolParticulas::huella().bytesSistema, PoolParticulas::huella().bytesEnUso);
+}
+
+//test para comprobar que la malla dispersa solo guarda los bloques con particulas, ordenados por id
+TEST(GridTests, malla_dispersa) {
+    //creamos una malla de 3x3x3 bloques con solo dos bloques ocupados
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{3.0,3.0,3.0};
+    Grid grid(bmin, bmax);
+    grid.setDisperso(true);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    ASSERT_EQ(0,grid.getBlocks().size());
+    std::vector<Particle> particulas;
+    const Particle particle1={0, 0, 2.5, 2.5, 2.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const Particle particle2={1, 0, 0.5, 0.5, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    particulas.push_back(particle1);
+    particulas.push_back(particle2);
+    Fluid fluid{1.0,2,particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    ASSERT_EQ(2,blocks.size());
+    ASSERT_EQ(0,blocks[0].id);
+    ASSERT_EQ(26,blocks[1].id);
+    ASSERT_EQ(1,grid.indiceBloque(2,2,2));
+    ASSERT_EQ(-1,grid.indiceBloque(1,1,1));
+    //movemos la particula 0 al bloque central y reposicionamos
+    blocks[1].particles[0].px=blocks[1].particles[0].py=blocks[1].particles[0].pz=double_1_decimal_5value;
+    grid.reposicionarParticulasBloque(blocks);
+    ASSERT_EQ(2,blocks.size());
+    ASSERT_EQ(13,blocks[1].id);
+    ASSERT_EQ(0,blocks[1].particles[0].id);
+    ASSERT_EQ(-1,grid.indiceBloque(2,2,2));
+    ASSERT_EQ(1,grid.indiceBloque(1,1,1));
+}
+
+//test para comprobar que en la malla dispersa cada bloque activo se reserva con sus particulas justas y que, al
+//reposicionar, los bloques quedan ordenados aunque se activen en otro orden
+TEST(GridTests, malla_dispersa_conteo) {
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{3.0,3.0,3.0};
+    Grid grid(bmin, bmax);
+    grid.setDisperso(true);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    particulas.push_back(Particle{0, 0, 2.5, 2.5, 2.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    particulas.push_back(Particle{1, 0, 0.5, 0.5, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    particulas.push_back(Particle{2, 0, 2.5, 2.5, 2.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    Fluid fluid{1.0,3,particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    //la particula 1 pasa al ultimo bloque y queda la primera, porque su bloque origen va antes
+    const double centro_ultimo = 2.5;
+    blocks[0].particles[0].px=blocks[0].particles[0].py=blocks[0].particles[0].pz=centro_ultimo;
+    grid.reposicionarParticulasBloque(blocks);
+    ASSERT_EQ(1,blocks.size());
+    ASSERT_EQ(26,blocks[0].id);
+    ASSERT_EQ(3,blocks[0].particles.size());
+    ASSERT_EQ(3,blocks[0].particles.capacity());
+    ASSERT_EQ(1,blocks[0].particles[0].id);
+    ASSERT_EQ(0,grid.indiceBloque(2,2,2));
+    ASSERT_EQ(-1,grid.indiceBloque(0,0,0));
+}
+
+//test para comprobar que el reposicionamiento por bloques destino deja las particulas igual que el normal, incluso
+//con una particula que salta varios bloques
+TEST(GridTests, reposicion_por_destinos) {
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{4.0,1.0,1.0};
+    Grid normal(bmin, bmax);
+    Grid destinos(bmin, bmax);
+    const double smoothingLength = 1.0;
+    normal.dividirEnBloques(smoothingLength);
+    destinos.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    for (int i = 0; i < 4; ++i) {
+        particulas.push_back(Particle{i, 0, i + decimal5_value, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    }
+    Fluid fluid{1.0,4,particulas};
+    Fluid fluidDestinos = fluid;
+    std::vector<Block> blocksNormal = normal.getBlocks();
+    std::vector<Block> blocksDestinos = destinos.getBlocks();
+    normal.reposicionarParticulasFluid(fluid,blocksNormal);
+    destinos.reposicionarParticulasFluid(fluidDestinos,blocksDestinos);
+    //la particula 0 salta al ultimo bloque y la 2 pasa al bloque 1
+    blocksNormal[0].particles[0].px = blocksDestinos[0].particles[0].px = double_2_value + double_1_decimal_5value;
+    blocksNormal[2].particles[0].px = blocksDestinos[2].particles[0].px = double_1_decimal_5value;
+    normal.reposicionarParticulasBloque(blocksNormal);
+    destinos.prepararReposicion();
+    int lejanas = 0;
+    for (int i = 0; i < 4; ++i) {
+        lejanas += destinos.anotarDestinos(blocksDestinos, i);
+    }
+    for (int i = 0; i < 4; ++i) {
+        destinos.recogerParticulas(blocksDestinos, i);
+    }
+    destinos.terminarReposicion(blocksDestinos, lejanas > 0);
+    ASSERT_EQ(1, lejanas);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(blocksNormal[i].particles, blocksDestinos[i].particles);
+    }
+}
+
+//test para comprobar que con paginas grandes las particulas se guardan y se mueven igual
+TEST(GridTests, repos_block_paginas_grandes) {
+    PoolParticulas::configurarPaginasGrandes(PoolParticulas::PaginasGrandes::transparentes);
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{2.0,1.0,1.0};
+    Grid grid(bmin, bmax);
+    const double smoothingLength = 1.0;
+    grid.dividirEnBloques(smoothingLength);
+    std::vector<Particle> particulas;
+    particulas.push_back(Particle{0, 0, decimal5_value, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    particulas.push_back(Particle{1, 0, double_1_decimal_5value, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    Fluid fluid{1.0,2,particulas};
+    std::vector<Block> blocks = grid.getBlocks();
+    grid.reposicionarParticulasFluid(fluid,blocks);
+    blocks[0].particles[0].px=double_1_decimal_5value;
+    blocks[1].particles[0].px=decimal5_value;
+    grid.reposicionarParticulasBloque(blocks);
+    PoolParticulas::configurarPaginasGrandes(PoolParticulas::PaginasGrandes::ninguna);
+    ASSERT_EQ(1,blocks[0].particles[0].id);
+    ASSERT_EQ(0,blocks[1].particles[0].id);
+}
+
+//test para comprobar que la subdivision anida las celdas y descarta las que quedan a mas de h
+TEST(GridTests, subdivision_vecindad_recortada) {
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{6.0,6.0,6.0};
+    const double smoothingLength = 1.0;
+    const int subdivision = 4;
+    const int celdasCompletas = 729; // (2 * 4 + 1)^3
+    const int celdasRecortadas = 613;
+    Grid grid(bmin, bmax);
+    grid.dividirEnBloques(smoothingLength);
+    ASSERT_EQ(27, grid.getTamVecindad());
+    grid.setSubdivision(subdivision);
+    grid.dividirEnBloques(smoothingLength);
+    ASSERT_EQ(6.0 * subdivision, grid.getNumberblocksx());
+    ASSERT_EQ(celdasRecortadas, grid.getTamVecindad());
+    ASSERT_LT(grid.getTamVecindad(), celdasCompletas);
+}
+
+//test para comprobar que una ventana desde una capa intermedia tiene los ids de la malla densa y que las vecindades
+//no salen de ella hasta que se cierra
+TEST(GridTests, ventana_con_base) {
+    //creamos una malla de 6x3x3 bloques con una ventana de las capas 2 y 3
+    const Punto bmin{0.0,0.0,0.0};
+    const Punto bmax{6.0,3.0,3.0};
+    const int base = 2;
+    const int capas = 2;
+    const int bloquesPorCapa = 9;
+    Grid grid(bmin, bmax);
+    grid.dividirEnBloques(1.0);
+    grid.setVentana(capas);
+    std::vector<Block> ventana;
+    grid.prepararVentana(ventana, base);
+    ASSERT_EQ(capas * bloquesPorCapa, ventana.size());
+    ASSERT_EQ(base * bloquesPorCapa, ventana[0].id);
+    ASSERT_EQ(base, ventana[0].cx);
+    ASSERT_EQ(0, grid.indiceBloque(base, 0, 0));
+    int vecinos = 0;
+    grid.paraCadaVecino(ventana[0], [&](int indice) {
+        ASSERT_GE(indice, 0);
+        ASSERT_LT(indice, ventana.size());
+        ++vecinos;
+    });
+    ASSERT_EQ(8, vecinos); // Solo los de las capas 2 y 3 (la esquina tiene 2x2x2)
+    grid.cerrarVentana();
+    ASSERT_EQ(base * bloquesPorCapa, grid.indiceBloque(base, 0, 0));
+}
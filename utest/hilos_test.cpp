@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "sim/hilos.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int num_hilos = 4;
+const std::size_t num_trozos = 1000;
+const int num_ejecuciones = 20;
+
+//test para comprobar que cada trozo se ejecuta exactamente una vez, aunque unos trozos tarden mucho mas que otros
+TEST(HilosTests, CadaTrozoUnaVez) {
+    PoolHilos pool(num_hilos);
+    std::vector<std::atomic<int>> veces(num_trozos);
+    auto tarea = [&](std::size_t trozo) {
+        //los primeros trozos (todos de la cola del hilo 0) son lentos, asi los demas hilos tienen que robar
+        if (trozo < num_trozos / num_hilos) {
+            std::this_thread::yield();
+        }
+        ++veces[trozo];
+    };
+    pool.ejecutar(num_trozos, tarea);
+    for (const auto &contador: veces) {
+        ASSERT_EQ(1, contador.load());
+    }
+}
+
+//test para comprobar que el pool se puede reutilizar, incluso con menos trozos que hilos
+TEST(HilosTests, EjecutarVariasVeces) {
+    PoolHilos pool(num_hilos);
+    std::atomic<std::size_t> total{0};
+    auto tarea = [&](std::size_t trozo) { total += trozo + 1; };
+    std::size_t esperado = 0;
+    for (int i = 0; i < num_ejecuciones; ++i) {
+        const auto trozos = static_cast<std::size_t>(i);
+        pool.ejecutar(trozos, tarea);
+        esperado += trozos * (trozos + 1) / 2;
+    }
+    ASSERT_EQ(esperado, total.load());
+}
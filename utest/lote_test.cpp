@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include "sim/lote.hpp"
+#include "sim/simulacion.hpp"
+
+// Lee un fichero entero (para comparar las salidas byte a byte)
+std::string leerFichero(const std::string &nombre) {
+    std::ifstream fichero(nombre, std::ios::binary);
+    return {std::istreambuf_iterator<char>(fichero), std::istreambuf_iterator<char>()};
+}
+
+// Ejecuta un trabajo como lo hace "fluid" sin lotes
+void ejecutarSinLote(const std::vector<std::string> &arguments) {
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+    comprobarArgsSalida(arguments, argumentos, blocks);
+}
+
+//test para comprobar que los trabajos del lote reutilizan la malla y dan lo mismo que ejecutados por separado
+TEST(LoteTests, ReutilizaMallaMismoResultado) {
+    std::istringstream manifiesto("# trabajos de prueba\n3 small.fld lote1.fld\n\n5 small.fld lote2.fld\n");
+    Lote lote{Opciones{}};
+    ASSERT_EQ(Constantes::ErrorCode::NO_ERROR, lote.ejecutarManifiesto(manifiesto));
+    ASSERT_EQ(1, lote.getMallasCreadas());
+    ejecutarSinLote({"3", "small.fld", "solo1.fld"});
+    ejecutarSinLote({"5", "small.fld", "solo2.fld"});
+    ASSERT_EQ(leerFichero("solo1.fld"), leerFichero("lote1.fld"));
+    ASSERT_EQ(leerFichero("solo2.fld"), leerFichero("lote2.fld"));
+    for (const char *nombre: {"lote1.fld", "lote2.fld", "solo1.fld", "solo2.fld"}) {
+        std::remove(nombre);
+    }
+}
+
+//test para comprobar que un trabajo con error no detiene a los siguientes y se devuelve su error
+TEST(LoteTests, ErrorNoDetieneLote) {
+    std::istringstream manifiesto("3 mesifrutero lote1.fld\n3 small.fld lote2.fld\n");
+    Lote lote{Opciones{}};
+    ASSERT_EQ(Constantes::ErrorCode::CANNOT_OPEN_FILE_READING, lote.ejecutarManifiesto(manifiesto));
+    ASSERT_FALSE(leerFichero("lote2.fld").empty());
+    std::remove("lote2.fld");
+}
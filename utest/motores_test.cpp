@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "sim/motores.hpp"
+#include "sim/paralelo.hpp"
+#include "sim/simulacion.hpp"
+#include <algorithm>
+#include <sstream>
+//constantes para evitar avisos clang-tidy por magic number
+const int iteraciones_motor = 3;
+const double perturbacion = 1e-6;
+
+namespace {
+    int llamadasPrueba = 0;
+
+    // Motor de prueba: el "gather" en serie que cuenta sus llamadas y, si se pide, cambia la densidad de una
+    // particula en la ultima iteracion
+    class MotorPrueba final : public Motor {
+    public:
+        explicit MotorPrueba(bool perturbar) : perturbarDensidad(perturbar) {}
+
+        void reposicionar(const ContextoIteracion &contexto) override {
+            contexto.malla.reposicionarParticulasBloque(contexto.recursos.bloques);
+        }
+
+        void interacciones(const ContextoIteracion &contexto) override {
+            interaccionesBloques(contexto.recursos.bloques, contexto.malla, contexto.parametros);
+            if (perturbarDensidad && ++llamadasPrueba == iteraciones_motor) {
+                auto bloque = std::ranges::find_if(contexto.recursos.bloques,
+                                                   [](const Block &block) { return !block.particles.empty(); });
+                bloque->particles.front().density *= 1.0 + perturbacion;
+            }
+        }
+
+        void movimiento(const ContextoIteracion &contexto, double paso) override {
+            const Grid &malla = contexto.malla;
+            const Punto numBloques{malla.getNumberblocksx(), malla.getNumberblocksy(), malla.getNumberblocksz()};
+            particleColissions(contexto.recursos.bloques, numBloques, paso, malla.getSubdivision());
+            particlesMovement(contexto.recursos.bloques, paso);
+            limitInteractions(contexto.recursos.bloques, numBloques, malla.getSubdivision());
+        }
+
+    private:
+        bool perturbarDensidad;
+    };
+
+    // Simula small.fld con las opciones dadas como en la linea de comandos (los recursos guardan el motor y la
+    // comprobacion cruzada)
+    void simular(std::vector<std::string> opciones, RecursosSimulacion &recursos) {
+        std::vector<std::string> arguments = {std::to_string(iteraciones_motor), "small.fld", "out.fld"};
+        arguments.insert(arguments.end(), opciones.begin(), opciones.end());
+        Argumentos argumentos;
+        ASSERT_EQ(0, static_cast<int>(extraerOpciones(arguments, argumentos.opciones)));
+        ASSERT_EQ(0, static_cast<int>(comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments,
+                                                           argumentos)));
+        Grid malla(Constantes::limInferior, Constantes::limSuperior);
+        auto result = malla.simular_malla(argumentos.fluid);
+        ejecutarIteraciones(malla, argumentos, calcularParametros(result.first, result.second, argumentos.opciones),
+                            recursos);
+    }
+}
+
+//test para comprobar los motores de la biblioteca, la eleccion por defecto y que un motor desconocido da error
+TEST(MotoresTests, RegistroYEleccion)
+{
+    const std::vector<std::string> nombres = nombresMotores();
+    for (const std::string nombre: {"scalar", "gather", "threads"}) {
+        ASSERT_NE(std::ranges::find(nombres, nombre), nombres.end());
+    }
+    Opciones opciones;
+    ASSERT_EQ("scalar", nombreMotor(opciones));
+    opciones.hilos = 2;
+    ASSERT_EQ("threads", nombreMotor(opciones));
+    opciones.grafoTareas = true;
+    ASSERT_EQ("scalar", nombreMotor(opciones));
+    ASSERT_EQ(nullptr, crearMotor("desconocido", opciones));
+    std::vector<std::string> desconocido = {"--engine=desconocido"};
+    ASSERT_EQ(-1, extraerOpciones(desconocido, opciones));
+}
+
+//test para comprobar que un motor registrado fuera de la biblioteca se elige con --engine y coincide con la
+//referencia
+TEST(MotoresTests, MotorRegistradoCoincide)
+{
+    registrarMotor("test", [](const Opciones & /*opciones*/) -> std::unique_ptr<Motor> {
+        return std::make_unique<MotorPrueba>(false);
+    });
+    RecursosSimulacion recursos;
+    simular({"--engine=test", "--cross-check"}, recursos);
+    ASSERT_EQ("test", recursos.nombreMotor);
+    ASSERT_FALSE(recursos.contraste.hayDivergencia());
+    ASSERT_LE(recursos.contraste.getDiferenciaMaxima(), Constantes::toleranciaContraste);
+}
+
+//test para comprobar que los motores paralelos deterministas coinciden bit a bit con la referencia
+TEST(MotoresTests, HilosDeterministaIdentico)
+{
+    RecursosSimulacion recursos;
+    simular({"--engine=threads", "--threads=2", "--deterministic", "--cross-check"}, recursos);
+    ASSERT_FALSE(recursos.contraste.hayDivergencia());
+    ASSERT_EQ(0.0, recursos.contraste.getDiferenciaMaxima());
+}
+
+//test para comprobar que la comprobacion cruzada da la iteracion y la etapa de la primera diferencia
+TEST(MotoresTests, ContrasteEncuentraDivergencia)
+{
+    llamadasPrueba = 0;
+    registrarMotor("test-perturbado", [](const Opciones & /*opciones*/) -> std::unique_ptr<Motor> {
+        return std::make_unique<MotorPrueba>(true);
+    });
+    RecursosSimulacion recursos;
+    simular({"--engine=test-perturbado", "--cross-check"}, recursos);
+    ASSERT_TRUE(recursos.contraste.hayDivergencia());
+    ASSERT_EQ(iteraciones_motor, recursos.contraste.getIteracionDivergencia());
+    ASSERT_EQ(Etapa::densidades, recursos.contraste.getEtapaDivergencia());
+}
+
+//test para comprobar que el informe da los ajustes del motor que cambian su resultado
+TEST(MotoresTests, InformeConAjustes)
+{
+    RecursosSimulacion recursos;
+    simular({"--engine=gather", "--kernel=fast", "--cross-check"}, recursos);
+    std::ostringstream informe;
+    recursos.contraste.escribirInforme(informe);
+    ASSERT_NE(std::string::npos, informe.str().find("gather (kernel fast, pair list off, deterministic off)"));
+}
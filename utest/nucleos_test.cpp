@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "sim/nucleos.hpp"
+#include "sim/paralelo.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const double longitud_nucleo = 0.0058;
+const double masa_nucleo = 4.0e-5;
+const int muestras_nucleo = 1000;
+const int iteraciones_nucleo = 3;
+const double error_raiz = 1e-5;
+const double error_aceleracion = 1e-4;
+
+//test para comprobar que la raiz inversa aproximada tiene un error relativo acotado
+TEST(NucleosTests, RaizInversaAcotada) {
+    for (const double valor: {1e-12, 3.4e-5, 0.25, 1.0, 7.0, 1e6}) {
+        const double exacta = 1 / std::sqrt(valor);
+        ASSERT_LT(std::abs(Nucleos::raizInversa(valor) - exacta) / exacta, error_raiz);
+    }
+}
+
+//test para comprobar que el informe da errores pequeños en todo el radio de suavizado
+TEST(NucleosTests, InformeErroresAcotados) {
+    const ParametrosSimulacion parametros = calcularParametros(longitud_nucleo, masa_nucleo);
+    const Nucleos::InformeNucleos informe = Nucleos::compararConExactos(parametros.constAccTransf, muestras_nucleo);
+    ASSERT_LT(informe.errorDensidad, 1e-9);
+    ASSERT_LT(informe.errorRaiz, error_raiz);
+    ASSERT_LT(informe.errorAceleracion, error_aceleracion);
+    ASSERT_GE(informe.errorAceleracion, 0.0);
+}
+
+// Ejecuta unas iteraciones de small.fld con el nucleo dado y devuelve las particulas en el orden original
+std::vector<Particle> simularNucleo(ModoNucleo nucleo) {
+    const std::vector<std::string> arguments = {"3", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.iteraciones = iteraciones_nucleo;
+    argumentos.opciones.nucleo = nucleo;
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    const std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+    std::vector<Particle> particulas(argumentos.fluid.numberparticles);
+    for (const auto &block: blocks) {
+        for (const auto &particle: block.particles) {
+            particulas[particle.id] = particle;
+        }
+    }
+    return particulas;
+}
+
+//test para comprobar que la simulacion con el nucleo rapido se queda cerca de la exacta
+TEST(NucleosTests, RapidoCercaExacto) {
+    const std::vector<Particle> exacto = simularNucleo(ModoNucleo::exacto);
+    const std::vector<Particle> rapido = simularNucleo(ModoNucleo::rapido);
+    ASSERT_EQ(exacto.size(), rapido.size());
+    for (std::size_t i = 0; i < exacto.size(); ++i) {
+        ASSERT_NEAR(exacto[i].px, rapido[i].px, 1e-7);
+        ASSERT_NEAR(exacto[i].py, rapido[i].py, 1e-7);
+        ASSERT_NEAR(exacto[i].pz, rapido[i].pz, 1e-7);
+        ASSERT_NEAR(exacto[i].vx, rapido[i].vx, 1e-4);
+        ASSERT_NEAR(exacto[i].vy, rapido[i].vy, 1e-4);
+        ASSERT_NEAR(exacto[i].vz, rapido[i].vz, 1e-4);
+    }
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+#include "sim/numa.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int num_hilos = 6;
+
+//test para comprobar que se entienden los rangos y los numeros sueltos de una lista de CPUs del kernel
+TEST(NumaTests, ParsearListaCpus) {
+    const std::vector<int> esperadas = {0, 1, 2, 3, 8, 10, 11};
+    ASSERT_EQ(esperadas, Numa::parsearListaCpus("0-3,8,10-11\n"));
+    ASSERT_TRUE(Numa::parsearListaCpus("").empty());
+}
+
+//test para comprobar que los hilos consecutivos van al mismo nodo y que se reparten las CPUs de cada nodo
+TEST(NumaTests, AsignarCpus) {
+    const std::vector<std::vector<int>> nodos = {{0, 1}, {2, 3}};
+    const std::vector<int> esperadas = {0, 1, 0, 2, 3, 2};
+    ASSERT_EQ(esperadas, Numa::asignarCpus(nodos, num_hilos));
+}
+
+//test para comprobar que sin informacion de nodos hay un unico nodo con al menos una CPU
+TEST(NumaTests, TopologiaSinNodos) {
+    const std::vector<std::vector<int>> nodos = Numa::leerTopologia("no/existe");
+    ASSERT_EQ(1, nodos.size());
+    ASSERT_FALSE(nodos[0].empty());
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "sim/paralelo.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int num_hilos = 3;
+const int num_iteraciones = 3;
+
+// Ejecuta unas iteraciones de small.fld con las opciones dadas y devuelve las particulas en el orden original
+std::vector<Particle> simularSmall(const Opciones &opciones) {
+    const std::vector<std::string> arguments = {"3", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.iteraciones = num_iteraciones;
+    argumentos.opciones = opciones;
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    const std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+    std::vector<Particle> particulas(argumentos.fluid.numberparticles);
+    for (const auto &block: blocks) {
+        for (const auto &particle: block.particles) {
+            particulas[particle.id] = particle;
+        }
+    }
+    return particulas;
+}
+
+//test para comprobar que el grafo de tareas da el mismo resultado (salvo redondeo) que la version secuencial
+TEST(ParaleloTests, GrafoTareasIgualSecuencial) {
+    const std::vector<Particle> secuencial = simularSmall(Opciones{});
+    Opciones opciones;
+    opciones.grafoTareas = true;
+    opciones.hilos = num_hilos;
+    const std::vector<Particle> grafo = simularSmall(opciones);
+    ASSERT_EQ(secuencial.size(), grafo.size());
+    for (std::size_t i = 0; i < secuencial.size(); ++i) {
+        ASSERT_NEAR(secuencial[i].px, grafo[i].px, 1e-9);
+        ASSERT_NEAR(secuencial[i].py, grafo[i].py, 1e-9);
+        ASSERT_NEAR(secuencial[i].pz, grafo[i].pz, 1e-9);
+        ASSERT_NEAR(secuencial[i].vx, grafo[i].vx, 1e-6);
+        ASSERT_NEAR(secuencial[i].vy, grafo[i].vy, 1e-6);
+        ASSERT_NEAR(secuencial[i].vz, grafo[i].vz, 1e-6);
+    }
+}
+
+//test para comprobar que los bucles con robo de trabajo dan el mismo resultado (salvo redondeo) que la version secuencial
+TEST(ParaleloTests, RoboTrabajoIgualSecuencial) {
+    const std::vector<Particle> secuencial = simularSmall(Opciones{});
+    Opciones opciones;
+    opciones.hilos = num_hilos;
+    const std::vector<Particle> paralelo = simularSmall(opciones);
+    ASSERT_EQ(secuencial.size(), paralelo.size());
+    for (std::size_t i = 0; i < secuencial.size(); ++i) {
+        ASSERT_NEAR(secuencial[i].px, paralelo[i].px, 1e-9);
+        ASSERT_NEAR(secuencial[i].py, paralelo[i].py, 1e-9);
+        ASSERT_NEAR(secuencial[i].pz, paralelo[i].pz, 1e-9);
+        ASSERT_NEAR(secuencial[i].vx, paralelo[i].vx, 1e-6);
+        ASSERT_NEAR(secuencial[i].vy, paralelo[i].vy, 1e-6);
+        ASSERT_NEAR(secuencial[i].vz, paralelo[i].vz, 1e-6);
+    }
+}
+
+//test para comprobar que con "determinista" los motores paralelos dan exactamente el mismo resultado que la version
+//secuencial (sin tolerancia), con cualquier numero de hilos
+TEST(ParaleloTests, DeterministaIdenticoSecuencial) {
+    const std::vector<Particle> secuencial = simularSmall(Opciones{});
+    for (const bool grafoTareas: {false, true}) {
+        for (int hilos = 1; hilos <= num_hilos; ++hilos) {
+            Opciones opciones;
+            opciones.determinista = true;
+            opciones.grafoTareas = grafoTareas;
+            opciones.hilos = hilos;
+            const std::vector<Particle> paralelo = simularSmall(opciones);
+            ASSERT_EQ(secuencial.size(), paralelo.size());
+            for (std::size_t i = 0; i < secuencial.size(); ++i) {
+                ASSERT_EQ(secuencial[i].px, paralelo[i].px);
+                ASSERT_EQ(secuencial[i].py, paralelo[i].py);
+                ASSERT_EQ(secuencial[i].pz, paralelo[i].pz);
+                ASSERT_EQ(secuencial[i].vx, paralelo[i].vx);
+                ASSERT_EQ(secuencial[i].vy, paralelo[i].vy);
+                ASSERT_EQ(secuencial[i].vz, paralelo[i].vz);
+            }
+        }
+    }
+}
+
+//test para comprobar que la lista de pares da el mismo resultado (salvo redondeo) que la version secuencial, en serie,
+//con robo de trabajo y con el grafo de tareas
+TEST(ParaleloTests, ListaParesIgualSecuencial) {
+    const std::vector<Particle> secuencial = simularSmall(Opciones{});
+    for (const int hilos: {0, num_hilos}) {
+        Opciones opciones;
+        opciones.listaPares = true;
+        opciones.hilos = hilos;
+        opciones.grafoTareas = hilos > 0;
+        const std::vector<Particle> lista = simularSmall(opciones);
+        ASSERT_EQ(secuencial.size(), lista.size());
+        for (std::size_t i = 0; i < secuencial.size(); ++i) {
+            ASSERT_NEAR(secuencial[i].px, lista[i].px, 1e-9);
+            ASSERT_NEAR(secuencial[i].py, lista[i].py, 1e-9);
+            ASSERT_NEAR(secuencial[i].pz, lista[i].pz, 1e-9);
+            ASSERT_NEAR(secuencial[i].vx, lista[i].vx, 1e-6);
+            ASSERT_NEAR(secuencial[i].vy, lista[i].vy, 1e-6);
+            ASSERT_NEAR(secuencial[i].vz, lista[i].vz, 1e-6);
+        }
+    }
+}
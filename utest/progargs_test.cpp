@@ -108,4 +108,194 @@ TEST(Propargs_Tests, AllCorrectLarge) {
     // Assert
     ASSERT_EQ(resultin, 0);
     ASSERT_EQ(resultout, 0);
-}
\ No newline at end of file
+}
+
+//test para comprobar que si una particula de los bloques tiene un id fuera de rango, da un error al escribir
+TEST(Propargs_Tests, SalidaIdFueraDeRango) {
+    // Arrange
+    const std::vector<std::string> arguments = {"10", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    std::vector<Block> blocks(1);
+    const size_t argc = arguments.size() + 1;
+    const Constantes::ErrorCode resultin = comprobarArgsEntrada(static_cast<int>(argc), arguments, argumentos);
+    Particle particle = argumentos.fluid.particles[0];
+    particle.id = argumentos.fluid.numberparticles;
+    blocks[0].addParticle(particle);
+    // Act
+    const Constantes::ErrorCode resultout = comprobarArgsSalida(arguments, argumentos, blocks);
+    // Assert
+    ASSERT_EQ(resultin, 0);
+    ASSERT_EQ(resultout, -5);
+}
+
+//test para comprobar que si falta una particula (ni en los bloques ni en el fluido), da un error al escribir
+TEST(Propargs_Tests, SalidaFaltaParticula) {
+    // Arrange
+    const std::vector<std::string> arguments = {"10", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    std::vector<Block> blocks(1);
+    const size_t argc = arguments.size() + 1;
+    const Constantes::ErrorCode resultin = comprobarArgsEntrada(static_cast<int>(argc), arguments, argumentos);
+    blocks[0].addParticle(argumentos.fluid.particles[0]);
+    argumentos.fluid.particles.clear();
+    // Act
+    const Constantes::ErrorCode resultout = comprobarArgsSalida(arguments, argumentos, blocks);
+    // Assert
+    ASSERT_EQ(resultin, 0);
+    ASSERT_EQ(resultout, -5);
+}
+
+//test para comprobar que las opciones se separan de los argumentos posicionales
+TEST(Propargs_Tests, ExtraerOpciones) {
+    // Arrange
+    std::vector<std::string> arguments = {"--sort-every=5", "10", "small.fld", "out.fld"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, 0);
+    ASSERT_EQ(arguments.size(), 3);
+    ASSERT_EQ(arguments[0], "10");
+    ASSERT_EQ(opciones.intervaloOrden, 5);
+}
+
+//test para comprobar que una opcion desconocida o con un valor invalido da error
+TEST(Propargs_Tests, ExtraerOpcionesInvalidas) {
+    // Arrange
+    std::vector<std::string> desconocida = {"10", "small.fld", "out.fld", "--messi"};
+    std::vector<std::string> invalida = {"10", "small.fld", "out.fld", "--sort-every", "-1"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode resultDesconocida = extraerOpciones(desconocida, opciones);
+    const Constantes::ErrorCode resultInvalida = extraerOpciones(invalida, opciones);
+    // Assert
+    ASSERT_EQ(resultDesconocida, -1);
+    ASSERT_EQ(resultInvalida, -1);
+}
+
+//test para comprobar que un valor numerico con caracteres de sobra da error
+TEST(Propargs_Tests, ExtraerOpcionesConBasura) {
+    // Arrange
+    std::vector<std::string> entero = {"10", "small.fld", "out.fld", "--sort-every=5abc"};
+    std::vector<std::string> hilos = {"10", "small.fld", "out.fld", "--threads=2x"};
+    std::vector<std::string> real = {"10", "small.fld", "out.fld", "--time=0.5s"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode resultEntero = extraerOpciones(entero, opciones);
+    const Constantes::ErrorCode resultHilos = extraerOpciones(hilos, opciones);
+    const Constantes::ErrorCode resultReal = extraerOpciones(real, opciones);
+    // Assert
+    ASSERT_EQ(resultEntero, -1);
+    ASSERT_EQ(resultHilos, -1);
+    ASSERT_EQ(resultReal, -1);
+}
+
+//test para comprobar que la comprobacion cruzada con el grafo de tareas da error
+TEST(Propargs_Tests, ContrasteConGrafoInvalido) {
+    // Arrange
+    std::vector<std::string> arguments = {"10", "small.fld", "out.fld", "--task-graph", "--cross-check"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, -1);
+}
+
+//test para comprobar que las opciones que piden un entero positivo dan error con 0 en vez de tomar 1
+TEST(Propargs_Tests, ExtraerOpcionesCero) {
+    // Arrange
+    std::vector<std::string> rangos = {"10", "small.fld", "out.fld", "--ranks=0"};
+    std::vector<std::string> subdivision = {"10", "small.fld", "out.fld", "--subdivide=0"};
+    std::vector<std::string> pasos = {"10", "small.fld", "out.fld", "--sleep=1e-3", "--sleep-steps=0"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode resultRangos = extraerOpciones(rangos, opciones);
+    const Constantes::ErrorCode resultSubdivision = extraerOpciones(subdivision, opciones);
+    const Constantes::ErrorCode resultPasos = extraerOpciones(pasos, opciones);
+    // Assert
+    ASSERT_EQ(resultRangos, -1);
+    ASSERT_EQ(resultSubdivision, -1);
+    ASSERT_EQ(resultPasos, -1);
+}
+
+//test para comprobar que los bloques en reposo dan error con los modos que no los tienen
+TEST(Propargs_Tests, ReposoConRangosDispersaOCapasInvalido) {
+    // Arrange
+    std::vector<std::string> rangos = {"10", "small.fld", "out.fld", "--sleep=1e-3", "--ranks=2"};
+    std::vector<std::string> dispersa = {"10", "small.fld", "out.fld", "--sleep=1e-3", "--sparse"};
+    std::vector<std::string> capas = {"10", "small.fld", "out.fld", "--sleep=1e-3", "--out-of-core=/tmp"};
+    Opciones opcionesRangos;
+    Opciones opcionesDispersa;
+    Opciones opcionesCapas;
+    // Act
+    const Constantes::ErrorCode resultRangos = extraerOpciones(rangos, opcionesRangos);
+    const Constantes::ErrorCode resultDispersa = extraerOpciones(dispersa, opcionesDispersa);
+    const Constantes::ErrorCode resultCapas = extraerOpciones(capas, opcionesCapas);
+    // Assert
+    ASSERT_EQ(resultRangos, -1);
+    ASSERT_EQ(resultDispersa, -1);
+    ASSERT_EQ(resultCapas, -1);
+}
+
+//test para comprobar que el motor da error con el grafo de tareas o los rangos, y la comprobacion cruzada con los rangos
+TEST(Propargs_Tests, MotorConGrafoORangosInvalido) {
+    // Arrange
+    std::vector<std::string> grafo = {"10", "small.fld", "out.fld", "--engine=gather", "--task-graph"};
+    std::vector<std::string> rangos = {"10", "small.fld", "out.fld", "--engine=gather", "--ranks=2"};
+    std::vector<std::string> contraste = {"10", "small.fld", "out.fld", "--cross-check", "--ranks=2"};
+    Opciones opcionesGrafo;
+    Opciones opcionesRangos;
+    Opciones opcionesContraste;
+    // Act
+    const Constantes::ErrorCode resultGrafo = extraerOpciones(grafo, opcionesGrafo);
+    const Constantes::ErrorCode resultRangos = extraerOpciones(rangos, opcionesRangos);
+    const Constantes::ErrorCode resultContraste = extraerOpciones(contraste, opcionesContraste);
+    // Assert
+    ASSERT_EQ(resultGrafo, -1);
+    ASSERT_EQ(resultRangos, -1);
+    ASSERT_EQ(resultContraste, -1);
+}
+
+//test para comprobar que los tiempos de las etapas dan error con los rangos, que no los miden
+TEST(Propargs_Tests, TiemposConRangosInvalido) {
+    // Arrange
+    std::vector<std::string> arguments = {"10", "small.fld", "out.fld", "--stage-times=t.json", "--ranks=2"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, -1);
+}
+
+//test para comprobar que la traza da error con los rangos, que no anotan sus etapas
+TEST(Propargs_Tests, TrazaConRangosInvalido) {
+    // Arrange
+    std::vector<std::string> arguments = {"10", "small.fld", "out.fld", "--trace=f.json", "--ranks=2"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, -1);
+}
+
+//test para comprobar que las estadisticas de memoria dan error con los rangos, que no cuentan sus reservas
+TEST(Propargs_Tests, MemoriaConRangosInvalido) {
+    // Arrange
+    std::vector<std::string> arguments = {"10", "small.fld", "out.fld", "--memory-stats=f.json", "--ranks=2"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, -1);
+}
+
+//test para comprobar que el roofline da error con los rangos, que no cuentan el trabajo de sus etapas
+TEST(Propargs_Tests, RooflineConRangosInvalido) {
+    // Arrange
+    std::vector<std::string> arguments = {"10", "small.fld", "out.fld", "--roofline=f.json", "--ranks=2"};
+    Opciones opciones;
+    // Act
+    const Constantes::ErrorCode result = extraerOpciones(arguments, opciones);
+    // Assert
+    ASSERT_EQ(result, -1);
+}
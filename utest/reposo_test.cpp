@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "sim/paralelo.hpp"
+#include "sim/simulacion.hpp"
+//constantes para evitar avisos clang-tidy por magic number
+const float particulas_metro = 204.0F;
+const int lado_reticula = 4;
+const double separacion_reticula = 0.008; // Menor que la longitud de suavizado: las particulas interactuan
+const double umbral_quieto = 1.0; // Por encima de |a|·paso de la reticula en las primeras iteraciones
+const double umbral_minimo = 1e-30;
+const int pasos_reposo_test = 2;
+const int iteraciones_reposo = 4; // Se duermen, se saltan dos iteraciones y se despiertan
+const double gravedad = -9.8;
+
+namespace {
+    // Reticula de particulas quietas en el centro del recinto, tan juntas que interactuan
+    Fluid reticula() {
+        Fluid fluid;
+        fluid.particlespermeter = particulas_metro;
+        for (int i = 0; i < lado_reticula * lado_reticula * lado_reticula; ++i) {
+            Particle particle{};
+            particle.id = i;
+            particle.px = (i % lado_reticula - lado_reticula / 2) * separacion_reticula;
+            particle.py = (i / lado_reticula % lado_reticula) * separacion_reticula;
+            particle.pz = (i / (lado_reticula * lado_reticula) - lado_reticula / 2) * separacion_reticula;
+            fluid.particles.push_back(particle);
+        }
+        fluid.numberparticles = static_cast<int>(fluid.particles.size());
+        return fluid;
+    }
+
+    // Indica si alguna particula tiene una aceleracion vertical distinta de la gravedad
+    bool interactuan(const std::vector<Block> &blocks) {
+        return std::ranges::any_of(blocks, [](const Block &block) {
+            return std::ranges::any_of(block.particles, [](const Particle &particle) {
+                return particle.ay != gravedad;
+            });
+        });
+    }
+
+    // Posiciones de los bloques que duermen en la siguiente iteracion
+    std::vector<std::size_t> bloquesDormidos(const Reposo &reposo, std::size_t numBloques) {
+        std::vector<std::size_t> dormidos;
+        for (std::size_t indice = 0; indice < numBloques; ++indice) {
+            if (reposo.getDormido(indice)) {
+                dormidos.push_back(indice);
+            }
+        }
+        return dormidos;
+    }
+
+    // Posiciones de los bloques marcados como dormidos
+    std::vector<std::size_t> bloquesMarcados(const std::vector<Block> &blocks) {
+        std::vector<std::size_t> marcados;
+        for (std::size_t indice = 0; indice < blocks.size(); ++indice) {
+            if (blocks[indice].dormido) {
+                marcados.push_back(indice);
+            }
+        }
+        return marcados;
+    }
+
+    // Simula el fluido con las opciones y devuelve los bloques finales (los recursos guardan el reposo)
+    std::vector<Block> simular(const Fluid &fluid, const Opciones &opciones, int iteraciones,
+                               RecursosSimulacion &recursos) {
+        Argumentos argumentos;
+        argumentos.fluid = fluid;
+        argumentos.iteraciones = iteraciones;
+        argumentos.opciones = opciones;
+        Grid malla(Constantes::limInferior, Constantes::limSuperior);
+        auto result = malla.simular_malla(argumentos.fluid);
+        return ejecutarIteraciones(malla, argumentos, calcularParametros(result.first, result.second, opciones),
+                                   recursos);
+    }
+
+    // Compara las particulas de dos simulaciones con la misma malla, bloque a bloque
+    void compararBloques(const std::vector<Block> &esperados, const std::vector<Block> &obtenidos) {
+        ASSERT_EQ(esperados.size(), obtenidos.size());
+        for (std::size_t indice = 0; indice < esperados.size(); ++indice) {
+            ASSERT_EQ(esperados[indice].particles.size(), obtenidos[indice].particles.size());
+            for (std::size_t i = 0; i < esperados[indice].particles.size(); ++i) {
+                ASSERT_EQ(esperados[indice].particles[i], obtenidos[indice].particles[i]);
+            }
+        }
+    }
+}
+
+//test para comprobar que en cada iteracion se saltan justo los bloques dormidos en la anterior: los quietos se
+//duermen tras "pasos" iteraciones, duermen "pasos" iteraciones y se recalculan una antes de volver a dormirse
+TEST(ReposoTests, SaltaLosBloquesDormidos) {
+    Argumentos argumentos;
+    argumentos.fluid = reticula();
+    argumentos.opciones.umbralReposo = umbral_quieto;
+    argumentos.opciones.pasosReposo = pasos_reposo_test;
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    const ParametrosSimulacion parametros = calcularParametros(result.first, result.second, argumentos.opciones);
+    RecursosSimulacion recursos;
+    recursos.preparar(argumentos.opciones);
+    prepararBloques(malla, recursos.bloques);
+    malla.reposicionarParticulasFluid(argumentos.fluid, recursos.bloques);
+    const ContextoIteracion contexto{malla, argumentos.opciones, parametros, recursos};
+    std::vector<std::size_t> dormidos;
+    for (int iter = 0; iter < iteraciones_reposo; ++iter) {
+        const long saltados = recursos.reposo.getBloquesSaltados();
+        const double paso = ejecutarEtapas(contexto, iter, 0.0); // Como ejecutarIteracion, con una pausa
+        ASSERT_EQ(dormidos, bloquesMarcados(recursos.bloques)) << iter; // Los saltados en esta iteracion
+        recursos.reposo.actualizar(recursos.bloques, malla, paso);
+        ASSERT_EQ(static_cast<long>(dormidos.size()), recursos.reposo.getBloquesSaltados() - saltados) << iter;
+        ASSERT_TRUE(interactuan(recursos.bloques));
+        dormidos = bloquesDormidos(recursos.reposo, recursos.bloques.size());
+        ASSERT_EQ(iter % (pasos_reposo_test + 1) != 0, !dormidos.empty()) << iter;
+    }
+}
+
+
+//test para comprobar que si ningun bloque llega a estar quieto el resultado es el de las versiones "gather"
+TEST(ReposoTests, SinBloquesQuietosIgualGather) {
+    const Argumentos leidos = [] {
+        const std::vector<std::string> arguments = {"5", "small.fld", "out.fld"};
+        Argumentos argumentos;
+        comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+        return argumentos;
+    }();
+    Opciones opciones;
+    opciones.hilos = 1;
+    RecursosSimulacion despiertos;
+    const std::vector<Block> esperados = simular(leidos.fluid, opciones, leidos.iteraciones, despiertos);
+    opciones.umbralReposo = umbral_minimo;
+    RecursosSimulacion conReposo;
+    const std::vector<Block> obtenidos = simular(leidos.fluid, opciones, leidos.iteraciones, conReposo);
+    ASSERT_EQ(0, conReposo.reposo.getBloquesSaltados());
+    compararBloques(esperados, obtenidos);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "sim/paralelo.hpp"
+#include "sim/simulacion.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    // Simula una iteracion de small.fld con --roofline y devuelve el fichero escrito (los recursos guardan los
+    // recuentos); "particulas" y "suavizado" reciben las particulas iniciales y la longitud de suavizado
+    std::string simularRoofline(Opciones opciones, RecursosSimulacion &recursos, std::vector<Particle> &particulas,
+                                double &suavizado) {
+        const std::vector<std::string> arguments = {"1", "small.fld", "out.fld"};
+        Argumentos argumentos;
+        comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+        opciones.ficheroRoofline = (std::filesystem::temp_directory_path() / "roofline_test.json").string();
+        argumentos.opciones = opciones;
+        particulas = argumentos.fluid.particles;
+        Grid malla(Constantes::limInferior, Constantes::limSuperior);
+        auto result = malla.simular_malla(argumentos.fluid);
+        suavizado = result.first;
+        ejecutarIteraciones(malla, argumentos, calcularParametros(result.first, result.second, opciones), recursos);
+        std::ifstream fichero(opciones.ficheroRoofline);
+        std::stringstream contenido;
+        contenido << fichero.rdbuf();
+        std::remove(opciones.ficheroRoofline.c_str());
+        return contenido.str();
+    }
+}
+
+//test para comprobar que los pares que interactuan son los de una busqueda por fuerza bruta y que el fichero tiene
+//el rendimiento de cada etapa
+TEST(RooflineTests, ParesComoFuerzaBruta)
+{
+    RecursosSimulacion recursos;
+    std::vector<Particle> particulas;
+    double suavizado = 0.0;
+    const std::string json = simularRoofline(Opciones{}, recursos, particulas, suavizado);
+    double pares = 0.0;
+    for (std::size_t i = 0; i < particulas.size(); ++i) {
+        for (std::size_t j = i + 1; j < particulas.size(); ++j) {
+            const double deltaX = particulas[i].px - particulas[j].px;
+            const double deltaY = particulas[i].py - particulas[j].py;
+            const double deltaZ = particulas[i].pz - particulas[j].pz;
+            pares += deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ < suavizado * suavizado ? 1.0 : 0.0;
+        }
+    }
+    ASSERT_GT(pares, 0.0);
+    ASSERT_EQ(pares, recursos.roofline.getPares());
+    ASSERT_GE(recursos.roofline.getPruebas(), pares);
+    ASSERT_NE(json.find("\"peak_gbs\": "), std::string::npos);
+    ASSERT_NE(json.find("\"densities\": {\"seconds\": "), std::string::npos);
+    ASSERT_NE(json.find("\"bound\": \""), std::string::npos);
+    ASSERT_EQ(json.find("\"interactions\""), std::string::npos);
+}
+
+//test para comprobar que las versiones "gather" cuentan cada par dos veces y que las etapas que se ejecutan juntas
+//suman el trabajo de sus partes
+TEST(RooflineTests, GatherSumaEtapas)
+{
+    RecursosSimulacion serie;
+    RecursosSimulacion hilos;
+    std::vector<Particle> particulas;
+    double suavizado = 0.0;
+    simularRoofline(Opciones{}, serie, particulas, suavizado);
+    Opciones opciones;
+    opciones.hilos = 1;
+    const std::string json = simularRoofline(opciones, hilos, particulas, suavizado);
+    ASSERT_EQ(serie.roofline.getPares(), hilos.roofline.getPares());
+    ASSERT_GT(hilos.roofline.trabajo(Etapa::densidades).flops, serie.roofline.trabajo(Etapa::densidades).flops);
+    double flops = 0.0;
+    for (const Etapa etapa: {Etapa::densidades, Etapa::transformacion, Etapa::aceleraciones}) {
+        flops += hilos.roofline.trabajo(etapa).flops;
+    }
+    ASSERT_DOUBLE_EQ(flops, hilos.roofline.trabajo(Etapa::interacciones).flops);
+    ASSERT_NE(json.find("\"interactions\": {\"seconds\": "), std::string::npos);
+}
+
+//test para comprobar que el trabajo se cuenta con las versiones del motor elegido con --engine
+TEST(RooflineTests, SegunElMotor)
+{
+    RecursosSimulacion hilos;
+    RecursosSimulacion gather;
+    RecursosSimulacion escalar;
+    std::vector<Particle> particulas;
+    double suavizado = 0.0;
+    Opciones opciones;
+    opciones.hilos = 1;
+    simularRoofline(opciones, hilos, particulas, suavizado);
+    opciones.motor = "gather";
+    simularRoofline(opciones, gather, particulas, suavizado);
+    opciones.motor = "scalar";
+    simularRoofline(opciones, escalar, particulas, suavizado);
+    ASSERT_EQ(hilos.roofline.trabajo(Etapa::densidades).flops, gather.roofline.trabajo(Etapa::densidades).flops);
+    ASSERT_GT(gather.roofline.trabajo(Etapa::densidades).flops, escalar.roofline.trabajo(Etapa::densidades).flops);
+    ASSERT_EQ(1, escalar.roofline.getHilos());
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sim/servidor.hpp"
+#include "sim/simulacion.hpp"
+//constantes para evitar avisos clang-tidy por magic number
+const std::size_t longitud_larga = 100000; // Mas que el maximo de una linea
+
+namespace {
+    std::string leerSalida(const std::string &nombre) {
+        std::ifstream fichero(nombre, std::ios::binary);
+        return {std::istreambuf_iterator<char>(fichero), std::istreambuf_iterator<char>()};
+    }
+
+    // Envia las lineas al servidor por un par de sockets, lo atiende y devuelve lo que responde y si sigue
+    std::pair<std::string, bool> atenderLineas(Servidor &servidor, const std::string &lineas) {
+        std::array<int, 2> extremos{};
+        EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, extremos.data()));
+        EXPECT_EQ(static_cast<ssize_t>(lineas.size()), ::write(extremos[0], lineas.data(), lineas.size()));
+        ::shutdown(extremos[0], SHUT_WR);
+        const bool sigue = servidor.atender(extremos[1]);
+        ::close(extremos[1]);
+        std::string respuesta;
+        std::array<char, 256> buffer{};
+        for (ssize_t leidos = 0; (leidos = ::read(extremos[0], buffer.data(), buffer.size())) > 0;) {
+            respuesta.append(buffer.data(), static_cast<std::size_t>(leidos));
+        }
+        ::close(extremos[0]);
+        return {respuesta, sigue};
+    }
+
+    long contar(const std::string &texto, const std::string &patron) {
+        long veces = 0;
+        for (std::size_t posicion = texto.find(patron); posicion != std::string::npos;
+             posicion = texto.find(patron, posicion + 1)) {
+            ++veces;
+        }
+        return veces;
+    }
+}
+
+//test para comprobar que el servidor ejecuta los trabajos como "fluid", con su telemetria y su estado
+TEST(ServidorTests, TrabajosConTelemetriaYEstado) {
+    Servidor servidor{Opciones{}};
+    const auto [respuesta, sigue] = atenderLineas(servidor, "3 small.fld serv1.fld --telemetry=1\n"
+                                                             "# comentario\n5 small.fld serv2.fld\n");
+    ASSERT_TRUE(sigue);
+    ASSERT_EQ(3, contar(respuesta, "\"iteration\""));
+    ASSERT_EQ(2, contar(respuesta, "\"status\": \"ok\""));
+    ASSERT_NE(std::string::npos, respuesta.find("{\"job\": 2"));
+
+    const std::vector<std::string> arguments = {"5", "small.fld", "solo.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+    comprobarArgsSalida(arguments, argumentos, blocks);
+    ASSERT_EQ(leerSalida("solo.fld"), leerSalida("serv2.fld"));
+    for (const char *nombre: {"serv1.fld", "serv2.fld", "solo.fld"}) {
+        std::remove(nombre);
+    }
+}
+
+//test para comprobar que un trabajo con error se responde con su codigo y su mensaje, y que "shutdown" detiene
+TEST(ServidorTests, ErrorYDetener) {
+    Servidor servidor{Opciones{}};
+    const auto [respuesta, sigue] = atenderLineas(servidor, "3 mesifrutero serv1.fld\nshutdown\n"
+                                                             "3 small.fld serv2.fld\n");
+    ASSERT_FALSE(sigue);
+    ASSERT_NE(std::string::npos, respuesta.find("\"status\": \"error\", \"code\": -3"));
+    ASSERT_NE(std::string::npos, respuesta.find("Cannot open mesifrutero"));
+    ASSERT_NE(std::string::npos, respuesta.find("{\"status\": \"shutdown\"}"));
+    ASSERT_TRUE(leerSalida("serv2.fld").empty());
+}
+
+//test para comprobar que una linea demasiado larga se responde con un error y corta la conexion
+TEST(ServidorTests, LineaDemasiadoLarga) {
+    Servidor servidor{Opciones{}};
+    const std::string larga = "3 small.fld serv1.fld" + std::string(longitud_larga, ' ');
+    const auto [respuesta, sigue] = atenderLineas(servidor, larga + "\n3 small.fld serv2.fld\n");
+    ASSERT_TRUE(sigue);
+    ASSERT_EQ("{\"status\": \"error\", \"message\": \"line too long\"}\n", respuesta);
+    ASSERT_TRUE(leerSalida("serv1.fld").empty());
+    ASSERT_TRUE(leerSalida("serv2.fld").empty());
+}
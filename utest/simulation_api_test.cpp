@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include "sim/simulation.hpp"
+#include "sim/simulacion.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int pasos_api = 3;
+
+// Lee small.fld como lo hace "fluid"
+Argumentos leerSmall() {
+    const std::vector<std::string> arguments = {"3", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    return argumentos;
+}
+
+// Comprueba que las posiciones y velocidades de la simulacion coinciden, por id, con las de los bloques
+void compararConBloques(const Simulation &simulacion, const std::vector<Block> &blocks) {
+    const Simulation::VistaCampo posiciones = simulacion.positions();
+    const Simulation::VistaCampo velocidades = simulacion.velocities();
+    for (const auto &block: blocks) {
+        for (const auto &particle: block.particles) {
+            ASSERT_EQ(particle.px, posiciones[particle.id].x);
+            ASSERT_EQ(particle.py, posiciones[particle.id].y);
+            ASSERT_EQ(particle.pz, posiciones[particle.id].z);
+            ASSERT_EQ(particle.vx, velocidades[particle.id].x);
+            ASSERT_EQ(particle.vy, velocidades[particle.id].y);
+            ASSERT_EQ(particle.vz, velocidades[particle.id].z);
+        }
+    }
+}
+
+//test para comprobar que avanzar paso a paso da lo mismo que "ejecutarIteraciones", tambien tras reset
+TEST(SimulationApiTests, PasoAPasoIgualIteraciones) {
+    Argumentos argumentos = leerSmall();
+    Simulation simulacion;
+    simulacion.load(argumentos.fluid.particles, argumentos.fluid.particlespermeter);
+    for (int paso = 0; paso < pasos_api; ++paso) {
+        simulacion.step();
+    }
+    ASSERT_EQ(pasos_api, simulacion.iterations());
+
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    argumentos.iteraciones = pasos_api;
+    const std::vector<Block> blocks = ejecutarIteraciones(malla, argumentos, result.first, result.second);
+    compararConBloques(simulacion, blocks);
+
+    simulacion.reset();
+    ASSERT_EQ(0, simulacion.iterations());
+    simulacion.step(pasos_api);
+    compararConBloques(simulacion, blocks);
+}
+
+//test para comprobar que la vista recorre todas las particulas una vez y coincide con el acceso por id
+TEST(SimulationApiTests, VistaRecorreTodas) {
+    const Argumentos argumentos = leerSmall();
+    Simulation simulacion;
+    simulacion.load(argumentos.fluid.particles, argumentos.fluid.particlespermeter);
+    simulacion.step();
+    const Simulation::VistaCampo posiciones = simulacion.positions();
+    std::vector<bool> vistas(simulacion.size(), false);
+    for (auto it = posiciones.begin(); it != posiciones.end(); ++it) {
+        ASSERT_FALSE(vistas[it.id()]);
+        vistas[it.id()] = true;
+        ASSERT_EQ(posiciones[it.id()].x, (*it).x);
+    }
+    ASSERT_EQ(std::vector<bool>(simulacion.size(), true), vistas);
+}
+
+//test para comprobar que load rechaza ids repetidos y que step sin particulas lanza una excepcion
+TEST(SimulationApiTests, ErroresCarga) {
+    Argumentos argumentos = leerSmall();
+    Simulation simulacion;
+    ASSERT_THROW(simulacion.step(), std::logic_error);
+    argumentos.fluid.particles[1].id = 0;
+    ASSERT_THROW(simulacion.load(argumentos.fluid.particles, argumentos.fluid.particlespermeter),
+                 std::invalid_argument);
+    ASSERT_THROW((void) simulacion.positions()[-1], std::out_of_range);
+}
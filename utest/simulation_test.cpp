@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "sim/simulacion.hpp"
+#include "sim/tiempos.hpp"
+#include "sim/paralelo.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <sstream>
 //constantes para evitar avisos clang-tidy por magic number
 const double double_4_value = 4.0;
 const double double_2_value = 2.0;
@@ -7,6 +13,7 @@ const double double_3_value = 3.0;
 const double double_10_value = 10.0;
 const double decimal01_value = 0.01;
 const double decimal1_value = 0.1;
+const std::size_t bytes_prueba = std::size_t{1} << 20U;
 //test para comprobar que se inicializan las aceleraciones de forma correcta
 TEST(SimulationTests, InitAccelerations)
 {
@@ -448,3 +455,101 @@ TEST(SimulationTests, transferAcceleration2){
     ASSERT_NEAR(236.97864,grid_blocks[2].particles[0].ay,1e-5);
     ASSERT_NEAR(118.96932,grid_blocks[2].particles[0].az,1e-5);
 }
+
+//test para comprobar que el paso adaptativo se limita por la velocidad maxima y por el muelle de las colisiones
+TEST(SimulationTests, PasoAdaptativo) {
+    Block block(0,0,0,0);
+    const Particle particle{0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    block.addParticle(particle);
+    std::vector<Block> blocks_vector;
+    blocks_vector.push_back(block);
+    const Opciones opciones;
+    //con el fluido en reposo solo limita el muelle de las colisiones
+    const double pasoReposo = calcularPasoAdaptativo(blocks_vector, decimal01_value, opciones);
+    ASSERT_NEAR(opciones.factorCFL * 2 / std::sqrt(Constantes::colisRigidez), pasoReposo, 1e-12);
+    //con velocidad, ninguna particula avanza mas de factorCFL * h en un paso
+    blocks_vector[0].particles[0].hvx = double_10_value;
+    const double pasoVelocidad = calcularPasoAdaptativo(blocks_vector, decimal01_value, opciones);
+    ASSERT_NEAR(opciones.factorCFL * decimal01_value / double_10_value, pasoVelocidad, 1e-12);
+}
+
+//test para comprobar que los tiempos por etapa solo se miden activados y que el JSON solo incluye las etapas medidas
+TEST(SimulationTests, TiemposEtapasJson)
+{
+    TiemposEtapas tiempos;
+    int llamadas = 0;
+    tiempos.medir(Etapa::densidades, [&] { ++llamadas; });
+    ASSERT_EQ(tiempos.getSegundos(Etapa::densidades), 0.0);
+    tiempos.reiniciar(true);
+    tiempos.medir(Etapa::densidades, [&] { ++llamadas; });
+    tiempos.medir(Etapa::total, [&] { ++llamadas; });
+    std::ostringstream salida;
+    tiempos.escribirJson(salida, 3);
+    const std::string json = salida.str();
+    ASSERT_EQ(llamadas, 3);
+    ASSERT_NE(json.find("\"iterations\": 3"), std::string::npos);
+    ASSERT_NE(json.find("\"densities\": "), std::string::npos);
+    ASSERT_NE(json.find("\"total\": "), std::string::npos);
+    ASSERT_EQ(json.find("\"accelerations\""), std::string::npos);
+}
+
+
+//test para comprobar que la memoria de cada etapa se cuenta por separado aunque las etapas esten anidadas
+TEST(SimulationTests, MemoriaEtapasAnidadas)
+{
+    TiemposEtapas tiempos;
+    tiempos.reiniciar(false, true);
+    std::unique_ptr<std::vector<char>> guardado;
+    tiempos.medir(Etapa::total, [&] {
+        tiempos.medir(Etapa::densidades, [&] { guardado = std::make_unique<std::vector<char>>(bytes_prueba); });
+        tiempos.medir(Etapa::movimiento, [&] { guardado.reset(); });
+    });
+    const auto &densidades = tiempos.getMemoria(Etapa::densidades);
+    const auto &movimiento = tiempos.getMemoria(Etapa::movimiento);
+    const auto &total = tiempos.getMemoria(Etapa::total);
+    ASSERT_EQ(2, densidades.recuento.reservas);
+    ASSERT_GE(densidades.recuento.bytesReservados, static_cast<long>(bytes_prueba));
+    ASSERT_EQ(2, movimiento.recuento.liberaciones);
+    ASSERT_GE(movimiento.recuento.bytesLiberados, static_cast<long>(bytes_prueba));
+    ASSERT_EQ(densidades.recuento.reservas, total.recuento.reservas);
+    ASSERT_GE(total.picoVivos, densidades.picoVivos);
+    std::ostringstream salida;
+    tiempos.escribirJsonMemoria(salida, 1);
+    tiempos.reiniciar(false);
+    ASSERT_NE(salida.str().find("\"densities\": {\"allocations\": 2"), std::string::npos);
+    ASSERT_NE(salida.str().find("\"total\": {\"allocations\": 2, \"frees\""), std::string::npos);
+    ASSERT_EQ(salida.str().find("\"accelerations\""), std::string::npos);
+}
+
+//test para comprobar que liberar lo reservado antes de empezar a contar no cuenta ni resta bytes vivos
+TEST(SimulationTests, MemoriaLiberacionesSinContar)
+{
+    auto anterior = std::make_unique<std::vector<char>>(bytes_prueba);
+    TiemposEtapas tiempos;
+    tiempos.reiniciar(false, true);
+    tiempos.medir(Etapa::movimiento, [&] { anterior.reset(); });
+    const long vivos = ContadorMemoria::bytesVivos();
+    tiempos.reiniciar(false);
+    ASSERT_EQ(0, tiempos.getMemoria(Etapa::movimiento).recuento.liberaciones);
+    ASSERT_EQ(0, tiempos.getMemoria(Etapa::movimiento).recuento.bytesLiberados);
+    ASSERT_EQ(0, vivos);
+}
+
+//test para comprobar que las etapas con vecinos y las de movimiento no reservan memoria
+TEST(SimulationTests, InteraccionesSinReservas)
+{
+    const std::vector<std::string> arguments = {"3", "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.opciones.ficheroMemoria = (std::filesystem::temp_directory_path() / "memoria_test.json").string();
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    RecursosSimulacion recursos;
+    ejecutarIteraciones(malla, argumentos, calcularParametros(result.first, result.second), recursos);
+    std::remove(argumentos.opciones.ficheroMemoria.c_str());
+    ASSERT_GT(recursos.tiempos.getMemoria(Etapa::reposicion).picoVivos, 0);
+    for (const Etapa etapa: {Etapa::densidades, Etapa::transformacion, Etapa::aceleraciones, Etapa::colisiones,
+                             Etapa::movimiento, Etapa::limites}) {
+        ASSERT_EQ(0, recursos.tiempos.getMemoria(etapa).recuento.reservas);
+    }
+}
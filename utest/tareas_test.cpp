@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+#include "sim/tareas.hpp"
+
+//constantes para evitar avisos clang-tidy por magic number
+const int num_hilos = 4;
+const int num_cadenas = 50;
+
+//test para comprobar que cada tarea se ejecuta despues de todas las tareas de las que depende
+TEST(TareasTests, RespetaDependencias) {
+    GrafoTareas grafo(num_hilos);
+    std::vector<int> orden(2 * num_cadenas, -1);
+    std::atomic<int> contador{0};
+    //cada cadena tiene dos tareas, y la segunda depende de la primera de su cadena y de la anterior
+    for (int i = 0; i < num_cadenas; ++i) {
+        const int primera = grafo.agregarTarea([&, i] { orden[2 * i] = contador++; });
+        const int segunda = grafo.agregarTarea([&, i] { orden[2 * i + 1] = contador++; });
+        grafo.agregarDependencia(primera, segunda);
+        if (i > 0) {
+            grafo.agregarDependencia(primera - 2, segunda);
+        }
+    }
+    grafo.ejecutar();
+    ASSERT_EQ(2 * num_cadenas, contador.load());
+    for (int i = 0; i < num_cadenas; ++i) {
+        ASSERT_LT(orden[2 * i], orden[2 * i + 1]);
+        if (i > 0) {
+            ASSERT_LT(orden[2 * i - 2], orden[2 * i + 1]);
+        }
+    }
+}
+
+//test para comprobar que el mismo grafo se puede ejecutar varias veces
+TEST(TareasTests, EjecutarVariasVeces) {
+    GrafoTareas grafo(num_hilos);
+    std::atomic<int> contador{0};
+    for (int i = 0; i < num_cadenas; ++i) {
+        grafo.agregarTarea([&] { ++contador; });
+    }
+    grafo.ejecutar();
+    grafo.ejecutar();
+    ASSERT_EQ(2 * num_cadenas, contador.load());
+}
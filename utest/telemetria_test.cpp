@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "sim/telemetria.hpp"
+//constantes para evitar avisos clang-tidy por magic number
+const int iteraciones_10_value = 10;
+const int intervalo_5_value = 5;
+const int iteracion_7_value = 7;
+const int buffer_socket = 4096;
+const long muestras_llenado = 1000;
+const std::size_t tamano_lectura = 4096;
+
+namespace {
+    // Malla de 3x3x3 bloques con dos particulas en una esquina, una en el centro y otra en la esquina opuesta
+    std::vector<Block> bloquesPrueba(Grid &grid) {
+        grid.dividirEnBloques(1.0);
+        std::vector<Block> blocks = grid.getBlocks();
+        const Particle particula{};
+        blocks[grid.indiceBloque(0, 0, 0)].addParticle(particula);
+        blocks[grid.indiceBloque(0, 0, 0)].addParticle(particula);
+        blocks[grid.indiceBloque(1, 1, 1)].addParticle(particula);
+        blocks[grid.indiceBloque(2, 2, 2)].addParticle(particula);
+        return blocks;
+    }
+
+    // Lee lo que ya haya en el socket, sin esperar a que llegue mas
+    std::string leerDisponible(int descriptor) {
+        std::string leido;
+        std::array<char, tamano_lectura> buffer{};
+        for (ssize_t leidos = 0; (leidos = ::recv(descriptor, buffer.data(), buffer.size(), MSG_DONTWAIT)) > 0;) {
+            leido.append(buffer.data(), static_cast<std::size_t>(leidos));
+        }
+        return leido;
+    }
+
+    // Cuenta las lineas JSON completas (y falla si hay alguna cortada)
+    long contarLineasCompletas(const std::string &texto) {
+        long lineas = 0;
+        std::size_t inicio = 0;
+        for (std::size_t fin = texto.find('\n'); fin != std::string::npos; fin = texto.find('\n', inicio)) {
+            EXPECT_EQ('{', texto[inicio]);
+            EXPECT_EQ('}', texto[fin - 1]);
+            EXPECT_EQ(std::string::npos, texto.substr(inicio + 1, fin - inicio - 1).find('{'));
+            inicio = fin + 1;
+            ++lineas;
+        }
+        EXPECT_EQ(texto.size(), inicio);
+        return lineas;
+    }
+}
+
+//test para comprobar que se cuentan una vez los pares de particulas de bloques vecinos (y del mismo bloque)
+TEST(TelemetriaTests, ParesCandidatos) {
+    Grid grid(Punto{0.0, 0.0, 0.0}, Punto{3.0, 3.0, 3.0});
+    const std::vector<Block> blocks = bloquesPrueba(grid);
+    // 1 en la esquina, 2 entre la esquina y el centro y 1 entre el centro y la esquina opuesta
+    ASSERT_EQ(paresCandidatos(blocks, grid), 4);
+}
+
+//test para comprobar que solo se escribe una muestra cada "intervalo" iteraciones, como una linea JSON
+TEST(TelemetriaTests, MuestraCadaIntervalo) {
+    const std::filesystem::path ruta = std::filesystem::temp_directory_path() / "telemetria_test.jsonl";
+    std::filesystem::remove(ruta);
+    Argumentos argumentos;
+    argumentos.iteraciones = iteraciones_10_value;
+    argumentos.opciones.intervaloTelemetria = intervalo_5_value;
+    argumentos.opciones.destinoTelemetria = ruta.string();
+    Grid grid(Punto{0.0, 0.0, 0.0}, Punto{3.0, 3.0, 3.0});
+    const std::vector<Block> blocks = bloquesPrueba(grid);
+    {
+        Telemetria telemetria(argumentos, 0);
+        telemetria.muestrear(blocks, grid, intervalo_5_value, 0.0);
+        telemetria.muestrear(blocks, grid, iteracion_7_value, 0.0);
+    }
+    std::ifstream fichero(ruta);
+    std::string linea;
+    ASSERT_TRUE(std::getline(fichero, linea));
+    ASSERT_NE(linea.find("\"iteration\": 5,"), std::string::npos);
+    ASSERT_NE(linea.find("\"particles\": 4,"), std::string::npos);
+    ASSERT_NE(linea.find("\"peak_particles_per_block\": 2,"), std::string::npos);
+    ASSERT_EQ(linea.back(), '}');
+    ASSERT_FALSE(std::getline(fichero, linea));
+    std::filesystem::remove(ruta);
+}
+
+//test para comprobar que con el destino lleno las muestras se descartan sin esperar y que no se corta ninguna linea
+TEST(TelemetriaTests, DestinoLlenoDescarta) {
+    std::array<int, 2> extremos{};
+    ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, extremos.data()));
+    const int buffer = buffer_socket;
+    ::setsockopt(extremos[0], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    Argumentos argumentos;
+    argumentos.opciones.intervaloTelemetria = 1;
+    argumentos.opciones.descriptorTelemetria = extremos[0];
+    Grid grid(Punto{0.0, 0.0, 0.0}, Punto{3.0, 3.0, 3.0});
+    const std::vector<Block> blocks = bloquesPrueba(grid);
+    std::string recibido;
+    long descartadas = 0;
+    {
+        Telemetria telemetria(argumentos, 0);
+        for (int iter = 1; iter <= muestras_llenado; ++iter) { // Nadie lee: se llena
+            telemetria.muestrear(blocks, grid, iter, 0.0);
+        }
+        descartadas = telemetria.getDescartadas();
+        recibido = leerDisponible(extremos[1]);
+    }
+    ::close(extremos[0]);
+    recibido += leerDisponible(extremos[1]);
+    ::close(extremos[1]);
+    ASSERT_GT(descartadas, 0);
+    ASSERT_EQ(muestras_llenado, contarLineasCompletas(recibido) + descartadas);
+}
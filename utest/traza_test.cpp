@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "sim/paralelo.hpp"
+#include "sim/simulacion.hpp"
+#include "sim/traza.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+//constantes para evitar avisos clang-tidy por magic number
+const long valor_prueba = 7;
+const int hilos_traza = 2;
+const int iteraciones_traza = 3;
+
+namespace {
+    // Numero de apariciones de "texto" en "json"
+    std::size_t contar(const std::string &json, const std::string &texto) {
+        std::size_t veces = 0;
+        for (auto posicion = json.find(texto); posicion != std::string::npos;
+             posicion = json.find(texto, posicion + 1)) {
+            ++veces;
+        }
+        return veces;
+    }
+}
+
+//test para comprobar que cada hilo anota en su propio buffer y que sin activar no se anota nada
+TEST(TrazaTests, BuffersPorHilo)
+{
+    Traza::activar(false);
+    {
+        const Traza::Ambito ambito("inactivo");
+    }
+    Traza::activar(true);
+    ASSERT_EQ(0U, Traza::numEventos());
+    {
+        const Traza::Ambito ambito("principal", "valor", valor_prueba);
+    }
+    std::thread([] { const Traza::Ambito ambito("otro"); }).join();
+    Traza::activar(false);
+    ASSERT_EQ(2U, Traza::numEventos());
+    std::ostringstream salida;
+    Traza::escribirJson(salida);
+    const std::string json = salida.str();
+    ASSERT_EQ(0U, json.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+    ASSERT_NE(json.find("\"name\": \"principal\", \"ph\": \"X\""), std::string::npos);
+    ASSERT_NE(json.find("\"args\": {\"valor\": 7}"), std::string::npos);
+    ASSERT_EQ(json.find("inactivo"), std::string::npos);
+    const auto principal = json.find("\"tid\"", json.find("\"name\": \"principal\""));
+    const auto otro = json.find("\"tid\"", json.find("\"name\": \"otro\""));
+    ASSERT_NE(json.substr(principal, json.find(',', principal) - principal),
+              json.substr(otro, json.find(',', otro) - otro));
+}
+
+//test para comprobar que --trace escribe las iteraciones, las etapas y los trozos de los hilos
+TEST(TrazaTests, IteracionesEtapasYTrozos)
+{
+    const std::vector<std::string> arguments = {std::to_string(iteraciones_traza), "small.fld", "out.fld"};
+    Argumentos argumentos;
+    comprobarArgsEntrada(static_cast<int>(arguments.size()) + 1, arguments, argumentos);
+    argumentos.opciones.hilos = hilos_traza;
+    argumentos.opciones.ficheroTraza = (std::filesystem::temp_directory_path() / "traza_test.json").string();
+    Grid malla(Constantes::limInferior, Constantes::limSuperior);
+    auto result = malla.simular_malla(argumentos.fluid);
+    RecursosSimulacion recursos;
+    ejecutarIteraciones(malla, argumentos, calcularParametros(result.first, result.second), recursos);
+    std::ifstream fichero(argumentos.opciones.ficheroTraza);
+    std::stringstream contenido;
+    contenido << fichero.rdbuf();
+    std::remove(argumentos.opciones.ficheroTraza.c_str());
+    const std::string json = contenido.str();
+    ASSERT_FALSE(Traza::activa());
+    ASSERT_EQ(static_cast<std::size_t>(iteraciones_traza), contar(json, "\"name\": \"iteration\""));
+    ASSERT_EQ(static_cast<std::size_t>(iteraciones_traza), contar(json, "\"name\": \"interactions\""));
+    ASSERT_EQ(1U, contar(json, "\"name\": \"total\""));
+    ASSERT_GT(contar(json, "chunk\""), 0U);
+    ASSERT_EQ(static_cast<std::size_t>(iteraciones_traza), contar(json, "\"args\": {\"iteration\": "));
+}